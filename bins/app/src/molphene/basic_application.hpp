@@ -1,16 +1,24 @@
 #ifndef MOLPHENE_APP_APPLICATION_VIEW_HPP
 #define MOLPHENE_APP_APPLICATION_VIEW_HPP
 
-#include <set>
-#include <sstream>
+#include <chrono>
 #include <string>
+#include <thread>
 #include <utility>
 
 #include <molecule/chemdoodle_json_parser.hpp>
+#include <molecule/frame_source.hpp>
 #include <molecule/molecule.hpp>
+#include <molecule/pdb_parser.hpp>
+#include <molecule/trajectory.hpp>
 
 #include <molphene/algorithm.hpp>
+#include <molphene/atom_occlusion.hpp>
+#include <molphene/background_task.hpp>
 #include <molphene/gl_renderer.hpp>
+#include <molphene/gl_upload_queue.hpp>
+#include <molphene/loading_progress.hpp>
+#include <molphene/representation_cache.hpp>
 #include <molphene/scene.hpp>
 
 #include <molphene/ballstick_representation.hpp>
@@ -23,13 +31,17 @@
 #include <molphene/instance_copy_builder.hpp>
 #include <molphene/molecule_display.hpp>
 #include <molphene/molecule_to_shape.hpp>
+#include <molphene/ribbon_representation.hpp>
 #include <molphene/spacefill_representation.hpp>
 #include <molphene/sphere_mesh_builder.hpp>
 #include <molphene/sphere_vertex_buffers_batch.hpp>
 #include <molphene/sphere_vertex_buffers_instanced.hpp>
+#include <molphene/surface_representation.hpp>
 
 #include <molphene/io/click_state.hpp>
 
+#include "molecule_atoms.hpp"
+
 namespace molphene {
 
 template<typename TApp>
@@ -40,14 +52,21 @@ public:
   using scene_type = Scene;
 
   using spacefill_representation_batch =
-   basic_spacefill_representation<sphere_vertex_buffers_batch>;
+   basic_spacefill_representation<sphere_vertex_buffers_packed>;
+
+  using spacefill_representation_quantized =
+   basic_spacefill_representation<sphere_vertex_buffers_quantized>;
 
   using spacefill_representation_instanced =
    basic_spacefill_representation<sphere_vertex_buffers_instanced>;
 
   using ballstick_representation_batch =
-   basic_ballstick_representation<sphere_vertex_buffers_batch,
-                                  cylinder_vertex_buffers_batch>;
+   basic_ballstick_representation<sphere_vertex_buffers_packed,
+                                  cylinder_vertex_buffers_packed>;
+
+  using ballstick_representation_quantized =
+   basic_ballstick_representation<sphere_vertex_buffers_quantized,
+                                  cylinder_vertex_buffers_quantized>;
 
   using ballstick_representation_instanced =
    basic_ballstick_representation<sphere_vertex_buffers_instanced,
@@ -55,6 +74,31 @@ public:
 
   using representations_container = std::list<drawable>;
 
+  using representation_cache_type =
+   basic_representation_cache<molecule_display>;
+
+  static constexpr auto default_representation_cache_budget =
+   std::size_t{256} * 1024 * 1024;
+
+  using loading_progress_callback =
+   std::function<void(const loading_progress&)>;
+
+  struct prepared_structure {
+    molecule mol;
+
+    typename scene_type::bounding_sphere_type bounding_sphere;
+
+    std::vector<float> atom_occlusion;
+
+    molecule_display display;
+
+    std::variant<std::vector<sphere_mesh_attribute>,
+                 ballstick_mesh_attributes,
+                 molecular_surface,
+                 std::vector<ribbon_mesh_attribute>>
+     mesh_attributes;
+  };
+
   void setup()
   {
     static_cast<TApp*>(this)->init_context();
@@ -84,17 +128,58 @@ public:
 
   void open_pdb_data(std::string pdbdata)
   {
-    auto pdbstm = std::stringstream{pdbdata};
-    molecule_ = chemdoodle_json_parser{}.parse(pdbstm);
+    cancel_loading();
+    occlusion_task_.cancel();
+
+    loading_task_.start(
+     [pdbdata = std::move(pdbdata),
+      display = representation_,
+      bake_occlusion = bake_occlusion_,
+      surface_options = surface_options_](background_task_token& token) {
+       return prepare_structure(
+        pdbdata, display, bake_occlusion, surface_options, token);
+     });
+
+    report_loading({loading_stage::preparing, 0});
+  }
 
-    scene_.reset_mesh(molecule_);
-    reset_representation(molecule_);
-    camera_.top(scene_.bounding_sphere().radius() + 2);
-    camera_.update_view_matrix();
+  void cancel_loading() noexcept
+  {
+    if(!is_loading()) {
+      return;
+    }
+
+    loading_task_.cancel();
+    upload_queue_.clear();
+
+    report_loading({loading_stage::cancelled, 0});
+  }
+
+  void finish_loading()
+  {
+    while(is_loading()) {
+      if(loading_task_.is_running() && !loading_task_.is_finished()) {
+        std::this_thread::yield();
+      }
+      update_loading(std::chrono::steady_clock::duration::max());
+    }
+  }
+
+  auto is_loading() const noexcept -> bool
+  {
+    return loading_task_.is_running() || !upload_queue_.empty();
+  }
+
+  void loading_callback(loading_progress_callback callback)
+  {
+    loading_callback_ = std::move(callback);
   }
 
   void render_frame()
   {
+    update_loading(upload_budget_);
+    update_trajectory();
+
     renderer_.render(scene_, camera_, representations_);
   }
 
@@ -120,6 +205,12 @@ public:
     case static_cast<int>(molecule_display::ball_and_stick_instance): {
       representation(molecule_display::ball_and_stick_instance, molecule_);
     } break;
+    case static_cast<int>(molecule_display::surface): {
+      representation(molecule_display::surface, molecule_);
+    } break;
+    case static_cast<int>(molecule_display::ribbon): {
+      representation(molecule_display::ribbon, molecule_);
+    } break;
     }
   }
 
@@ -133,14 +224,70 @@ public:
     reset_representation(mol);
   }
 
-  template<typename TSpacefill, typename TSizedRangeAtoms>
-  auto build_spacefill_representation(TSizedRangeAtoms&& atoms) const
+  template<typename TSpacefill>
+  static auto make_spacefill_representation(atom_shading shading = {})
    -> TSpacefill
   {
     auto spacefill = TSpacefill{};
 
     spacefill.radius_size = 1;
     spacefill.radius_type = atom_radius_kind::van_der_waals;
+    spacefill.shading = shading;
+
+    return spacefill;
+  }
+
+  template<typename TBallstick>
+  static auto make_ballstick_representation(atom_shading shading = {})
+   -> TBallstick
+  {
+    auto ballnstick = TBallstick{};
+
+    ballnstick.shading = shading;
+
+    return ballnstick;
+  }
+
+  static auto
+  make_surface_representation(molecular_surface_options surface_options,
+                              atom_shading shading = {})
+   -> surface_representation
+  {
+    auto surface = surface_representation{};
+
+    surface.surface_options = surface_options;
+    surface.shading = shading;
+
+    return surface;
+  }
+
+  static auto make_ribbon_representation(atom_shading shading = {})
+   -> ribbon_representation
+  {
+    auto ribbon = ribbon_representation{};
+
+    ribbon.shading = shading;
+
+    return ribbon;
+  }
+
+  static auto make_atom_shading(const molecule& mol,
+                                const std::vector<float>& atom_occlusion)
+   -> atom_shading
+  {
+    if(atom_occlusion.size() != mol.atoms().size()) {
+      return atom_shading{};
+    }
+
+    return atom_shading{mol.atoms().data(), atom_occlusion};
+  }
+
+  template<typename TSpacefill, typename TSizedRangeAtoms>
+  auto build_spacefill_representation(TSizedRangeAtoms&& atoms,
+                                      atom_shading shading) const
+   -> TSpacefill
+  {
+    auto spacefill = make_spacefill_representation<TSpacefill>(shading);
 
     spacefill.build_vertex_buffers(std::forward<TSizedRangeAtoms>(atoms));
 
@@ -151,10 +298,10 @@ public:
            typename TSizedRangeAtoms,
            typename TSizedRangeBonds>
   auto build_ballstick_representation(TSizedRangeAtoms&& atoms_in_bond,
-                                      TSizedRangeBonds&& bond_atoms)
-   -> TBallstick
+                                      TSizedRangeBonds&& bond_atoms,
+                                      atom_shading shading) -> TBallstick
   {
-    auto ballnstick = TBallstick{};
+    auto ballnstick = make_ballstick_representation<TBallstick>(shading);
 
     ballnstick.build_vertex_buffers(
      std::forward<TSizedRangeAtoms>(atoms_in_bond),
@@ -164,112 +311,514 @@ public:
   }
 
   template<typename TSizedRangeAtoms>
-  auto build_spacefill_representation_batch(TSizedRangeAtoms&& atoms) const
+  auto build_spacefill_representation_batch(TSizedRangeAtoms&& atoms,
+                                            atom_shading shading = {}) const
    -> spacefill_representation_batch
   {
     return build_spacefill_representation<spacefill_representation_batch>(
-     std::forward<TSizedRangeAtoms>(atoms));
+     std::forward<TSizedRangeAtoms>(atoms), shading);
   }
 
   template<typename TSizedRangeAtoms>
-  auto build_spacefill_representation_instanced(TSizedRangeAtoms&& atoms) const
+  auto build_spacefill_representation_instanced(TSizedRangeAtoms&& atoms,
+                                                atom_shading shading = {}) const
    -> spacefill_representation_instanced
   {
     return build_spacefill_representation<spacefill_representation_instanced>(
-     std::forward<TSizedRangeAtoms>(atoms));
+     std::forward<TSizedRangeAtoms>(atoms), shading);
   }
 
   template<typename TSizedRangeAtoms, typename TSizedRangeBonds>
   auto build_ballstick_representation_batch(TSizedRangeAtoms&& atoms_in_bond,
-                                            TSizedRangeBonds&& bond_atoms)
+                                            TSizedRangeBonds&& bond_atoms,
+                                            atom_shading shading = {})
    -> ballstick_representation_batch
   {
     return build_ballstick_representation<ballstick_representation_batch>(
      std::forward<TSizedRangeAtoms>(atoms_in_bond),
-     std::forward<TSizedRangeBonds>(bond_atoms));
+     std::forward<TSizedRangeBonds>(bond_atoms),
+     shading);
   }
 
   template<typename TSizedRangeAtoms, typename TSizedRangeBonds>
   auto
   build_ballstick_representation_instanced(TSizedRangeAtoms&& atoms_in_bond,
-                                           TSizedRangeBonds&& bond_atoms)
+                                           TSizedRangeBonds&& bond_atoms,
+                                           atom_shading shading = {})
    -> ballstick_representation_instanced
   {
     return build_ballstick_representation<ballstick_representation_instanced>(
      std::forward<TSizedRangeAtoms>(atoms_in_bond),
-     std::forward<TSizedRangeBonds>(bond_atoms));
+     std::forward<TSizedRangeBonds>(bond_atoms),
+     shading);
   }
 
-  void reset_representation(const molecule& mol) noexcept
+  template<typename TSizedRangeAtoms>
+  auto build_surface_representation(TSizedRangeAtoms&& atoms,
+                                    atom_shading shading = {}) const
+   -> surface_representation
   {
-    namespace range = boost::range;
+    auto surface = make_surface_representation(surface_options_, shading);
 
-    representations_.clear();
+    surface.build_vertex_buffers(std::forward<TSizedRangeAtoms>(atoms));
 
-    const auto atoms = [&]() {
-      auto atoms =
-       detail::make_reserved_vector<const atom*>(mol.atoms().size());
-      range::transform(
-       mol.atoms(), std::back_inserter(atoms), [](auto& atom) noexcept {
-         return &atom;
-       });
-      return atoms;
-    }();
-
-    const auto bond_atoms = [&]() {
-      auto bonds =
-       detail::make_reserved_vector<const bond*>(mol.bonds().size());
-      range::transform(
-       mol.bonds(), std::back_inserter(bonds), [](auto& bond) noexcept {
-         return std::addressof(bond);
-       });
+    return surface;
+  }
+
+  auto build_ribbon_representation(const molecule& mol,
+                                   atom_shading shading = {}) const
+   -> ribbon_representation
+  {
+    auto ribbon = make_ribbon_representation(shading);
 
-      using pair_atoms_t = std::pair<const atom*, const atom*>;
-      auto bond_atoms =
-       detail::make_reserved_vector<pair_atoms_t>(bonds.size());
+    ribbon.build_vertex_buffers(mol);
 
-      range::transform(
-       bonds,
-       std::back_inserter(bond_atoms),
-       [& atoms = mol.atoms()](auto bond) noexcept {
-         return std::make_pair(&atoms.at(bond->atom1()),
-                               &atoms.at(bond->atom2()));
-       });
+    return ribbon;
+  }
 
-      return bond_atoms;
-    }();
+  // ChemDoodle JSON when the data starts with an object, PDB otherwise.
+  static auto parse_structure(std::string_view data) -> molecule
+  {
+    const auto first = data.find_first_not_of(" \t\r\n");
+    if(first != std::string_view::npos && data[first] == '{') {
+      return chemdoodle_json_parser{}.parse(data);
+    }
 
-    const auto atoms_in_bond = [&]() {
-      auto atoms_in_bond = std::set<const atom*>{};
+    return pdb_parser{}.parse(data);
+  }
 
-      boost::for_each(
-       bond_atoms, [&](auto atom_pair) noexcept {
-         atoms_in_bond.insert({atom_pair.first, atom_pair.second});
-       });
+  static auto prepare_structure(const std::string& pdbdata,
+                                molecule_display display,
+                                bool bake_occlusion,
+                                molecular_surface_options surface_options,
+                                background_task_token& token)
+   -> std::optional<prepared_structure>
+  {
+    auto structure = prepared_structure{};
+    structure.mol = parse_structure(pdbdata);
+    structure.display = display;
 
-      return atoms_in_bond;
-    }();
+    token.progress(0.3);
+    if(token.is_cancelled()) {
+      return std::nullopt;
+    }
 
-    switch(representation_) {
+    structure.bounding_sphere =
+     scene_type::compute_bounding_sphere(structure.mol);
+
+    token.progress(0.4);
+    if(token.is_cancelled()) {
+      return std::nullopt;
+    }
+
+    if(bake_occlusion) {
+      structure.atom_occlusion =
+       compute_atom_occlusion(make_occlusion_spheres(structure.mol), token);
+    }
+
+    token.progress(0.7);
+    if(token.is_cancelled()) {
+      return std::nullopt;
+    }
+
+    const auto shading =
+     make_atom_shading(structure.mol, structure.atom_occlusion);
+
+    switch(display) {
+    case molecule_display::spacefill:
+    case molecule_display::spacefill_instance: {
+      const auto atoms = molecule_atoms(structure.mol);
+      structure.mesh_attributes =
+       make_spacefill_representation<spacefill_representation_batch>(shading)
+        .build_mesh_attributes(atoms);
+    } break;
+    case molecule_display::ball_and_stick:
+    case molecule_display::ball_and_stick_instance: {
+      const auto bond_atoms = molecule_bond_atoms(structure.mol);
+      const auto atoms_in_bond = molecule_atoms_in_bond(structure.mol);
+      structure.mesh_attributes =
+       make_ballstick_representation<ballstick_representation_batch>(shading)
+        .build_mesh_attributes(atoms_in_bond, bond_atoms);
+    } break;
+    case molecule_display::surface: {
+      const auto atoms = molecule_atoms(structure.mol);
+      structure.mesh_attributes =
+       make_surface_representation(surface_options, shading)
+        .build_mesh_attributes(atoms);
+    } break;
+    case molecule_display::ribbon: {
+      structure.mesh_attributes =
+       make_ribbon_representation(shading).build_mesh_attributes(structure.mol);
+    } break;
+    }
+
+    token.progress(1);
+    if(token.is_cancelled()) {
+      return std::nullopt;
+    }
+
+    return structure;
+  }
+
+  void update_loading(std::chrono::steady_clock::duration budget)
+  {
+    if(occlusion_task_.is_finished()) {
+      auto atom_occlusion = occlusion_task_.take();
+      if(atom_occlusion && atom_occlusion->size() == molecule_.atoms().size()) {
+        atom_occlusion_ = std::move(*atom_occlusion);
+        representation_cache_.clear();
+        reset_representation(molecule_);
+      }
+    }
+
+    if(loading_task_.is_finished()) {
+      auto structure = loading_task_.take();
+      if(!structure) {
+        report_loading({loading_stage::failed, 0});
+        return;
+      }
+
+      enqueue_structure(std::move(*structure));
+    } else if(loading_task_.is_running()) {
+      report_loading({loading_stage::preparing, loading_task_.progress()});
+    }
+
+    if(!upload_queue_.empty()) {
+      upload_queue_.run_for(budget);
+
+      if(!upload_queue_.empty()) {
+        report_loading({loading_stage::uploading, upload_queue_.progress()});
+      }
+    }
+  }
+
+  void enqueue_structure(prepared_structure structure)
+  {
+    switch(structure.display) {
     case molecule_display::spacefill: {
-      representations_.emplace_back(
-       build_spacefill_representation_batch(atoms));
+      if(quantize_vertices_) {
+        enqueue_representation(
+         make_spacefill_representation<spacefill_representation_quantized>(),
+         std::move(structure));
+      } else {
+        enqueue_representation(
+         make_spacefill_representation<spacefill_representation_batch>(),
+         std::move(structure));
+      }
     } break;
     case molecule_display::ball_and_stick: {
-      representations_.emplace_back(
-       build_ballstick_representation_batch(atoms_in_bond, bond_atoms));
+      if(quantize_vertices_) {
+        enqueue_representation(
+         make_ballstick_representation<ballstick_representation_quantized>(),
+         std::move(structure));
+      } else {
+        enqueue_representation(
+         make_ballstick_representation<ballstick_representation_batch>(),
+         std::move(structure));
+      }
     } break;
     case molecule_display::spacefill_instance: {
-      representations_.emplace_back(
-       build_spacefill_representation_instanced(atoms));
+      enqueue_representation(
+       make_spacefill_representation<spacefill_representation_instanced>(),
+       std::move(structure));
     } break;
     case molecule_display::ball_and_stick_instance: {
-      representations_.emplace_back(
-       build_ballstick_representation_instanced(atoms_in_bond, bond_atoms));
+      enqueue_representation(
+       make_ballstick_representation<ballstick_representation_instanced>(),
+       std::move(structure));
+    } break;
+    case molecule_display::surface: {
+      enqueue_representation(make_surface_representation(surface_options_),
+                             std::move(structure));
+    } break;
+    case molecule_display::ribbon: {
+      enqueue_representation(make_ribbon_representation(),
+                             std::move(structure));
     } break;
     }
   }
 
+  template<typename TRepresentation>
+  void enqueue_representation(TRepresentation representation,
+                              prepared_structure structure)
+  {
+    using mesh_attributes_t = typename TRepresentation::mesh_attributes_type;
+
+    struct pending_upload {
+      TRepresentation representation;
+      prepared_structure structure;
+    };
+
+    // Every upload task holds the mesh attributes through a pointer that
+    // owns the representation they fill as well, so that clearing the queue
+    // releases both and no task outlives either.
+    const auto pending = std::make_shared<pending_upload>(
+     pending_upload{std::move(representation), std::move(structure)});
+
+    pending->representation.assembly_transforms =
+     pending->structure.mol.assembly_transforms();
+
+    const auto& mesh_attrs =
+     std::get<mesh_attributes_t>(pending->structure.mesh_attributes);
+    pending->representation.enqueue_vertex_buffers(
+     std::shared_ptr<const mesh_attributes_t>(pending, &mesh_attrs),
+     upload_queue_);
+
+    upload_queue_.push([this, pending] {
+      auto& structure = pending->structure;
+      molecule_ = std::move(structure.mol);
+      atom_occlusion_ = std::move(structure.atom_occlusion);
+
+      scene_.reset_mesh(structure.bounding_sphere);
+      camera_.top(scene_.bounding_sphere().radius() + 2);
+      camera_.update_view_matrix();
+
+      if constexpr(std::is_same_v<TRepresentation, surface_representation>) {
+        pending->representation.surface =
+         std::move(std::get<molecular_surface>(structure.mesh_attributes));
+      }
+
+      close_trajectory();
+
+      representation_cache_.clear();
+      representations_.clear();
+      representations_.push_back(representation_cache_.insert(
+       structure.display, drawable{std::move(pending->representation)}));
+
+      if(representation_ != structure.display) {
+        reset_representation(molecule_);
+      }
+
+      report_loading({loading_stage::finished, 1});
+    });
+  }
+
+  void report_loading(const loading_progress& progress) const
+  {
+    if(loading_callback_) {
+      loading_callback_(progress);
+    }
+  }
+
+  // Draws the representation once per copy in the molecule's biological
+  // assembly.
+  template<typename TRepresentation>
+  static auto assembly_drawable(TRepresentation representation,
+                                const molecule& mol) -> drawable
+  {
+    representation.assembly_transforms = mol.assembly_transforms();
+    return drawable{std::move(representation)};
+  }
+
+  auto build_representation(const molecule& mol, molecule_display display)
+   -> drawable
+  {
+    const auto shading = make_atom_shading(mol, atom_occlusion_);
+
+    switch(display) {
+    case molecule_display::spacefill: {
+      if(quantize_vertices_) {
+        return assembly_drawable(
+         build_spacefill_representation<spacefill_representation_quantized>(
+          molecule_atoms(mol), shading),
+         mol);
+      }
+      return assembly_drawable(
+       build_spacefill_representation_batch(molecule_atoms(mol), shading),
+       mol);
+    }
+    case molecule_display::spacefill_instance: {
+      return assembly_drawable(
+       build_spacefill_representation_instanced(molecule_atoms(mol), shading),
+       mol);
+    }
+    case molecule_display::ball_and_stick: {
+      const auto bond_atoms = molecule_bond_atoms(mol);
+      if(quantize_vertices_) {
+        return assembly_drawable(
+         build_ballstick_representation<ballstick_representation_quantized>(
+          molecule_atoms_in_bond(mol), bond_atoms, shading),
+         mol);
+      }
+      return assembly_drawable(
+       build_ballstick_representation_batch(
+        molecule_atoms_in_bond(mol), bond_atoms, shading),
+       mol);
+    }
+    case molecule_display::ball_and_stick_instance: {
+      const auto bond_atoms = molecule_bond_atoms(mol);
+      return assembly_drawable(
+       build_ballstick_representation_instanced(
+        molecule_atoms_in_bond(mol), bond_atoms, shading),
+       mol);
+    }
+    case molecule_display::surface: {
+      return assembly_drawable(
+       build_surface_representation(molecule_atoms(mol), shading), mol);
+    }
+    case molecule_display::ribbon: {
+      return assembly_drawable(build_ribbon_representation(mol, shading), mol);
+    }
+    }
+
+    assert(false);
+    return drawable{build_spacefill_representation_batch(molecule_atoms(mol))};
+  }
+
+  void reset_representation(const molecule& mol)
+  {
+    representations_.clear();
+
+    if(trajectory_) {
+      representations_.push_back(build_playback_representation(mol));
+      trajectory_frame_.reset();
+      trajectory_keyframe_.reset();
+      return;
+    }
+
+    const auto* cached = representation_cache_.find(representation_);
+    if(cached == nullptr) {
+      cached = &representation_cache_.insert(
+       representation_, build_representation(mol, representation_));
+    }
+
+    representations_.push_back(*cached);
+  }
+
+  void representation_cache_budget(std::size_t budget_bytes)
+  {
+    representation_cache_.budget_bytes(budget_bytes);
+  }
+
+  // Bakes per-atom ambient occlusion into the atom colors when a structure
+  // loads, and for the current one. The current structure is shaded on a
+  // background task and redrawn once it finishes.
+  void bake_occlusion(bool enabled)
+  {
+    if(bake_occlusion_ == enabled) {
+      return;
+    }
+
+    bake_occlusion_ = enabled;
+    occlusion_task_.cancel();
+
+    if(enabled) {
+      occlusion_task_.start(
+       [spheres = make_occlusion_spheres(molecule_)](
+        background_task_token& token) -> std::optional<std::vector<float>> {
+         auto atom_occlusion = compute_atom_occlusion(spheres, token);
+         if(token.is_cancelled()) {
+           return std::nullopt;
+         }
+         return atom_occlusion;
+       });
+      return;
+    }
+
+    atom_occlusion_.clear();
+    representation_cache_.clear();
+    reset_representation(molecule_);
+  }
+
+  auto bake_occlusion() const noexcept -> bool
+  {
+    return bake_occlusion_;
+  }
+
+  // Distance in angstrom between the samples the molecular surface is meshed
+  // from, for the current structure and the ones loaded later.
+  void surface_grid_spacing(float spacing)
+  {
+    if(spacing <= 0 || surface_options_.grid_spacing == spacing) {
+      return;
+    }
+
+    surface_options_.grid_spacing = spacing;
+
+    representation_cache_.erase(molecule_display::surface);
+    if(representation_ == molecule_display::surface) {
+      reset_representation(molecule_);
+    }
+  }
+
+  auto surface_grid_spacing() const noexcept -> float
+  {
+    return surface_options_.grid_spacing;
+  }
+
+  // Stores the batch spacefill and ball-and-stick displays in the quantized
+  // vertex format, 14 bytes a vertex against 32 for floats, at a small loss
+  // of precision. Off by default.
+  void quantize_vertices(bool enabled)
+  {
+    if(quantize_vertices_ == enabled) {
+      return;
+    }
+
+    quantize_vertices_ = enabled;
+
+    representation_cache_.erase(molecule_display::spacefill);
+    representation_cache_.erase(molecule_display::ball_and_stick);
+    if(representation_ == molecule_display::spacefill ||
+       representation_ == molecule_display::ball_and_stick) {
+      reset_representation(molecule_);
+    }
+  }
+
+  auto quantize_vertices() const noexcept -> bool
+  {
+    return quantize_vertices_;
+  }
+
+  // Plays the frames of source over the current structure, which they must
+  // match atom for atom, looping. The instanced displays glide between
+  // frames and the surface re-meshes the bricks the atoms move through. The
+  // other displays would be rebuilt whole on every frame, so playback holds
+  // while one of them is shown. Loading another structure closes the
+  // trajectory.
+  auto open_trajectory(std::unique_ptr<frame_source> source) -> bool
+  {
+    if(is_loading() || !source || source->frames_size() == 0 ||
+       source->atoms_size() != molecule_.atoms().size()) {
+      return false;
+    }
+
+    trajectory_ = std::make_unique<trajectory>(std::move(source));
+    trajectory_position_ = 0;
+    trajectory_clock_ = std::chrono::steady_clock::now();
+    trajectory_playing_ = true;
+
+    representation_cache_.clear();
+    reset_representation(molecule_);
+
+    return true;
+  }
+
+  void trajectory_playing(bool playing) noexcept
+  {
+    trajectory_playing_ = playing;
+  }
+
+  auto trajectory_playing() const noexcept -> bool
+  {
+    return trajectory_playing_;
+  }
+
+  void trajectory_frame_rate(double frames_per_second) noexcept
+  {
+    trajectory_frame_rate_ = frames_per_second;
+  }
+
+  auto trajectory_frame_rate() const noexcept -> double
+  {
+    return trajectory_frame_rate_;
+  }
+
+  auto last_overdraw() const noexcept -> std::optional<double>
+  {
+    return renderer_.last_overdraw();
+  }
+
   void key_press_event(unsigned char charcode, int mods)
   {
     switch(charcode) {
@@ -300,6 +849,39 @@ public:
     case 108:
       representation(molecule_display::ball_and_stick, molecule_);
       break;
+    case 83:
+    case 115:
+      representation(molecule_display::surface, molecule_);
+      break;
+    case 82:
+    case 114:
+      representation(molecule_display::ribbon, molecule_);
+      break;
+    case 68:
+    case 100:
+      renderer_.depth_prepass(!renderer_.depth_prepass());
+      break;
+    case 73:
+    case 105:
+      renderer_.overdraw_measurement(!renderer_.overdraw_measurement());
+      break;
+    case 66:
+    case 98:
+      bake_occlusion(!bake_occlusion());
+      break;
+    case 65:
+    case 97:
+      renderer_.ambient_occlusion(
+       next_ssao_quality(renderer_.ambient_occlusion()));
+      break;
+    case 84:
+    case 116:
+      trajectory_playing(!trajectory_playing());
+      break;
+    case 81:
+    case 113:
+      quantize_vertices(!quantize_vertices());
+      break;
     }
   }
 
@@ -353,6 +935,201 @@ public:
   }
 
 private:
+  // Shares a representation between the drawable that renders it and the
+  // trajectory playback that moves its atoms.
+  template<typename TRepresentation>
+  struct shared_representation {
+    std::shared_ptr<TRepresentation> representation;
+
+    auto size_bytes() const noexcept -> std::size_t
+    {
+      return representation->size_bytes();
+    }
+
+    void render(const color_light_shader& shader) const noexcept
+    {
+      representation->render(shader);
+    }
+  };
+
+  void close_trajectory() noexcept
+  {
+    trajectory_.reset();
+    trajectory_frame_.reset();
+    trajectory_keyframe_.reset();
+    playing_spacefill_.reset();
+    playing_ballstick_.reset();
+    playing_surface_.reset();
+  }
+
+  template<typename TRepresentation>
+  auto playback_drawable(TRepresentation representation,
+                         const molecule& mol,
+                         std::shared_ptr<TRepresentation>& playing)
+   -> drawable
+  {
+    representation.assembly_transforms = mol.assembly_transforms();
+    playing = std::make_shared<TRepresentation>(std::move(representation));
+    return drawable{shared_representation<TRepresentation>{playing}};
+  }
+
+  // The representation of the current display, kept out of the cache since
+  // every frame moves its atoms.
+  auto build_playback_representation(const molecule& mol) -> drawable
+  {
+    const auto shading = make_atom_shading(mol, atom_occlusion_);
+
+    playing_spacefill_.reset();
+    playing_ballstick_.reset();
+    playing_surface_.reset();
+
+    switch(representation_) {
+    case molecule_display::spacefill_instance: {
+      return playback_drawable(
+       build_spacefill_representation_instanced(molecule_atoms(mol), shading),
+       mol,
+       playing_spacefill_);
+    }
+    case molecule_display::ball_and_stick_instance: {
+      const auto bond_atoms = molecule_bond_atoms(mol);
+      return playback_drawable(
+       build_ballstick_representation_instanced(
+        molecule_atoms_in_bond(mol), bond_atoms, shading),
+       mol,
+       playing_ballstick_);
+    }
+    case molecule_display::surface: {
+      return playback_drawable(
+       build_surface_representation(molecule_atoms(mol), shading),
+       mol,
+       playing_surface_);
+    }
+    default:
+      return build_representation(mol, representation_);
+    }
+  }
+
+  // Advances the trajectory by the time since the last frame and draws the
+  // instanced displays between the keyframes around the position. Playback
+  // holds on the last frame shown while the next one is still being read.
+  void update_trajectory()
+  {
+    if(!trajectory_) {
+      return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed =
+     std::chrono::duration<double>{now - trajectory_clock_}.count();
+    trajectory_clock_ = now;
+
+    if(!playing_spacefill_ && !playing_ballstick_ && !playing_surface_) {
+      return;
+    }
+
+    const auto position = trajectory_position_;
+    if(trajectory_playing_) {
+      trajectory_position_ =
+       std::fmod(trajectory_position_ + elapsed * trajectory_frame_rate_,
+                 static_cast<double>(trajectory_->frames_size()));
+    }
+
+    const auto frame = static_cast<std::size_t>(trajectory_position_);
+    if(frame != trajectory_frame_ && !show_trajectory_frame(frame)) {
+      trajectory_position_ = position;
+      trajectory_interpolation(1);
+      return;
+    }
+
+    trajectory_interpolation(static_cast<float>(trajectory_position_ - frame));
+  }
+
+  // Whether the frame is on screen, false while it is still being read.
+  auto show_trajectory_frame(std::size_t frame) -> bool
+  {
+    if((playing_spacefill_ || playing_ballstick_) &&
+       color_light_shader::keyframes_supported()) {
+      // The frame is the earlier keyframe and the one after it the later,
+      // which is already held when playing on from the frame before.
+      const auto later = std::min(frame + 1, trajectory_->frames_size() - 1);
+      if((trajectory_keyframe_ != frame &&
+          !push_trajectory_keyframe(frame)) ||
+         !push_trajectory_keyframe(later)) {
+        return false;
+      }
+
+      trajectory_frame_ = frame;
+      return true;
+    }
+
+    const auto coords = trajectory_->frame(frame);
+    if(coords.empty()) {
+      return false;
+    }
+
+    trajectory_frame_ = frame;
+
+    if(playing_surface_) {
+      const auto& atoms = molecule_.atoms();
+      auto moved = std::vector<std::uint32_t>{};
+      auto positions = std::vector<vec3<float>>{};
+      for(auto i = std::size_t{0}; i < atoms.size(); ++i) {
+        const auto position =
+         vec3<float>{coords[i * 3], coords[i * 3 + 1], coords[i * 3 + 2]};
+        const auto offset = position - atoms[i].position();
+        if(offset.dot(offset) > 0) {
+          moved.push_back(static_cast<std::uint32_t>(i));
+          positions.push_back(position);
+        }
+      }
+
+      molecule_.atom_positions(coords);
+      playing_surface_->move_atoms(moved, positions);
+      return true;
+    }
+
+    molecule_.atom_positions(coords);
+
+    // Without keyframes the instances jump to every frame.
+    if(playing_spacefill_) {
+      playing_spacefill_->update_positions(molecule_atoms(molecule_));
+    }
+    if(playing_ballstick_) {
+      playing_ballstick_->update_positions(molecule_atoms_in_bond(molecule_),
+                                           molecule_bond_atoms(molecule_));
+    }
+    return true;
+  }
+
+  auto push_trajectory_keyframe(std::size_t frame) -> bool
+  {
+    const auto coords = trajectory_->frame(frame);
+    if(coords.empty()) {
+      return false;
+    }
+
+    molecule_.atom_positions(coords);
+    if(playing_spacefill_) {
+      playing_spacefill_->push_keyframe(molecule_atoms(molecule_));
+    }
+    if(playing_ballstick_) {
+      playing_ballstick_->push_keyframe(molecule_atoms_in_bond(molecule_),
+                                        molecule_bond_atoms(molecule_));
+    }
+    trajectory_keyframe_ = frame;
+    return true;
+  }
+
+  void trajectory_interpolation(float t) noexcept
+  {
+    if(playing_spacefill_) {
+      playing_spacefill_->frame_interpolation(t);
+    }
+    if(playing_ballstick_) {
+      playing_ballstick_->frame_interpolation(t);
+    }
+  }
+
   io::click_state click_state_{false, 0, 0};
 
   scene_type scene_{};
@@ -363,9 +1140,55 @@ private:
 
   molecule molecule_;
 
+  std::vector<float> atom_occlusion_;
+
+  bool bake_occlusion_{false};
+
+  molecular_surface_options surface_options_;
+
+  bool quantize_vertices_{false};
+
   representations_container representations_;
 
   molecule_display representation_{molecule_display::spacefill};
+
+  representation_cache_type representation_cache_{
+   default_representation_cache_budget};
+
+  background_task<prepared_structure> loading_task_;
+
+  background_task<std::vector<float>> occlusion_task_;
+
+  gl_upload_queue upload_queue_;
+
+  std::chrono::steady_clock::duration upload_budget_{
+   std::chrono::milliseconds{8}};
+
+  loading_progress_callback loading_callback_;
+
+  std::unique_ptr<trajectory> trajectory_;
+
+  // Frames into the trajectory; the fraction runs between keyframes.
+  double trajectory_position_{0};
+
+  double trajectory_frame_rate_{10};
+
+  bool trajectory_playing_{false};
+
+  std::chrono::steady_clock::time_point trajectory_clock_;
+
+  // Frame on screen, at the earlier keyframe when gliding, none until the
+  // displays are built.
+  std::optional<std::size_t> trajectory_frame_;
+
+  // Frame at the later keyframe pushed last.
+  std::optional<std::size_t> trajectory_keyframe_;
+
+  std::shared_ptr<spacefill_representation_instanced> playing_spacefill_;
+
+  std::shared_ptr<ballstick_representation_instanced> playing_ballstick_;
+
+  std::shared_ptr<surface_representation> playing_surface_;
 };
 
 } // namespace molphene
@@ -0,0 +1,82 @@
+#ifndef MOLPHENE_APP_MOLECULE_ATOMS_HPP
+#define MOLPHENE_APP_MOLECULE_ATOMS_HPP
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include <molecule/molecule.hpp>
+
+#include <molphene/algorithm.hpp>
+#include <molphene/utility.hpp>
+
+namespace molphene {
+
+inline constexpr auto molecule_parallel_grain_size = std::size_t{1} << 14;
+
+inline auto molecule_atoms(const molecule& mol) -> std::vector<const atom*>
+{
+  namespace range = boost::range;
+
+  auto atoms = detail::make_reserved_vector<const atom*>(mol.atoms().size());
+  range::transform(
+   mol.atoms(), std::back_inserter(atoms), [](auto& atom) noexcept {
+     return &atom;
+   });
+  return atoms;
+}
+
+// The molecule checks the bond indices as bonds are added, so they index
+// the atoms unchecked here.
+inline auto molecule_bond_atoms(const molecule& mol)
+ -> std::vector<std::pair<const atom*, const atom*>>
+{
+  const auto& atoms = mol.atoms();
+  const auto& bonds = mol.bonds();
+
+  auto bond_atoms =
+   std::vector<std::pair<const atom*, const atom*>>(bonds.size());
+
+  parallel_for(std::size_t{0},
+               bonds.size(),
+               molecule_parallel_grain_size,
+               [&](std::size_t i) noexcept {
+                 bond_atoms[i] = std::make_pair(&atoms[bonds[i].atom1()],
+                                                &atoms[bonds[i].atom2()]);
+               });
+
+  return bond_atoms;
+}
+
+// Atoms in at least one bond, in the order of the molecule.
+inline auto molecule_atoms_in_bond(const molecule& mol)
+ -> std::vector<const atom*>
+{
+  const auto& atoms = mol.atoms();
+  const auto& bonds = mol.bonds();
+
+  auto in_bond = std::vector<std::atomic<bool>>(atoms.size());
+
+  parallel_for(std::size_t{0},
+               bonds.size(),
+               molecule_parallel_grain_size,
+               [&](std::size_t i) noexcept {
+                 in_bond[bonds[i].atom1()].store(true,
+                                                 std::memory_order_relaxed);
+                 in_bond[bonds[i].atom2()].store(true,
+                                                 std::memory_order_relaxed);
+               });
+
+  auto atoms_in_bond = std::vector<const atom*>{};
+  for(auto i = std::size_t{0}; i < atoms.size(); ++i) {
+    if(in_bond[i].load(std::memory_order_relaxed)) {
+      atoms_in_bond.push_back(&atoms[i]);
+    }
+  }
+
+  return atoms_in_bond;
+}
+
+} // namespace molphene
+
+#endif
@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+
+#include <molphene/molecule_atoms.hpp>
+
+namespace {
+
+using namespace molphene;
+
+using clock_type = std::chrono::steady_clock;
+
+// Chains of ten bonded atoms, each followed by one unbonded atom, like the
+// waters between the residues of a solvated structure.
+auto make_molecule(std::size_t atoms_size) -> molecule
+{
+  auto mol = molecule{};
+  for(auto i = std::size_t{0}; i < atoms_size; ++i) {
+    auto atm = atom{"C", "CA", static_cast<unsigned int>(i + 1)};
+    atm.position(i % 100, i / 100 % 100, i / 10000);
+    mol.add_atom(atm);
+
+    if(i % 11 != 0 && i % 11 != 10) {
+      mol.add_bond(bond{static_cast<int>(i - 1), static_cast<int>(i)});
+    }
+  }
+  return mol;
+}
+
+// The pass before the flag array: every bond inserts its two atoms.
+auto set_atoms_in_bond(const molecule& mol) -> std::set<const atom*>
+{
+  auto atoms_in_bond = std::set<const atom*>{};
+  for(const auto& [first, second] : molecule_bond_atoms(mol)) {
+    atoms_in_bond.insert({first, second});
+  }
+  return atoms_in_bond;
+}
+
+template<typename TFunction>
+auto best_milliseconds(int runs, TFunction fn) -> double
+{
+  auto best = std::chrono::duration<double, std::milli>::max();
+  for(auto run = 0; run < runs; ++run) {
+    const auto start = clock_type::now();
+    const auto atoms_in_bond = fn();
+    const auto elapsed =
+     std::chrono::duration<double, std::milli>{clock_type::now() - start};
+    best = std::min(best, elapsed);
+
+    if(atoms_in_bond.empty()) {
+      std::cerr << "no bonded atoms\n";
+    }
+  }
+  return best.count();
+}
+
+} // namespace
+
+// Times finding the bonded atoms of a large molecule with a std::set against
+// the flag array of molecule_atoms_in_bond. The first argument is the atom
+// count.
+int main(int argc, char* argv[])
+{
+  const auto atoms_size =
+   argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2'000'000UL;
+  constexpr auto runs = 5;
+
+  const auto mol = make_molecule(atoms_size);
+
+  const auto set_ms =
+   best_milliseconds(runs, [&] { return set_atoms_in_bond(mol); });
+  const auto flags_ms =
+   best_milliseconds(runs, [&] { return molecule_atoms_in_bond(mol); });
+
+  std::cout << mol.atoms().size() << " atoms, " << mol.bonds().size()
+            << " bonds\n"
+            << "std::set:   " << set_ms << " ms\n"
+            << "flag array: " << flags_ms << " ms\n"
+            << "speedup:    " << set_ms / flags_ms << "x\n";
+}
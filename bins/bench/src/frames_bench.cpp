@@ -0,0 +1,48 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <molecule/frame_source.hpp>
+
+namespace {
+
+using namespace molphene;
+
+using clock_type = std::chrono::steady_clock;
+
+} // namespace
+
+// Decodes every frame of each DCD or XTC file given and prints the frames
+// decoded per second, the rate trajectory playback can keep up with.
+int main(int argc, char* argv[])
+{
+  if(argc < 2) {
+    std::cerr << "usage: " << argv[0] << " trajectory.dcd|xtc...\n";
+    return 1;
+  }
+
+  for(auto i = 1; i < argc; ++i) {
+    const auto path = std::string{argv[i]};
+    const auto frames = open_frame_source(path);
+    if(!frames || frames->frames_size() == 0) {
+      std::cerr << path << ": no frames\n";
+      continue;
+    }
+
+    auto coords = std::vector<float>(frames->atoms_size() * 3);
+    auto decoded = std::size_t{0};
+
+    const auto start = clock_type::now();
+    for(auto frame = std::size_t{0}; frame < frames->frames_size(); ++frame) {
+      decoded += frames->read_frame(frame, coords) ? 1 : 0;
+    }
+    const auto seconds =
+     std::chrono::duration<double>{clock_type::now() - start}.count();
+
+    std::cout << path << ": " << decoded << " frames of "
+              << frames->atoms_size() << " atoms in " << seconds * 1000
+              << " ms, " << decoded / seconds << " frames/s\n";
+  }
+}
@@ -0,0 +1,80 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+#include <molecule/pdb_parser.hpp>
+#include <molecule/sasa.hpp>
+
+namespace {
+
+using namespace molphene;
+
+using clock_type = std::chrono::steady_clock;
+
+// Atoms of a globular protein's elements on a jittered lattice, about as
+// densely packed as the atoms of a folded protein.
+auto make_molecule(std::size_t atoms_size) -> molecule
+{
+  constexpr auto spacing = 2.7f;
+  constexpr auto elements = std::array<const char*, 8>{
+   "C", "C", "C", "C", "N", "O", "O", "S"};
+
+  const auto side = static_cast<std::size_t>(
+   std::ceil(std::cbrt(static_cast<double>(atoms_size))));
+
+  auto rng = std::mt19937{42};
+  auto jitter = std::uniform_real_distribution<float>{-0.4f, 0.4f};
+
+  auto mol = molecule{};
+  for(auto i = std::size_t{0}; i < atoms_size; ++i) {
+    const auto element = elements[i % elements.size()];
+    auto atm = atom{element, element, static_cast<unsigned int>(i + 1)};
+    atm.position(spacing * (i % side) + jitter(rng),
+                 spacing * (i / side % side) + jitter(rng),
+                 spacing * (i / side / side) + jitter(rng));
+    mol.add_atom(atm);
+  }
+  return mol;
+}
+
+auto read_molecule(const std::string& path) -> molecule
+{
+  auto file = std::ifstream{path};
+  const auto data = std::string{std::istreambuf_iterator<char>{file}, {}};
+  return pdb_parser{}.parse(data);
+}
+
+} // namespace
+
+// Times compute_sasa over every hardware thread. The first argument is a PDB
+// file, or the atom count of a synthetic structure, 100000 by default.
+int main(int argc, char* argv[])
+{
+  const auto argument = std::string{argc > 1 ? argv[1] : "100000"};
+  const auto atoms_size = std::strtoul(argument.c_str(), nullptr, 10);
+  const auto mol =
+   atoms_size > 0 ? make_molecule(atoms_size) : read_molecule(argument);
+  constexpr auto runs = 5;
+
+  auto best = std::chrono::duration<double, std::milli>::max();
+  auto total_area = 0.0;
+  for(auto run = 0; run < runs; ++run) {
+    const auto start = clock_type::now();
+    total_area = compute_sasa(mol).total_area;
+    best = std::min(best,
+                    std::chrono::duration<double, std::milli>{
+                     clock_type::now() - start});
+  }
+
+  std::cout << mol.atoms().size() << " atoms, "
+            << std::max(1U, std::thread::hardware_concurrency())
+            << " threads\n"
+            << "area: " << total_area << " A^2\n"
+            << "best: " << best.count() << " ms\n";
+}
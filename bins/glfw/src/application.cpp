@@ -96,6 +96,17 @@ void application::render_frame()
 {
   base_application_type::render_frame();
 
+  const auto overdraw = last_overdraw();
+  if(overdraw != shown_overdraw_) {
+    shown_overdraw_ = overdraw;
+
+    auto title = std::string{"Simple example"};
+    if(overdraw) {
+      title += " - overdraw " + std::to_string(*overdraw);
+    }
+    glfwSetWindowTitle(window_.get(), title.c_str());
+  }
+
   glfwSwapBuffers(window_.get());
   glfwPollEvents();
 }
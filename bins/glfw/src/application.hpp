@@ -36,6 +36,8 @@ public:
 
 private:
   glfw_window_pointer window_;
+
+  std::optional<double> shown_overdraw_;
 };
 
 } // namespace molphene
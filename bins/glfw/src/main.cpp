@@ -9,6 +9,13 @@ auto main(int argc, char* argv[]) -> int
   auto app = molphene::application{};
 
   app.setup();
+  app.loading_callback([](const molphene::loading_progress& progress) {
+    if(progress.stage == molphene::loading_stage::finished) {
+      std::cout << "structure loaded" << std::endl;
+    } else if(progress.stage == molphene::loading_stage::failed) {
+      std::cout << "structure loading failed!" << std::endl;
+    }
+  });
 
   if(argc > 1) {
     std::ifstream pdbfile(argvv[1]);
@@ -31,6 +38,13 @@ auto main(int argc, char* argv[]) -> int
     }
   }
 
+  if(argc > 2) {
+    app.finish_loading();
+    if(!app.open_trajectory(molphene::open_frame_source(argvv[2]))) {
+      std::cout << "trajectory opening failure!" << std::endl;
+    }
+  }
+
   app.run();
 
   return 0;
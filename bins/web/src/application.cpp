@@ -24,6 +24,12 @@ void application::init_context()
   glctx = ctx;
 
   emscripten_webgl_enable_extension(glctx, "ANGLE_instanced_arrays");
+  gl::vertex_array::supported(
+   emscripten_webgl_enable_extension(glctx, "OES_vertex_array_object"));
+  gl::multi_draw_supported(
+   emscripten_webgl_enable_extension(glctx, "WEBGL_multi_draw"));
+  gl::depth_texture_supported(
+   emscripten_webgl_enable_extension(glctx, "WEBGL_depth_texture"));
 
   emscripten_set_mousedown_callback(
    canvas_target, this, false, &enable_drag_handler);
@@ -28,6 +28,18 @@ void molphene_application_open_pdb_data(char* pdbdata)
   app.open_pdb_data(pdbdata);
 }
 
+EMSCRIPTEN_KEEPALIVE
+void molphene_application_cancel_loading()
+{
+  app.cancel_loading();
+}
+
+EMSCRIPTEN_KEEPALIVE
+int molphene_application_is_loading()
+{
+  return app.is_loading();
+}
+
 EMSCRIPTEN_KEEPALIVE
 void molphene_application_canvas_size_changed(int width, int height)
 {
@@ -40,6 +52,12 @@ void molphene_application_change_representation(int representation_type)
   app.change_representation(representation_type);
 }
 
+EMSCRIPTEN_KEEPALIVE
+void molphene_application_surface_grid_spacing(float spacing)
+{
+  app.surface_grid_spacing(spacing);
+}
+
 EMSCRIPTEN_KEEPALIVE
 void molphene_application_render_frame()
 {
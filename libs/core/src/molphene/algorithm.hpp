@@ -3,6 +3,10 @@
 
 #include "stdafx.hpp"
 
+#include <molecule/parallel_for.hpp>
+
+#include "utility.hpp"
+
 namespace molphene {
 
 template<typename InputIt, typename Function>
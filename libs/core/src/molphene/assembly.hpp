@@ -0,0 +1,54 @@
+#ifndef MOLPHENE_ASSEMBLY_HPP
+#define MOLPHENE_ASSEMBLY_HPP
+
+#include "stdafx.hpp"
+
+#include "color_light_shader.hpp"
+#include "m3d.hpp"
+
+namespace molphene {
+
+template<typename T>
+auto transform_point(const mat4<float>& transform,
+                     const vec3<T>& point) noexcept -> vec3<T>
+{
+  const auto* m = static_cast<const float*>(transform.m);
+  const auto x = point.x();
+  const auto y = point.y();
+  const auto z = point.z();
+  return {m[0] * x + m[4] * y + m[8] * z + m[12],
+          m[1] * x + m[5] * y + m[9] * z + m[13],
+          m[2] * x + m[6] * y + m[10] * z + m[14]};
+}
+
+// Calls draw once per assembly transform, with the transform put in front of
+// the shader's model view, so that every copy of the asymmetric unit draws
+// from the same buffers. Without transforms draw is called once as is.
+template<typename TFunction>
+void draw_assembly_copies(const color_light_shader& shader,
+                          const std::vector<mat4<float>>& transforms,
+                          TFunction draw)
+{
+  using mat3f = mat3<GLfloat>;
+  using mat4f = mat4<GLfloat>;
+
+  if(transforms.empty()) {
+    draw();
+    return;
+  }
+
+  const auto modelview = shader.modelview_matrix();
+  for(const auto& transform : transforms) {
+    const auto copy_modelview = mat4f{transform} * modelview;
+    shader.modelview_matrix(copy_modelview);
+    shader.normal_matrix(mat3f{copy_modelview.inverse().transpose()});
+    draw();
+  }
+
+  shader.modelview_matrix(modelview);
+  shader.normal_matrix(mat3f{modelview.inverse().transpose()});
+}
+
+} // namespace molphene
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef MOLPHENE_ATOM_OCCLUSION_HPP
+#define MOLPHENE_ATOM_OCCLUSION_HPP
+
+#include "stdafx.hpp"
+
+#include <molecule/cell_list.hpp>
+#include <molecule/fibonacci_directions.hpp>
+#include <molecule/molecule.hpp>
+
+#include "algorithm.hpp"
+#include "background_task.hpp"
+#include "m3d.hpp"
+
+namespace molphene {
+
+struct atom_occlusion_options {
+  std::size_t directions{32};
+
+  // Distance in angstrom a ray travels before it counts as escaped.
+  float max_distance{6};
+
+  // Shade of a fully buried atom, so that it never turns black.
+  float min_shade{0.35f};
+};
+
+// Centers and radii of the atoms, all that their occlusion is computed from.
+struct occlusion_spheres {
+  std::vector<vec3<float>> positions;
+  std::vector<float> radii;
+};
+
+inline auto make_occlusion_spheres(const molecule& mol) -> occlusion_spheres
+{
+  constexpr auto min_grain = std::size_t{256};
+  constexpr auto fallback_radius = 1.5f;
+
+  const auto& atoms = mol.atoms();
+  const auto atoms_n = atoms.size();
+
+  auto spheres = occlusion_spheres{std::vector<vec3<float>>(atoms_n),
+                                   std::vector<float>(atoms_n)};
+  parallel_for(std::size_t{0}, atoms_n, min_grain, [&](std::size_t i) {
+    const auto rvdw = atoms[i].element().rvdw;
+    spheres.positions[i] = atoms[i].position();
+    spheres.radii[i] = rvdw > 0 ? rvdw : fallback_radius;
+  });
+
+  return spheres;
+}
+
+// Shade factor per atom: the share of rays leaving the van der Waals
+// surface along its normals that escape the neighbouring atoms, mapped to
+// [min_shade, 1]. Meant to be computed once per structure at load time.
+// Every thread stops at its next block of atoms once token is cancelled,
+// leaving the shades unfinished.
+inline auto compute_atom_occlusion(const occlusion_spheres& spheres,
+                                   const background_task_token& token,
+                                   atom_occlusion_options options = {})
+ -> std::vector<float>
+{
+  constexpr auto min_grain = std::size_t{256};
+
+  const auto& positions = spheres.positions;
+  const auto& radii = spheres.radii;
+  const auto atoms_n = positions.size();
+
+  const auto max_radius =
+   radii.empty() ? 0.f : *std::max_element(radii.begin(), radii.end());
+  const auto grid = cell_list{positions, options.max_distance};
+  const auto directions = fibonacci_directions(options.directions);
+
+  auto shades = std::vector<float>(atoms_n, 1);
+  if(directions.empty()) {
+    return shades;
+  }
+
+  parallel_for_slice(
+   std::size_t{0}, atoms_n, min_grain, [&](std::size_t begin, std::size_t end) {
+     auto neighbours = std::vector<cell_list::index_type>{};
+
+     for(auto i = begin; i < end; ++i) {
+       if((i - begin) % min_grain == 0 && token.is_cancelled()) {
+         return;
+       }
+
+       const auto center = positions[i];
+       const auto reach = radii[i] + options.max_distance;
+
+       neighbours.clear();
+       grid.for_each_candidate(
+        center, reach + max_radius, [&](cell_list::index_type j) {
+          const auto limit = reach + radii[j];
+          const auto offset = positions[j] - center;
+          if(j != i && offset.dot(offset) < limit * limit) {
+            neighbours.push_back(j);
+          }
+        });
+
+       auto escaped = std::size_t{0};
+       for(const auto& direction : directions) {
+         const auto origin = center + direction * radii[i];
+         const auto hit = std::any_of(
+          neighbours.begin(), neighbours.end(), [&](auto j) noexcept {
+            const auto to_center = positions[j] - origin;
+            const auto c = to_center.dot(to_center) - radii[j] * radii[j];
+            if(c < 0) {
+              return true;
+            }
+
+            const auto b = to_center.dot(direction);
+            const auto discriminant = b * b - c;
+            return b > 0 && discriminant >= 0 &&
+                   b - std::sqrt(discriminant) <= options.max_distance;
+          });
+         escaped += hit ? 0 : 1;
+       }
+
+       const auto visibility =
+        static_cast<float>(escaped) / static_cast<float>(directions.size());
+       shades[i] = options.min_shade + (1 - options.min_shade) * visibility;
+     }
+   });
+
+  return shades;
+}
+
+inline auto compute_atom_occlusion(const molecule& mol,
+                                   atom_occlusion_options options = {})
+ -> std::vector<float>
+{
+  return compute_atom_occlusion(
+   make_occlusion_spheres(mol), background_task_token{}, options);
+}
+
+} // namespace molphene
+
+#endif
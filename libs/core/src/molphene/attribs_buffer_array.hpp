@@ -9,6 +9,23 @@
 
 namespace molphene {
 
+// How mesh vertices are split over GPU buffers. The chunked layout keeps each
+// buffer small; the packed layout fits most structures into a single buffer
+// so that every visible range is covered by one multi-draw call.
+struct chunked_buffer_layout {
+  static constexpr auto max_chunk_bytes = std::size_t{1024 * 1024 * 128};
+};
+
+struct packed_buffer_layout {
+  static constexpr auto max_chunk_bytes = std::size_t{1024 * 1024 * 512};
+};
+
+// Half-open range of instances [first, first + count).
+struct instance_range {
+  GLsizei first;
+  GLsizei count;
+};
+
 template<typename TVertAttribBuffer>
 class attrib_buffer_array {
 public:
@@ -42,7 +59,7 @@ public:
       attrib_buffers_[i].size(verts_count);
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    gl::state().bind_buffer(GL_ARRAY_BUFFER, 0);
   }
 
   attrib_buffer_array(const attrib_buffer_array&) = delete;
@@ -70,7 +87,7 @@ public:
       attrib_buffers_[chunk].data(
        index * verts_per_instance_,
        fill_size * verts_per_instance_,
-       data.first(data_offset * verts_per_instance_).data());
+       data.subspan(data_offset * verts_per_instance_).data());
 
       size -= fill_size;
       offset += fill_size;
@@ -78,6 +95,40 @@ public:
     }
   }
 
+#ifdef MOLPHENE_GL_BUFFER_STORAGE
+  // Copies the vertices of size instances from offset on out of the source
+  // buffer, where they are packed from source_offset bytes on.
+  void copy_subdata(GLintptr offset,
+                    GLsizeiptr size,
+                    GLuint source,
+                    GLintptr source_offset) const noexcept
+  {
+    while(size > 0) {
+      const auto chunk = GLsizeiptr{offset / instances_per_block_};
+      const auto index = GLsizeiptr{offset % instances_per_block_};
+
+      const auto elems_fill = instances_per_block_ - index;
+      const auto fill_size = GLsizeiptr{size < elems_fill ? size : elems_fill};
+
+      attrib_buffers_[chunk].copy_data(index * verts_per_instance_,
+                                       fill_size * verts_per_instance_,
+                                       source,
+                                       source_offset);
+
+      size -= fill_size;
+      offset += fill_size;
+      source_offset += fill_size * verts_per_instance_ * sizeof(data_type);
+    }
+  }
+#endif
+
+  void orphan() const noexcept
+  {
+    for(const auto& buffer : attrib_buffers_) {
+      buffer.orphan();
+    }
+  }
+
   template<typename TCallback>
   void setup_attrib_pointer(TCallback fn) const
    noexcept(std::is_nothrow_invocable_v<decltype(fn), GLsizei>)
@@ -117,6 +168,20 @@ public:
     return size_;
   }
 
+  auto total_instances() const noexcept -> GLsizei
+  {
+    return size_ ? (size_ - 1) * instances_per_block_ + remain_instances_ : 0;
+  }
+
+  auto size_bytes() const noexcept -> GLsizeiptr
+  {
+    auto bytes = GLsizeiptr{0};
+    for(const auto& buffer : attrib_buffers_) {
+      bytes += buffer.size_bytes();
+    }
+    return bytes;
+  }
+
   template<typename... T1s, typename... T2s>
   friend auto has_same_props(const attrib_buffer_array<T1s...>& buff,
                              const attrib_buffer_array<T2s...>& other) noexcept
@@ -150,10 +215,22 @@ using texcoords_instances_buffer_array = attrib_buffer_array<
                        shader_attrib_location::texcoordcolor,
                        1>>;
 
+// Rewritten every frame of trajectory playback.
 using transforms_instances_buffer_array = attrib_buffer_array<
  VertexAttribsBuffer<mat4<GLfloat>,
                        shader_attrib_location::transformation,
-                       1>>;
+                       1,
+                       GL_FALSE,
+                       GL_DYNAMIC_DRAW>>;
+
+// The instance transforms of the next keyframe, interpolated towards in the
+// vertex shader.
+using next_transforms_instances_buffer_array = attrib_buffer_array<
+ VertexAttribsBuffer<mat4<GLfloat>,
+                       shader_attrib_location::next_transformation,
+                       1,
+                       GL_FALSE,
+                       GL_DYNAMIC_DRAW>>;
 
 template<typename... T1s, typename... T2s>
 auto has_same_props(const attrib_buffer_array<T1s...>& buff,
@@ -172,6 +249,13 @@ auto all_has_same_props(TSelf&& buff, TOthers&&... buffs) noexcept -> bool
   return (has_same_props(buff, buffs) && ...);
 }
 
+template<typename TBuffer>
+auto buffer_size_bytes(const std::unique_ptr<TBuffer>& buff) noexcept
+ -> GLsizeiptr
+{
+  return buff ? buff->size_bytes() : 0;
+}
+
 } // namespace molphene
 
 #endif
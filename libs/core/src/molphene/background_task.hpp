@@ -0,0 +1,144 @@
+#ifndef MOLPHENE_BACKGROUND_TASK_HPP
+#define MOLPHENE_BACKGROUND_TASK_HPP
+
+#include "stdafx.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace molphene {
+
+class background_task_token {
+public:
+  auto is_cancelled() const noexcept -> bool
+  {
+    return cancelled_.load(std::memory_order_relaxed);
+  }
+
+  void cancel() noexcept
+  {
+    cancelled_.store(true, std::memory_order_relaxed);
+  }
+
+  auto progress() const noexcept -> double
+  {
+    return progress_.load(std::memory_order_relaxed);
+  }
+
+  void progress(double value) noexcept
+  {
+    progress_.store(value, std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<bool> cancelled_{false};
+
+  std::atomic<double> progress_{0};
+};
+
+// Runs a function on a detached worker thread. The function receives a token
+// to poll for cancellation and to report progress, and returns
+// std::optional<TResult>; an empty optional or an exception means the task
+// produced nothing. Without thread support the function runs inline.
+template<typename TResult>
+class background_task {
+public:
+  using result_type = TResult;
+
+  background_task() noexcept = default;
+
+  background_task(const background_task&) = delete;
+
+  background_task(background_task&&) noexcept = default;
+
+  auto operator=(const background_task&) -> background_task& = delete;
+
+  auto operator=(background_task&&) noexcept -> background_task& = default;
+
+  ~background_task() noexcept
+  {
+    cancel();
+  }
+
+  template<typename TFunction>
+  void start(TFunction fn)
+  {
+    cancel();
+
+    auto state = std::make_shared<shared_state>();
+    state_ = state;
+
+    auto work = [state, fn = std::move(fn)]() mutable noexcept {
+      auto result = std::optional<result_type>{};
+      try {
+        result = fn(state->token);
+      } catch(...) {
+        result.reset();
+      }
+
+      {
+        const auto lock = std::lock_guard<std::mutex>{state->mutex};
+        state->result = std::move(result);
+      }
+      state->finished.store(true, std::memory_order_release);
+    };
+
+#ifdef __EMSCRIPTEN__
+    work();
+#else
+    std::thread{std::move(work)}.detach();
+#endif
+  }
+
+  void cancel() noexcept
+  {
+    if(state_) {
+      state_->token.cancel();
+      state_.reset();
+    }
+  }
+
+  auto is_running() const noexcept -> bool
+  {
+    return state_ != nullptr;
+  }
+
+  auto is_finished() const noexcept -> bool
+  {
+    return state_ && state_->finished.load(std::memory_order_acquire);
+  }
+
+  auto progress() const noexcept -> double
+  {
+    return state_ ? state_->token.progress() : 0;
+  }
+
+  auto take() -> std::optional<result_type>
+  {
+    if(!is_finished()) {
+      return std::nullopt;
+    }
+
+    const auto state = std::move(state_);
+    const auto lock = std::lock_guard<std::mutex>{state->mutex};
+    return std::move(state->result);
+  }
+
+private:
+  struct shared_state {
+    background_task_token token;
+
+    std::mutex mutex;
+
+    std::optional<result_type> result;
+
+    std::atomic<bool> finished{false};
+  };
+
+  std::shared_ptr<shared_state> state_;
+};
+
+} // namespace molphene
+
+#endif
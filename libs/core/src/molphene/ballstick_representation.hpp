@@ -3,6 +3,7 @@
 
 #include "stdafx.hpp"
 
+#include "assembly.hpp"
 #include "attribs_buffer_array.hpp"
 #include "color_image_texture.hpp"
 #include "color_light_shader.hpp"
@@ -20,6 +21,12 @@
 
 namespace molphene {
 
+struct ballstick_mesh_attributes {
+  std::vector<sphere_mesh_attribute> atom_spheres;
+  std::vector<cylinder_mesh_attribute> bond1_cylinders;
+  std::vector<cylinder_mesh_attribute> bond2_cylinders;
+};
+
 template<typename TSphereBuffers, typename TCylinderBuffers>
 class basic_ballstick_representation {
 public:
@@ -33,6 +40,8 @@ public:
 
   double radius_size{0.275};
 
+  atom_shading shading;
+
   ColorManager color_manager;
 
   sphere_buffers_type atom_sphere_buffers;
@@ -41,38 +50,112 @@ public:
 
   cylinder_buffers_type bond2_cylinder_buffers;
 
+  // Places the copies of the atoms in the biological assembly, as in
+  // molecule::assembly_transforms.
+  std::vector<mat4<float>> assembly_transforms;
+
+  using mesh_attributes_type = ballstick_mesh_attributes;
+
   template<typename TSizedRangeAtoms, typename TSizedRangeBonds>
-  void build_vertex_buffers(TSizedRangeAtoms&& atoms_in_bond,
-                            TSizedRangeBonds&& bond_atoms)
+  auto build_mesh_attributes(const TSizedRangeAtoms& atoms_in_bond,
+                             const TSizedRangeBonds& bond_atoms) const
+   -> mesh_attributes_type
   {
-    {
-      auto sphere_mesh_attrs =
-       detail::make_reserved_vector<sphere_mesh_attribute>(
-        atoms_in_bond.size());
+    auto mesh_attrs = mesh_attributes_type{};
 
-      atoms_to_sphere_attrs(std::forward<TSizedRangeAtoms>(atoms_in_bond),
-                            std::back_inserter(sphere_mesh_attrs),
-                            {atom_radius_type, atom_radius_size, 0.5});
+    mesh_attrs.atom_spheres =
+     detail::make_reserved_vector<sphere_mesh_attribute>(atoms_in_bond.size());
 
-      atom_sphere_buffers.build_buffers(sphere_mesh_attrs);
-    }
+    atoms_to_sphere_attrs(atoms_in_bond,
+                          std::back_inserter(mesh_attrs.atom_spheres),
+                          {atom_radius_type, atom_radius_size, 0.5, shading});
 
-    auto cylinder_mesh_attrs =
+    mesh_attrs.bond1_cylinders =
      detail::make_reserved_vector<cylinder_mesh_attribute>(bond_atoms.size());
 
-    bonds_to_cylinder_attrs(std::forward<TSizedRangeBonds>(bond_atoms),
-                            std::back_insert_iterator(cylinder_mesh_attrs),
-                            {true, radius_size});
+    bonds_to_cylinder_attrs(
+     bond_atoms,
+     std::back_insert_iterator(mesh_attrs.bond1_cylinders),
+     {true, radius_size, shading});
+
+    mesh_attrs.bond2_cylinders =
+     detail::make_reserved_vector<cylinder_mesh_attribute>(bond_atoms.size());
+
+    bonds_to_cylinder_attrs(
+     bond_atoms,
+     std::back_insert_iterator(mesh_attrs.bond2_cylinders),
+     {false, radius_size, shading});
+
+    return mesh_attrs;
+  }
+
+  template<typename TSizedRangeAtoms, typename TSizedRangeBonds>
+  void build_vertex_buffers(TSizedRangeAtoms&& atoms_in_bond,
+                            TSizedRangeBonds&& bond_atoms)
+  {
+    const auto mesh_attrs = build_mesh_attributes(atoms_in_bond, bond_atoms);
+
+    atom_sphere_buffers.build_buffers(mesh_attrs.atom_spheres);
+    bond1_cylinder_buffers.build_buffers(mesh_attrs.bond1_cylinders);
+    bond2_cylinder_buffers.build_buffers(mesh_attrs.bond2_cylinders);
+  }
 
-    bond1_cylinder_buffers.build_buffers(cylinder_mesh_attrs);
+  template<typename TUploadQueue>
+  void
+  enqueue_vertex_buffers(std::shared_ptr<const mesh_attributes_type> mesh_attrs,
+                         TUploadQueue& queue)
+  {
+    atom_sphere_buffers.enqueue_build_buffers(
+     std::shared_ptr<const std::vector<sphere_mesh_attribute>>(
+      mesh_attrs, &mesh_attrs->atom_spheres),
+     queue);
+    bond1_cylinder_buffers.enqueue_build_buffers(
+     std::shared_ptr<const std::vector<cylinder_mesh_attribute>>(
+      mesh_attrs, &mesh_attrs->bond1_cylinders),
+     queue);
+    bond2_cylinder_buffers.enqueue_build_buffers(
+     std::shared_ptr<const std::vector<cylinder_mesh_attribute>>(
+      mesh_attrs, &mesh_attrs->bond2_cylinders),
+     queue);
+  }
 
-    cylinder_mesh_attrs.clear();
+  // Moves the balls and sticks to the current positions of the same atoms
+  // and bonds the buffers were built from, as when stepping through a
+  // trajectory. Only the per-instance transforms are uploaded, so the
+  // buffers must be instanced.
+  template<typename TSizedRangeAtoms, typename TSizedRangeBonds>
+  void update_positions(const TSizedRangeAtoms& atoms_in_bond,
+                        const TSizedRangeBonds& bond_atoms)
+  {
+    const auto mesh_attrs = build_mesh_attributes(atoms_in_bond, bond_atoms);
 
-    bonds_to_cylinder_attrs(std::forward<TSizedRangeBonds>(bond_atoms),
-                            std::back_insert_iterator(cylinder_mesh_attrs),
-                            {false, radius_size});
+    atom_sphere_buffers.update_transforms(mesh_attrs.atom_spheres);
+    bond1_cylinder_buffers.update_transforms(mesh_attrs.bond1_cylinders);
+    bond2_cylinder_buffers.update_transforms(mesh_attrs.bond2_cylinders);
+  }
 
-    bond2_cylinder_buffers.build_buffers(cylinder_mesh_attrs);
+  // Makes the current positions of the atoms the later keyframe. The balls
+  // and sticks stay where they were drawn until frame_interpolation moves
+  // them on.
+  template<typename TSizedRangeAtoms, typename TSizedRangeBonds>
+  void push_keyframe(const TSizedRangeAtoms& atoms_in_bond,
+                     const TSizedRangeBonds& bond_atoms)
+  {
+    const auto mesh_attrs = build_mesh_attributes(atoms_in_bond, bond_atoms);
+
+    atom_sphere_buffers.push_keyframe(mesh_attrs.atom_spheres);
+    bond1_cylinder_buffers.push_keyframe(mesh_attrs.bond1_cylinders);
+    bond2_cylinder_buffers.push_keyframe(mesh_attrs.bond2_cylinders);
+    frame_interpolation(0);
+  }
+
+  // Draws the balls and sticks at t between the earlier keyframe, at 0, and
+  // the later one, at 1, without uploading anything.
+  void frame_interpolation(float t) noexcept
+  {
+    atom_sphere_buffers.frame_interpolation = t;
+    bond1_cylinder_buffers.frame_interpolation = t;
+    bond2_cylinder_buffers.frame_interpolation = t;
   }
 
   template<typename TAtomElement>
@@ -93,11 +176,20 @@ public:
     return color_manager.get_element_color(atom.element().symbol);
   }
 
+  auto size_bytes() const noexcept -> std::size_t
+  {
+    return static_cast<std::size_t>(atom_sphere_buffers.size_bytes() +
+                                    bond1_cylinder_buffers.size_bytes() +
+                                    bond2_cylinder_buffers.size_bytes());
+  }
+
   void render(const color_light_shader& shader) const noexcept
   {
-    bond1_cylinder_buffers.draw(shader);
-    bond2_cylinder_buffers.draw(shader);
-    atom_sphere_buffers.draw(shader);
+    draw_assembly_copies(shader, assembly_transforms, [&]() noexcept {
+      bond1_cylinder_buffers.draw(shader);
+      bond2_cylinder_buffers.draw(shader);
+      atom_sphere_buffers.draw(shader);
+    });
   }
 };
 
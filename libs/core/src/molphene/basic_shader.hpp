@@ -3,9 +3,11 @@
 
 #include "stdafx.hpp"
 
+#include "gl/state_cache.hpp"
 #include "m3d.hpp"
 #include "mix_shader_uniforms.hpp"
 #include "opengl.hpp"
+#include "program_binary_cache.hpp"
 #include "shader_attrib_location.hpp"
 
 namespace molphene {
@@ -34,9 +36,10 @@ class basic_shader : public TMixShaderUniform {
 public:
   basic_shader() noexcept = default;
 
-  auto init_program() noexcept -> bool
+  auto init_program(const program_binary_cache* cache = nullptr) noexcept
+   -> bool
   {
-    g_program = create_program();
+    g_program = create_program(cache);
 
     assert(g_program);
 
@@ -49,7 +52,7 @@ public:
 
   void use_program() const noexcept
   {
-    glUseProgram(g_program);
+    gl::state().use_program(g_program);
   }
 
 protected:
@@ -85,12 +88,30 @@ protected:
     return shader;
   }
 
-  auto create_program() noexcept -> GLuint
+  auto create_program(const program_binary_cache* cache) noexcept -> GLuint
   {
-    const auto vert_sh = g_vert_shader = create_shader(
-     GL_VERTEX_SHADER, accessor::call_vert_shader_source(cderived_ptr()));
-    const auto frag_sh = g_frag_shader = create_shader(
-     GL_FRAGMENT_SHADER, accessor::call_frag_shader_source(cderived_ptr()));
+    const auto* vert_source = accessor::call_vert_shader_source(cderived_ptr());
+    const auto* frag_source = accessor::call_frag_shader_source(cderived_ptr());
+
+    const auto use_cache = cache != nullptr && cache->enabled();
+    const auto cache_key =
+     use_cache
+      ? cache->make_key({vert_source, frag_source, attrib_bindings()})
+      : program_binary_cache::key_type{0};
+
+    if(use_cache) {
+      if(const auto cached_program = glCreateProgram()) {
+        if(cache->load(cached_program, cache_key)) {
+          return cached_program;
+        }
+        glDeleteProgram(cached_program);
+      }
+    }
+
+    const auto vert_sh = g_vert_shader =
+     create_shader(GL_VERTEX_SHADER, vert_source);
+    const auto frag_sh = g_frag_shader =
+     create_shader(GL_FRAGMENT_SHADER, frag_source);
 
     if(!vert_sh || !frag_sh) {
       return 0;
@@ -103,6 +124,10 @@ protected:
 
       basic_shader::bind_attrib_locations(sh_program);
 
+      if(use_cache) {
+        cache->prepare(sh_program);
+      }
+
       auto link_status = GLint{GL_FALSE};
       glLinkProgram(sh_program);
       glGetProgramiv(sh_program, GL_LINK_STATUS, &link_status);
@@ -138,6 +163,10 @@ protected:
       }
     }
 
+    if(use_cache && sh_program) {
+      cache->store(sh_program, cache_key);
+    }
+
     return sh_program;
   }
 
@@ -163,13 +192,38 @@ private:
     bind_attrib_locations(gprogram, typename TShader::attrib_locations{});
   }
 
+  // The bound attributes as "location name" lines, hashed into the cache key
+  // with the sources: a binary linked with other bindings must not be loaded.
+  static auto attrib_bindings() -> std::string
+  {
+    return attrib_bindings(typename TShader::attrib_locations{});
+  }
+
+  template<shader_attrib_location... locations>
+  static auto attrib_bindings(shader_attrib_list<locations...>) -> std::string
+  {
+    auto bindings = std::string{};
+    const auto append = [&bindings](GLuint location, const GLchar* name) {
+      if(location < gl::vertex_attribs_limit()) {
+        bindings += std::to_string(location) + ' ' + name + '\n';
+      }
+    };
+    (append(static_cast<GLuint>(locations), traits<locations>::name), ...);
+    return bindings;
+  }
+
+  // Locations past the limit of the implementation are left unbound; the
+  // shader must not declare their attributes there.
   template<shader_attrib_location... locations>
   static void bind_attrib_locations(GLuint gprogram,
                                     shader_attrib_list<locations...>)
   {
-    (glBindAttribLocation(
-      gprogram, static_cast<GLuint>(locations), traits<locations>::name),
-     ...);
+    const auto bind = [gprogram](GLuint location, const GLchar* name) {
+      if(location < gl::vertex_attribs_limit()) {
+        glBindAttribLocation(gprogram, location, name);
+      }
+    };
+    (bind(static_cast<GLuint>(locations), traits<locations>::name), ...);
   }
 };
 } // namespace molphene
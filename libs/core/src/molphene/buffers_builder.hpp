@@ -3,12 +3,15 @@
 
 #include "stdafx.hpp"
 
+#include "algorithm.hpp"
 #include "attribs_buffer_array.hpp"
 #include "color_image_texture.hpp"
 #include "cylinder_mesh_builder.hpp"
 #include "m3d.hpp"
+#include "ribbon_mesh_builder.hpp"
 #include "sphere_mesh_builder.hpp"
 #include "utility.hpp"
+#include "vertex_format.hpp"
 
 namespace molphene {
 
@@ -34,73 +37,596 @@ auto build_shape_color_texture(TMeshSizedRange&& shape_attrs)
   return shape_color_texture;
 }
 
+// Every instance has the same vertex count, so instances are meshed in
+// parallel straight into their place among the vertices. The mesh of each
+// instance is written through the output that output_fn makes from the
+// instance index and the place of its vertices, which lets the vertices be
+// encoded as they are written.
+template<typename TMeshBuilder,
+         typename TShapeMeshIterator,
+         typename TFunction,
+         typename TOutputFunction,
+         typename TVertex>
+void mesh_instances(TMeshBuilder mesh_builder,
+                    TShapeMeshIterator shape_attrs_first,
+                    std::size_t instances_size,
+                    std::size_t first_instance,
+                    TFunction callable_fn,
+                    TOutputFunction output_fn,
+                    TVertex* vertices)
+{
+  constexpr auto vertices_per_instance = mesh_builder.vertices_size();
+  constexpr auto parallel_grain_instances = std::size_t{1024};
+
+  parallel_for(std::size_t{0},
+               instances_size,
+               parallel_grain_instances,
+               [&](std::size_t i) noexcept {
+                 mesh_builder.build(
+                  callable_fn(shape_attrs_first[i]),
+                  output_fn(first_instance + i,
+                            vertices + i * vertices_per_instance));
+               });
+}
+
+// Meshes instances_size shapes into staging memory and uploads them to the
+// vertex buffers from first_instance on.
+template<typename TOutputVertexBuffer,
+         typename TMeshBuilder,
+         typename TShapeMeshIterator,
+         typename TFunction,
+         typename TOutputFunction>
+void fill_mesh_slice(const TOutputVertexBuffer& shape_buff_atoms,
+                     TMeshBuilder mesh_builder,
+                     TShapeMeshIterator shape_attrs_first,
+                     std::size_t instances_size,
+                     std::size_t first_instance,
+                     TFunction callable_fn,
+                     TOutputFunction output_fn)
+{
+  using vertex_data_t = typename TOutputVertexBuffer::data_type;
+
+  constexpr auto vertices_per_instance = mesh_builder.vertices_size();
+
+  auto vertices =
+   std::vector<vertex_data_t>(instances_size * vertices_per_instance);
+
+  mesh_instances(mesh_builder,
+                 shape_attrs_first,
+                 instances_size,
+                 first_instance,
+                 callable_fn,
+                 output_fn,
+                 vertices.data());
+
+  shape_buff_atoms.subdata(first_instance,
+                           instances_size,
+                           gsl::span(vertices.data(), vertices.size()));
+}
+
+// Meshes the shapes into vertex buffers already sized for them, a slice of
+// instances at a time.
 template<typename TOutputVertexBuffer,
          typename TMeshBuilder,
          typename TShapeMeshSizedRange,
-         typename TFunction>
-auto build_mesh_vertices(TMeshBuilder mesh_builder,
-                         TShapeMeshSizedRange&& shape_attrs,
-                         TFunction callable_fn)
- -> std::unique_ptr<TOutputVertexBuffer>
+         typename TFunction,
+         typename TOutputFunction>
+void fill_mesh_vertices(const TOutputVertexBuffer& shape_buff_atoms,
+                        TMeshBuilder mesh_builder,
+                        TShapeMeshSizedRange&& shape_attrs,
+                        TFunction callable_fn,
+                        TOutputFunction output_fn)
 {
-  using vertex_buffer_array_t = TOutputVertexBuffer;
   using shape_attrs_container_t = TShapeMeshSizedRange;
 
   constexpr auto vertices_per_instance = mesh_builder.vertices_size();
-  constexpr auto max_chunk_bytes = size_t{1024 * 1024 * 128};
+  constexpr auto max_staging_bytes = size_t{1024 * 1024 * 128};
   constexpr auto bytes_per_vertex =
    sizeof(vec3<GLfloat>) + sizeof(vec3<GLfloat>) + sizeof(vec2<GLfloat>);
   constexpr auto bytes_per_instance = bytes_per_vertex * vertices_per_instance;
-  constexpr auto max_instances_per_chunk =
-   bytes_per_instance ? max_chunk_bytes / bytes_per_instance : 0;
+  constexpr auto max_instances_per_slice =
+   bytes_per_instance ? max_staging_bytes / bytes_per_instance : 0;
   const auto total_instances =
    std::forward<shape_attrs_container_t>(shape_attrs).size();
-  const auto instances_per_chunk =
-   std::min(total_instances, max_instances_per_chunk);
-  const auto vertices_per_chunk = instances_per_chunk * vertices_per_instance;
-
-  auto shape_buff_atoms = std::make_unique<vertex_buffer_array_t>(
-   vertices_per_instance, total_instances, max_instances_per_chunk);
+  const auto instances_per_slice =
+   std::min(total_instances, max_instances_per_slice);
 
-  auto chunk_count = size_t{0};
+  auto slice_count = size_t{0};
   for_each_slice(
    std::forward<shape_attrs_container_t>(shape_attrs),
-   instances_per_chunk,
+   instances_per_slice,
    [&](auto shape_attrs_range) {
-     const auto instances_size = boost::distance(shape_attrs_range);
+     fill_mesh_slice(
+      shape_buff_atoms,
+      mesh_builder,
+      std::begin(shape_attrs_range),
+      static_cast<std::size_t>(boost::distance(shape_attrs_range)),
+      slice_count * instances_per_slice,
+      callable_fn,
+      output_fn);
+
+     ++slice_count;
+   });
+}
+
+template<typename TOutputVertexBuffer,
+         typename TMeshBuilder,
+         typename TShapeMeshSizedRange,
+         typename TFunction>
+void fill_mesh_vertices(const TOutputVertexBuffer& shape_buff_atoms,
+                        TMeshBuilder mesh_builder,
+                        TShapeMeshSizedRange&& shape_attrs,
+                        TFunction callable_fn)
+{
+  fill_mesh_vertices(shape_buff_atoms,
+                     mesh_builder,
+                     std::forward<TShapeMeshSizedRange>(shape_attrs),
+                     callable_fn,
+                     [](std::size_t, auto* vertices) noexcept {
+                       return vertices;
+                     });
+}
+
+// Instances whose meshes fit in a chunk of the layout.
+template<typename TLayout, typename TMeshBuilder>
+constexpr auto mesh_instances_per_chunk(TMeshBuilder mesh_builder) noexcept
+ -> std::size_t
+{
+  constexpr auto vertices_per_instance = mesh_builder.vertices_size();
+  constexpr auto bytes_per_vertex =
+   sizeof(vec3<GLfloat>) + sizeof(vec3<GLfloat>) + sizeof(vec2<GLfloat>);
+  constexpr auto bytes_per_instance = bytes_per_vertex * vertices_per_instance;
+
+  return bytes_per_instance ? TLayout::max_chunk_bytes / bytes_per_instance
+                            : 0;
+}
+
+// Instances of the slice from first on, cut at the end of its chunk so that
+// every slice uploads into a single chunk.
+inline auto slice_instances(std::size_t first,
+                            std::size_t total_instances,
+                            std::size_t instances_per_slice,
+                            std::size_t instances_per_chunk) noexcept
+ -> std::size_t
+{
+  const auto chunk_end =
+   instances_per_chunk ? (first / instances_per_chunk + 1) * instances_per_chunk
+                       : total_instances;
+
+  return std::min({first + instances_per_slice, total_instances, chunk_end}) -
+         first;
+}
+
+// Meshes the shapes into vertex buffers allocated by an earlier task of the
+// queue, with the output that make_output_fn makes for the buffers, one
+// slice of instances per task. Through the staging ring, worker threads mesh
+// each slice into mapped memory that the GPU then copies into the buffers, so
+// the GL thread only issues the copies; otherwise the slices are meshed and
+// uploaded on the GL thread. Every task holds shape_attrs, which the caller
+// makes own the buffers as well.
+template<typename TLayout,
+         typename TUploadQueue,
+         typename TOutputVertexBuffer,
+         typename TMeshBuilder,
+         typename TShapeMeshSizedRange,
+         typename TFunction,
+         typename TMakeOutputFunction>
+void enqueue_fill_mesh_vertices(
+ TUploadQueue& queue,
+ const std::unique_ptr<TOutputVertexBuffer>& shape_buff_atoms,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TShapeMeshSizedRange> shape_attrs,
+ TFunction callable_fn,
+ TMakeOutputFunction make_output_fn)
+{
+  using vertex_data_t = typename TOutputVertexBuffer::data_type;
+
+  constexpr auto vertices_per_instance = mesh_builder.vertices_size();
+  constexpr auto bytes_per_instance =
+   sizeof(vertex_data_t) * vertices_per_instance;
+
+  constexpr auto instances_per_chunk =
+   mesh_instances_per_chunk<TLayout>(mesh_builder);
 
-     using vertex_data_t = typename vertex_buffer_array_t::data_type;
-     auto vertices =
-      detail::make_reserved_vector<vertex_data_t>(vertices_per_chunk);
+  const auto total_instances = shape_attrs->size();
 
-     boost::for_each(
-      shape_attrs_range, [&](auto shape_attr) noexcept {
-        mesh_builder.build(callable_fn(shape_attr),
-                           std::back_inserter(vertices));
+#ifdef MOLPHENE_GL_BUFFER_STORAGE
+  if(auto& ring = queue.staging_ring(); ring.enabled()) {
+    // Slices of a quarter of the ring, so that the next slices are meshed
+    // while the GPU still copies out of the last ones.
+    const auto instances_per_slice = std::max(
+     std::size_t{1}, static_cast<std::size_t>(ring.size() / 4) /
+                      bytes_per_instance);
+
+    for(auto first = std::size_t{0}, instances_size = std::size_t{0};
+        first < total_instances;
+        first += instances_size) {
+      instances_size = slice_instances(
+       first, total_instances, instances_per_slice, instances_per_chunk);
+      const auto bytes =
+       static_cast<GLsizeiptr>(instances_size * bytes_per_instance);
+      const auto offset = std::make_shared<GLintptr>(0);
+
+      queue.push_until([&ring, shape_attrs, offset, bytes] {
+        const auto allocated = ring.allocate(bytes);
+        if(allocated) {
+          *offset = *allocated;
+        }
+        return allocated.has_value();
       });
 
-     shape_buff_atoms->subdata(chunk_count * instances_per_chunk,
-                               instances_size,
-                               gsl::span(vertices.data(), vertices.size()));
+      queue.push_async([&ring,
+                        &shape_buff_atoms,
+                        mesh_builder,
+                        shape_attrs,
+                        callable_fn,
+                        make_output_fn,
+                        offset,
+                        first,
+                        instances_size] {
+        mesh_instances(mesh_builder,
+                       std::next(std::begin(*shape_attrs), first),
+                       instances_size,
+                       first,
+                       callable_fn,
+                       make_output_fn(*shape_buff_atoms),
+                       static_cast<vertex_data_t*>(ring.data(*offset)));
+      });
 
-     ++chunk_count;
-   });
+      queue.push([&ring,
+                  &shape_buff_atoms,
+                  shape_attrs,
+                  offset,
+                  first,
+                  instances_size] {
+        shape_buff_atoms->copy_subdata(
+         first, instances_size, ring.id(), *offset);
+        ring.fence(*offset);
+      });
+    }
+
+    return;
+  }
+#endif
+
+  // Small enough slices that one fits in the upload budget of a frame.
+  constexpr auto max_slice_bytes = std::size_t{4 * 1024 * 1024};
+  constexpr auto instances_per_slice =
+   std::max(std::size_t{1}, max_slice_bytes / bytes_per_instance);
+
+  for(auto first = std::size_t{0}, instances_size = std::size_t{0};
+      first < total_instances;
+      first += instances_size) {
+    instances_size = slice_instances(
+     first, total_instances, instances_per_slice, instances_per_chunk);
+
+    queue.push([&shape_buff_atoms,
+                mesh_builder,
+                shape_attrs,
+                callable_fn,
+                make_output_fn,
+                first,
+                instances_size] {
+      fill_mesh_slice(*shape_buff_atoms,
+                      mesh_builder,
+                      std::next(std::begin(*shape_attrs), first),
+                      instances_size,
+                      first,
+                      callable_fn,
+                      make_output_fn(*shape_buff_atoms));
+    });
+  }
+}
+
+// Vertex buffers sized for the meshes of total_instances shapes. Chunks hold
+// the same instances whatever the vertex format, so that the buffers of a
+// shape always line up.
+template<typename TOutputVertexBuffer,
+         typename TLayout = chunked_buffer_layout,
+         typename TMeshBuilder>
+auto allocate_mesh_vertices(TMeshBuilder mesh_builder,
+                            std::size_t total_instances)
+ -> std::unique_ptr<TOutputVertexBuffer>
+{
+  constexpr auto vertices_per_instance = mesh_builder.vertices_size();
+  constexpr auto max_instances_per_chunk =
+   mesh_instances_per_chunk<TLayout>(mesh_builder);
+
+  return std::make_unique<TOutputVertexBuffer>(
+   vertices_per_instance, total_instances, max_instances_per_chunk);
+}
+
+template<typename TOutputVertexBuffer,
+         typename TLayout = chunked_buffer_layout,
+         typename TMeshBuilder,
+         typename TShapeMeshSizedRange,
+         typename TFunction,
+         typename... TOutputFunction>
+auto build_mesh_vertices(TMeshBuilder mesh_builder,
+                         TShapeMeshSizedRange&& shape_attrs,
+                         TFunction callable_fn,
+                         TOutputFunction... output_fn)
+ -> std::unique_ptr<TOutputVertexBuffer>
+{
+  auto shape_buff_atoms = allocate_mesh_vertices<TOutputVertexBuffer, TLayout>(
+   mesh_builder, shape_attrs.size());
+
+  fill_mesh_vertices(*shape_buff_atoms,
+                     mesh_builder,
+                     std::forward<TShapeMeshSizedRange>(shape_attrs),
+                     callable_fn,
+                     output_fn...);
 
   return shape_buff_atoms;
 }
 
-template<typename TMeshBuilder, typename TSphMeshSizedRange>
+// Buffers for the positions of the meshes in the vertex format, with the
+// bounds of each chunk when the format is quantized.
+template<typename TFormat,
+         typename TLayout,
+         typename TMeshBuilder,
+         typename TShapeMeshSizedRange>
+auto allocate_mesh_positions(TMeshBuilder mesh_builder,
+                             const TShapeMeshSizedRange& shape_attrs)
+ -> std::unique_ptr<typename TFormat::positions_array_type>
+{
+  auto positions =
+   allocate_mesh_vertices<typename TFormat::positions_array_type, TLayout>(
+    mesh_builder, shape_attrs.size());
+
+  if constexpr(TFormat::quantized) {
+    positions->quantizations = build_position_quantizations(
+     shape_attrs, positions->instances_per_block());
+  }
+
+  return positions;
+}
+
+// Output of the mesh positions, quantized against the bounds of their chunk
+// when the format is.
+template<typename TFormat, typename TPositionsArray>
+auto mesh_positions_output(const TPositionsArray& positions) noexcept
+{
+  if constexpr(!TFormat::quantized) {
+    return [](std::size_t, auto* vertices) noexcept { return vertices; };
+  } else {
+    const auto instances_per_block =
+     static_cast<std::size_t>(positions.instances_per_block());
+
+    return [&positions, instances_per_block](std::size_t instance,
+                                             auto* vertices) noexcept {
+      return encode_iterator{
+       positions.quantizations[instance / instances_per_block], vertices};
+    };
+  }
+}
+
+// Output of mesh vertices stored through the encoder when the vertex format
+// is quantized, and as they are built otherwise.
+template<typename TFormat, typename TEncoder>
+auto mesh_encoded_output() noexcept
+{
+  if constexpr(!TFormat::quantized) {
+    return [](std::size_t, auto* vertices) noexcept { return vertices; };
+  } else {
+    return [](std::size_t, auto* vertices) noexcept {
+      return encode_iterator{TEncoder{}, vertices};
+    };
+  }
+}
+
+template<typename TFormat,
+         typename TLayout,
+         typename TMeshBuilder,
+         typename TShapeMeshSizedRange,
+         typename TFunction>
+auto build_mesh_positions(TMeshBuilder mesh_builder,
+                          TShapeMeshSizedRange&& shape_attrs,
+                          TFunction callable_fn)
+ -> std::unique_ptr<typename TFormat::positions_array_type>
+{
+  auto positions =
+   allocate_mesh_positions<TFormat, TLayout>(mesh_builder, shape_attrs);
+
+  fill_mesh_vertices(*positions,
+                     mesh_builder,
+                     std::forward<TShapeMeshSizedRange>(shape_attrs),
+                     callable_fn,
+                     mesh_positions_output<TFormat>(*positions));
+
+  return positions;
+}
+
+template<typename TOutputVertexBuffer,
+         typename TFormat,
+         typename TLayout,
+         typename TEncoder,
+         typename TMeshBuilder,
+         typename TShapeMeshSizedRange,
+         typename TFunction>
+auto build_mesh_encoded_vertices(TMeshBuilder mesh_builder,
+                                 TShapeMeshSizedRange&& shape_attrs,
+                                 TFunction callable_fn)
+ -> std::unique_ptr<TOutputVertexBuffer>
+{
+  return build_mesh_vertices<TOutputVertexBuffer, TLayout>(
+   mesh_builder,
+   std::forward<TShapeMeshSizedRange>(shape_attrs),
+   callable_fn,
+   mesh_encoded_output<TFormat, TEncoder>());
+}
+
+template<typename TOutputVertexBuffer,
+         typename TLayout = chunked_buffer_layout,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TShapeMeshSizedRange,
+         typename TFunction,
+         typename TMakeOutputFunction>
+void enqueue_mesh_vertices(
+ TUploadQueue& queue,
+ std::unique_ptr<TOutputVertexBuffer>& shape_buff_atoms,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TShapeMeshSizedRange> shape_attrs,
+ TFunction callable_fn,
+ TMakeOutputFunction make_output_fn)
+{
+  queue.push([&shape_buff_atoms, mesh_builder, shape_attrs] {
+    shape_buff_atoms = allocate_mesh_vertices<TOutputVertexBuffer, TLayout>(
+     mesh_builder, shape_attrs->size());
+  });
+
+  enqueue_fill_mesh_vertices<TLayout>(queue,
+                                      shape_buff_atoms,
+                                      mesh_builder,
+                                      std::move(shape_attrs),
+                                      callable_fn,
+                                      make_output_fn);
+}
+
+template<typename TOutputVertexBuffer,
+         typename TLayout = chunked_buffer_layout,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TShapeMeshSizedRange,
+         typename TFunction>
+void enqueue_mesh_vertices(
+ TUploadQueue& queue,
+ std::unique_ptr<TOutputVertexBuffer>& shape_buff_atoms,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TShapeMeshSizedRange> shape_attrs,
+ TFunction callable_fn)
+{
+  enqueue_mesh_vertices<TOutputVertexBuffer, TLayout>(
+   queue,
+   shape_buff_atoms,
+   mesh_builder,
+   std::move(shape_attrs),
+   callable_fn,
+   [](const auto&) noexcept {
+     return [](std::size_t, auto* vertices) noexcept { return vertices; };
+   });
+}
+
+template<typename TFormat,
+         typename TLayout,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TShapeMeshSizedRange,
+         typename TFunction>
+void enqueue_mesh_positions(
+ TUploadQueue& queue,
+ std::unique_ptr<typename TFormat::positions_array_type>& positions,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TShapeMeshSizedRange> shape_attrs,
+ TFunction callable_fn)
+{
+  queue.push([&positions, mesh_builder, shape_attrs] {
+    positions =
+     allocate_mesh_positions<TFormat, TLayout>(mesh_builder, *shape_attrs);
+  });
+
+  enqueue_fill_mesh_vertices<TLayout>(
+   queue,
+   positions,
+   mesh_builder,
+   std::move(shape_attrs),
+   callable_fn,
+   [](const auto& positions_array) noexcept {
+     return mesh_positions_output<TFormat>(positions_array);
+   });
+}
+
+template<typename TOutputVertexBuffer,
+         typename TFormat,
+         typename TLayout,
+         typename TEncoder,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TShapeMeshSizedRange,
+         typename TFunction>
+void enqueue_mesh_encoded_vertices(
+ TUploadQueue& queue,
+ std::unique_ptr<TOutputVertexBuffer>& shape_buff_atoms,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TShapeMeshSizedRange> shape_attrs,
+ TFunction callable_fn)
+{
+  enqueue_mesh_vertices<TOutputVertexBuffer, TLayout>(
+   queue,
+   shape_buff_atoms,
+   mesh_builder,
+   std::move(shape_attrs),
+   callable_fn,
+   [](const auto&) noexcept {
+     return mesh_encoded_output<TFormat, TEncoder>();
+   });
+}
+
+template<typename TSphMeshAttr>
+auto sphere_instance_transform(const TSphMeshAttr& sph_attr) noexcept
+ -> mat4<float>
+{
+  auto transform_mat = mat4<float>{1};
+  transform_mat.scale(sph_attr.sphere.radius);
+  transform_mat.translate(sph_attr.sphere.center);
+  return transform_mat;
+}
+
+template<typename TTransformsBuffer = transforms_instances_buffer_array,
+         typename TMeshBuilder,
+         typename TSphMeshSizedRange>
 auto build_sphere_mesh_transform_instances(TMeshBuilder mesh_builder,
                                            TSphMeshSizedRange&& sph_attrs)
- -> std::unique_ptr<transforms_instances_buffer_array>
+ -> std::unique_ptr<TTransformsBuffer>
 {
-  return build_mesh_vertices<transforms_instances_buffer_array>(
+  return build_mesh_vertices<TTransformsBuffer>(
    mesh_builder, std::forward<TSphMeshSizedRange>(sph_attrs), [
-   ](auto sph_attr) noexcept {
-     auto transform_mat = mat4<float>{1};
-     transform_mat.scale(sph_attr.sphere.radius);
-     transform_mat.translate(sph_attr.sphere.center);
-     return transform_mat;
+   ](const auto& sph_attr) noexcept {
+     return sphere_instance_transform(sph_attr);
+   });
+}
+
+template<typename TTransformsBuffer = transforms_instances_buffer_array,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TSphMeshSizedRange>
+void enqueue_sphere_mesh_transform_instances(
+ TUploadQueue& queue,
+ std::unique_ptr<TTransformsBuffer>& transforms,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TSphMeshSizedRange> sph_attrs)
+{
+  enqueue_mesh_vertices<TTransformsBuffer>(
+   queue,
+   transforms,
+   mesh_builder,
+   std::move(sph_attrs),
+   [](const auto& sph_attr) noexcept {
+     return sphere_instance_transform(sph_attr);
+   });
+}
+
+// Re-uploads the transforms of instances that moved, into fresh storage so
+// that draws still reading the old transforms do not stall the upload.
+template<typename TMeshBuilder,
+         typename TTransformsBuffer,
+         typename TSphMeshSizedRange>
+void update_sphere_mesh_transform_instances(
+ TMeshBuilder mesh_builder,
+ const TTransformsBuffer& transforms,
+ TSphMeshSizedRange&& sph_attrs)
+{
+  assert(transforms.total_instances() ==
+         static_cast<GLsizei>(sph_attrs.size()));
+
+  transforms.orphan();
+  fill_mesh_vertices(
+   transforms,
+   mesh_builder,
+   std::forward<TSphMeshSizedRange>(sph_attrs),
+   [](const auto& sph_attr) noexcept {
+     return sphere_instance_transform(sph_attr);
    });
 }
 
@@ -114,102 +640,332 @@ auto build_sphere_mesh_texcoord_instances(TMeshBuilder mesh_builder,
    ](auto sph_attr) noexcept { return sph_attr.texcoord; });
 }
 
-template<typename TMeshBuilder, typename TSphMeshSizedRange>
+template<typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TSphMeshSizedRange>
+void enqueue_sphere_mesh_texcoord_instances(
+ TUploadQueue& queue,
+ std::unique_ptr<texcoords_instances_buffer_array>& texcoords,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TSphMeshSizedRange> sph_attrs)
+{
+  enqueue_mesh_vertices<texcoords_instances_buffer_array>(
+   queue,
+   texcoords,
+   mesh_builder,
+   std::move(sph_attrs),
+   [](auto sph_attr) noexcept { return sph_attr.texcoord; });
+}
+
+template<typename TLayout = chunked_buffer_layout,
+         typename TFormat = float_vertex_format,
+         typename TMeshBuilder,
+         typename TSphMeshSizedRange>
 auto build_sphere_mesh_positions(TMeshBuilder mesh_builder,
                                  TSphMeshSizedRange&& sph_attrs)
- -> std::unique_ptr<positions_buffer_array>
+ -> std::unique_ptr<typename TFormat::positions_array_type>
 {
-  return build_mesh_vertices<positions_buffer_array>(
+  return build_mesh_positions<TFormat, TLayout>(
    mesh_builder, std::forward<TSphMeshSizedRange>(sph_attrs), [
    ](auto sph_attr) noexcept {
      return build_sphere_mesh_position_params{sph_attr.sphere};
    });
 }
 
-template<typename TMeshBuilder, typename TSphMeshSizedRange>
+template<typename TLayout = chunked_buffer_layout,
+         typename TFormat = float_vertex_format,
+         typename TMeshBuilder,
+         typename TSphMeshSizedRange>
 auto build_sphere_mesh_normals(TMeshBuilder mesh_builder,
                                TSphMeshSizedRange&& sph_attrs)
- -> std::unique_ptr<normals_buffer_array>
+ -> std::unique_ptr<typename TFormat::normals_array_type>
 {
-  return build_mesh_vertices<normals_buffer_array>(
+  return build_mesh_encoded_vertices<typename TFormat::normals_array_type,
+                                     TFormat,
+                                     TLayout,
+                                     octahedral_normal_encoder>(
    mesh_builder, sph_attrs, [](auto) noexcept {
      return build_sphere_mesh_normal_params{};
    });
 }
 
-template<typename TMeshBuilder, typename TSphMeshSizedRange>
+template<typename TLayout = chunked_buffer_layout,
+         typename TFormat = float_vertex_format,
+         typename TMeshBuilder,
+         typename TSphMeshSizedRange>
 auto build_sphere_mesh_texcoords(TMeshBuilder mesh_builder,
                                  TSphMeshSizedRange&& sph_attrs)
- -> std::unique_ptr<texcoords_buffer_array>
+ -> std::unique_ptr<typename TFormat::texcoords_array_type>
 {
-  return build_mesh_vertices<texcoords_buffer_array>(
+  return build_mesh_encoded_vertices<typename TFormat::texcoords_array_type,
+                                     TFormat,
+                                     TLayout,
+                                     texcoord_encoder>(
    mesh_builder, sph_attrs, [](auto sph_attr) noexcept {
      return build_sphere_mesh_fill_params{sph_attr.texcoord};
    });
 }
 
-template<typename TMeshBuilder, typename TCylMeshSizedRange>
+template<typename TLayout = chunked_buffer_layout,
+         typename TFormat = float_vertex_format,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TSphMeshSizedRange>
+void enqueue_sphere_mesh_positions(
+ TUploadQueue& queue,
+ std::unique_ptr<typename TFormat::positions_array_type>& positions,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TSphMeshSizedRange> sph_attrs)
+{
+  enqueue_mesh_positions<TFormat, TLayout>(
+   queue,
+   positions,
+   mesh_builder,
+   std::move(sph_attrs),
+   [](auto sph_attr) noexcept {
+     return build_sphere_mesh_position_params{sph_attr.sphere};
+   });
+}
+
+template<typename TLayout = chunked_buffer_layout,
+         typename TFormat = float_vertex_format,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TSphMeshSizedRange>
+void enqueue_sphere_mesh_normals(
+ TUploadQueue& queue,
+ std::unique_ptr<typename TFormat::normals_array_type>& normals,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TSphMeshSizedRange> sph_attrs)
+{
+  enqueue_mesh_encoded_vertices<typename TFormat::normals_array_type,
+                                TFormat,
+                                TLayout,
+                                octahedral_normal_encoder>(
+   queue, normals, mesh_builder, std::move(sph_attrs), [](auto) noexcept {
+     return build_sphere_mesh_normal_params{};
+   });
+}
+
+template<typename TLayout = chunked_buffer_layout,
+         typename TFormat = float_vertex_format,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TSphMeshSizedRange>
+void enqueue_sphere_mesh_texcoords(
+ TUploadQueue& queue,
+ std::unique_ptr<typename TFormat::texcoords_array_type>& texcoords,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TSphMeshSizedRange> sph_attrs)
+{
+  enqueue_mesh_encoded_vertices<typename TFormat::texcoords_array_type,
+                                TFormat,
+                                TLayout,
+                                texcoord_encoder>(
+   queue,
+   texcoords,
+   mesh_builder,
+   std::move(sph_attrs),
+   [](auto sph_attr) noexcept {
+     return build_sphere_mesh_fill_params{sph_attr.texcoord};
+   });
+}
+
+template<typename TLayout = chunked_buffer_layout,
+         typename TFormat = float_vertex_format,
+         typename TMeshBuilder,
+         typename TCylMeshSizedRange>
 auto build_cylinder_mesh_positions(TMeshBuilder mesh_builder,
                                    TCylMeshSizedRange&& cyl_attrs)
- -> std::unique_ptr<positions_buffer_array>
+ -> std::unique_ptr<typename TFormat::positions_array_type>
 {
-  return build_mesh_vertices<positions_buffer_array>(
+  return build_mesh_positions<TFormat, TLayout>(
    mesh_builder, std::forward<TCylMeshSizedRange>(cyl_attrs), [
    ](auto cyl_attr) noexcept {
      return build_cylinder_mesh_position_params{cyl_attr.cylinder};
    });
 }
 
-template<typename TMeshBuilder, typename TCylMeshSizedRange>
+template<typename TLayout = chunked_buffer_layout,
+         typename TFormat = float_vertex_format,
+         typename TMeshBuilder,
+         typename TCylMeshSizedRange>
 auto build_cylinder_mesh_normals(TMeshBuilder mesh_builder,
                                  TCylMeshSizedRange&& cyl_attrs)
- -> std::unique_ptr<normals_buffer_array>
+ -> std::unique_ptr<typename TFormat::normals_array_type>
 {
-  return build_mesh_vertices<normals_buffer_array>(
+  return build_mesh_encoded_vertices<typename TFormat::normals_array_type,
+                                     TFormat,
+                                     TLayout,
+                                     octahedral_normal_encoder>(
    mesh_builder, cyl_attrs, [](auto cyl_attr) noexcept {
      return build_cylinder_mesh_normal_params{cyl_attr.cylinder};
    });
 }
 
-template<typename TMeshBuilder, typename TCylMeshSizedRange>
+template<typename TLayout = chunked_buffer_layout,
+         typename TFormat = float_vertex_format,
+         typename TMeshBuilder,
+         typename TCylMeshSizedRange>
 auto build_cylinder_mesh_texcoords(TMeshBuilder mesh_builder,
                                    TCylMeshSizedRange&& cyl_attrs)
- -> std::unique_ptr<texcoords_buffer_array>
+ -> std::unique_ptr<typename TFormat::texcoords_array_type>
 {
-  return build_mesh_vertices<texcoords_buffer_array>(
+  return build_mesh_encoded_vertices<typename TFormat::texcoords_array_type,
+                                     TFormat,
+                                     TLayout,
+                                     texcoord_encoder>(
    mesh_builder, cyl_attrs, [](auto cyl_attr) noexcept {
      return build_cylinder_mesh_fill_params{cyl_attr.cylinder,
                                             cyl_attr.texcoord};
    });
 }
 
-template<typename TMeshBuilder, typename TCylMeshSizedRange>
+template<typename TLayout = chunked_buffer_layout,
+         typename TFormat = float_vertex_format,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TCylMeshSizedRange>
+void enqueue_cylinder_mesh_positions(
+ TUploadQueue& queue,
+ std::unique_ptr<typename TFormat::positions_array_type>& positions,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TCylMeshSizedRange> cyl_attrs)
+{
+  enqueue_mesh_positions<TFormat, TLayout>(
+   queue,
+   positions,
+   mesh_builder,
+   std::move(cyl_attrs),
+   [](auto cyl_attr) noexcept {
+     return build_cylinder_mesh_position_params{cyl_attr.cylinder};
+   });
+}
+
+template<typename TLayout = chunked_buffer_layout,
+         typename TFormat = float_vertex_format,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TCylMeshSizedRange>
+void enqueue_cylinder_mesh_normals(
+ TUploadQueue& queue,
+ std::unique_ptr<typename TFormat::normals_array_type>& normals,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TCylMeshSizedRange> cyl_attrs)
+{
+  enqueue_mesh_encoded_vertices<typename TFormat::normals_array_type,
+                                TFormat,
+                                TLayout,
+                                octahedral_normal_encoder>(
+   queue,
+   normals,
+   mesh_builder,
+   std::move(cyl_attrs),
+   [](auto cyl_attr) noexcept {
+     return build_cylinder_mesh_normal_params{cyl_attr.cylinder};
+   });
+}
+
+template<typename TLayout = chunked_buffer_layout,
+         typename TFormat = float_vertex_format,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TCylMeshSizedRange>
+void enqueue_cylinder_mesh_texcoords(
+ TUploadQueue& queue,
+ std::unique_ptr<typename TFormat::texcoords_array_type>& texcoords,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TCylMeshSizedRange> cyl_attrs)
+{
+  enqueue_mesh_encoded_vertices<typename TFormat::texcoords_array_type,
+                                TFormat,
+                                TLayout,
+                                texcoord_encoder>(
+   queue,
+   texcoords,
+   mesh_builder,
+   std::move(cyl_attrs),
+   [](auto cyl_attr) noexcept {
+     return build_cylinder_mesh_fill_params{cyl_attr.cylinder,
+                                            cyl_attr.texcoord};
+   });
+}
+
+template<typename TCylMeshAttr>
+auto cylinder_instance_transform(const TCylMeshAttr& cyl_attr) noexcept
+ -> mat4<float>
+{
+  using vec3_t = typename std::decay_t<decltype(cyl_attr.cylinder)>::vec3_type;
+
+  auto transform_mat = mat4<float>{1};
+
+  const auto top_dir = vec3_t{0, 1, 0};
+  const auto cyl_dir = (cyl_attr.cylinder.top - cyl_attr.cylinder.bottom) / 2;
+  const auto cyl_dir_length = cyl_dir.magnitude();
+  const auto rot_axis = cyl_dir.cross(top_dir).to_unit();
+  const auto rot_angle = std::acos(cyl_dir.dot(top_dir) / cyl_dir_length);
+  const auto cyl_radius = cyl_attr.cylinder.radius;
+  const auto cyl_position = cyl_attr.cylinder.bottom + cyl_dir;
+
+  transform_mat.scale(cyl_radius, cyl_dir_length, cyl_radius);
+  transform_mat.rotate(rot_axis, rot_angle);
+  transform_mat.translate(cyl_position);
+
+  return transform_mat;
+}
+
+template<typename TTransformsBuffer = transforms_instances_buffer_array,
+         typename TMeshBuilder,
+         typename TCylMeshSizedRange>
 auto build_cylinder_mesh_transform_instances(TMeshBuilder mesh_builder,
                                              TCylMeshSizedRange&& cyl_attrs)
- -> std::unique_ptr<transforms_instances_buffer_array>
+ -> std::unique_ptr<TTransformsBuffer>
 {
-  return build_mesh_vertices<transforms_instances_buffer_array>(
+  return build_mesh_vertices<TTransformsBuffer>(
    mesh_builder, std::forward<TCylMeshSizedRange>(cyl_attrs), [
-   ](auto cyl_attr) noexcept {
-     using vec3_t =
-      typename std::decay_t<decltype(cyl_attr.cylinder)>::vec3_type;
-
-     auto transform_mat = mat4<float>{1};
+   ](const auto& cyl_attr) noexcept {
+     return cylinder_instance_transform(cyl_attr);
+   });
+}
 
-     const auto top_dir = vec3_t{0, 1, 0};
-     const auto cyl_dir =
-      (cyl_attr.cylinder.top - cyl_attr.cylinder.bottom) / 2;
-     const auto cyl_dir_length = cyl_dir.magnitude();
-     const auto rot_axis = cyl_dir.cross(top_dir).to_unit();
-     const auto rot_angle = std::acos(cyl_dir.dot(top_dir) / cyl_dir_length);
-     const auto cyl_radius = cyl_attr.cylinder.radius;
-     const auto cyl_position = cyl_attr.cylinder.bottom + cyl_dir;
+template<typename TTransformsBuffer = transforms_instances_buffer_array,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TCylMeshSizedRange>
+void enqueue_cylinder_mesh_transform_instances(
+ TUploadQueue& queue,
+ std::unique_ptr<TTransformsBuffer>& transforms,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TCylMeshSizedRange> cyl_attrs)
+{
+  enqueue_mesh_vertices<TTransformsBuffer>(
+   queue,
+   transforms,
+   mesh_builder,
+   std::move(cyl_attrs),
+   [](const auto& cyl_attr) noexcept {
+     return cylinder_instance_transform(cyl_attr);
+   });
+}
 
-     transform_mat.scale(cyl_radius, cyl_dir_length, cyl_radius);
-     transform_mat.rotate(rot_axis, rot_angle);
-     transform_mat.translate(cyl_position);
+template<typename TMeshBuilder,
+         typename TTransformsBuffer,
+         typename TCylMeshSizedRange>
+void update_cylinder_mesh_transform_instances(
+ TMeshBuilder mesh_builder,
+ const TTransformsBuffer& transforms,
+ TCylMeshSizedRange&& cyl_attrs)
+{
+  assert(transforms.total_instances() ==
+         static_cast<GLsizei>(cyl_attrs.size()));
 
-     return transform_mat;
+  transforms.orphan();
+  fill_mesh_vertices(
+   transforms,
+   mesh_builder,
+   std::forward<TCylMeshSizedRange>(cyl_attrs),
+   [](const auto& cyl_attr) noexcept {
+     return cylinder_instance_transform(cyl_attr);
    });
 }
 
@@ -224,6 +980,123 @@ auto build_cylinder_mesh_texcoord_instances(TMeshBuilder mesh_builder,
    });
 }
 
+template<typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TCylMeshSizedRange>
+void enqueue_cylinder_mesh_texcoord_instances(
+ TUploadQueue& queue,
+ std::unique_ptr<texcoords_instances_buffer_array>& texcoords,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TCylMeshSizedRange> cyl_attrs)
+{
+  enqueue_mesh_vertices<texcoords_instances_buffer_array>(
+   queue,
+   texcoords,
+   mesh_builder,
+   std::move(cyl_attrs),
+   [](auto cyl_attr) noexcept { return cyl_attr.texcoord; });
+}
+
+template<typename TLayout = chunked_buffer_layout,
+         typename TMeshBuilder,
+         typename TRibbonMeshSizedRange>
+auto build_ribbon_mesh_positions(TMeshBuilder mesh_builder,
+                                 TRibbonMeshSizedRange&& ribbon_attrs)
+ -> std::unique_ptr<positions_buffer_array>
+{
+  return build_mesh_vertices<positions_buffer_array, TLayout>(
+   mesh_builder, std::forward<TRibbonMeshSizedRange>(ribbon_attrs), [
+   ](const auto& ribbon_attr) noexcept {
+     return build_ribbon_mesh_position_params{ribbon_attr};
+   });
+}
+
+template<typename TLayout = chunked_buffer_layout,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TRibbonMeshSizedRange>
+void enqueue_ribbon_mesh_positions(
+ TUploadQueue& queue,
+ std::unique_ptr<positions_buffer_array>& positions,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TRibbonMeshSizedRange> ribbon_attrs)
+{
+  enqueue_mesh_vertices<positions_buffer_array, TLayout>(
+   queue,
+   positions,
+   mesh_builder,
+   std::move(ribbon_attrs),
+   [](const auto& ribbon_attr) noexcept {
+     return build_ribbon_mesh_position_params{ribbon_attr};
+   });
+}
+
+template<typename TLayout = chunked_buffer_layout,
+         typename TMeshBuilder,
+         typename TRibbonMeshSizedRange>
+auto build_ribbon_mesh_normals(TMeshBuilder mesh_builder,
+                               TRibbonMeshSizedRange&& ribbon_attrs)
+ -> std::unique_ptr<normals_buffer_array>
+{
+  return build_mesh_vertices<normals_buffer_array, TLayout>(
+   mesh_builder, ribbon_attrs, [](const auto& ribbon_attr) noexcept {
+     return build_ribbon_mesh_normal_params{ribbon_attr};
+   });
+}
+
+template<typename TLayout = chunked_buffer_layout,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TRibbonMeshSizedRange>
+void enqueue_ribbon_mesh_normals(
+ TUploadQueue& queue,
+ std::unique_ptr<normals_buffer_array>& normals,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TRibbonMeshSizedRange> ribbon_attrs)
+{
+  enqueue_mesh_vertices<normals_buffer_array, TLayout>(
+   queue,
+   normals,
+   mesh_builder,
+   std::move(ribbon_attrs),
+   [](const auto& ribbon_attr) noexcept {
+     return build_ribbon_mesh_normal_params{ribbon_attr};
+   });
+}
+
+template<typename TLayout = chunked_buffer_layout,
+         typename TMeshBuilder,
+         typename TRibbonMeshSizedRange>
+auto build_ribbon_mesh_texcoords(TMeshBuilder mesh_builder,
+                                 TRibbonMeshSizedRange&& ribbon_attrs)
+ -> std::unique_ptr<texcoords_buffer_array>
+{
+  return build_mesh_vertices<texcoords_buffer_array, TLayout>(
+   mesh_builder, ribbon_attrs, [](const auto& ribbon_attr) noexcept {
+     return build_ribbon_mesh_fill_params{ribbon_attr, ribbon_attr.texcoord};
+   });
+}
+
+template<typename TLayout = chunked_buffer_layout,
+         typename TUploadQueue,
+         typename TMeshBuilder,
+         typename TRibbonMeshSizedRange>
+void enqueue_ribbon_mesh_texcoords(
+ TUploadQueue& queue,
+ std::unique_ptr<texcoords_buffer_array>& texcoords,
+ TMeshBuilder mesh_builder,
+ std::shared_ptr<const TRibbonMeshSizedRange> ribbon_attrs)
+{
+  enqueue_mesh_vertices<texcoords_buffer_array, TLayout>(
+   queue,
+   texcoords,
+   mesh_builder,
+   std::move(ribbon_attrs),
+   [](const auto& ribbon_attr) noexcept {
+     return build_ribbon_mesh_fill_params{ribbon_attr, ribbon_attr.texcoord};
+   });
+}
+
 } // namespace molphene
 
 #endif
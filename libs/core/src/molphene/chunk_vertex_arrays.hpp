@@ -0,0 +1,41 @@
+#ifndef MOLPHENE_CHUNK_VERTEX_ARRAYS_HPP
+#define MOLPHENE_CHUNK_VERTEX_ARRAYS_HPP
+
+#include "stdafx.hpp"
+
+#include "gl/vertex_array.hpp"
+
+namespace molphene {
+
+using chunk_vertex_arrays = std::vector<std::unique_ptr<gl::vertex_array>>;
+
+// Records one vertex array object per buffer chunk, enabling the arrays of
+// TAttribsGuard and calling bind_chunk(index) to set the pointers. Empty when
+// vertex array objects are unsupported.
+template<typename TAttribsGuard, typename TBindChunk>
+auto record_chunk_vertex_arrays(GLsizei chunks, TBindChunk bind_chunk)
+ -> chunk_vertex_arrays
+{
+  auto vertex_arrays = chunk_vertex_arrays{};
+  if(!gl::vertex_array::supported()) {
+    return vertex_arrays;
+  }
+
+  vertex_arrays.reserve(chunks);
+  for(auto i = GLsizei{0}; i < chunks; ++i) {
+    auto& vertex_array =
+     vertex_arrays.emplace_back(std::make_unique<gl::vertex_array>());
+    vertex_array->bind();
+
+    const auto verts_guard = TAttribsGuard{};
+    bind_chunk(i);
+  }
+
+  gl::vertex_array::unbind();
+
+  return vertex_arrays;
+}
+
+} // namespace molphene
+
+#endif
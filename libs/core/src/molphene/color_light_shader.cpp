@@ -7,6 +7,9 @@ void color_light_shader::setup_gl_attribs_val() const noexcept
   glVertexAttrib4f(
    static_cast<GLuint>(shader_attrib_location::vertex), 0, 0, 0, 1);
 
+  glVertexAttrib4f(
+   static_cast<GLuint>(shader_attrib_location::color), 1, 1, 1, 1);
+
   glVertexAttrib4f(
    static_cast<GLuint>(shader_attrib_location::transformation) + 0, 1, 0, 0, 0);
 
@@ -18,44 +21,117 @@ void color_light_shader::setup_gl_attribs_val() const noexcept
 
   glVertexAttrib4f(
    static_cast<GLuint>(shader_attrib_location::transformation) + 3, 0, 0, 0, 1);
+
+  if(!keyframes_supported()) {
+    return;
+  }
+
+  // Shapes without a next keyframe interpolate between two identities.
+  const auto next =
+   static_cast<GLuint>(shader_attrib_location::next_transformation);
+  glVertexAttrib4f(next + 0, 1, 0, 0, 0);
+  glVertexAttrib4f(next + 1, 0, 1, 0, 0);
+  glVertexAttrib4f(next + 2, 0, 0, 1, 0);
+  glVertexAttrib4f(next + 3, 0, 0, 0, 1);
+}
+
+auto color_light_shader::keyframes_supported() noexcept -> bool
+{
+  constexpr auto next_transformation_last =
+   static_cast<GLuint>(shader_attrib_location::next_transformation_3);
+  return next_transformation_last < gl::vertex_attribs_limit();
 }
 
 auto color_light_shader::vert_shader_source() const noexcept -> const GLchar*
 {
-  return R"(
+  // Compiled with KEYFRAMES defined where the attributes of the next
+  // keyframe fit.
+  constexpr auto source = R"(
     attribute vec4 a_Vertex;
     attribute vec3 a_Normal;
+    attribute vec4 a_Color;
     attribute vec2 a_TexCoord0;
     attribute vec4 a_Transformation;
     attribute vec4 a_Transformation1;
     attribute vec4 a_Transformation2;
     attribute vec4 a_Transformation3;
+#ifdef KEYFRAMES
+    attribute vec4 a_NextTransformation;
+    attribute vec4 a_NextTransformation1;
+    attribute vec4 a_NextTransformation2;
+    attribute vec4 a_NextTransformation3;
+#endif
     
     uniform mat4 u_ModelViewMatrix;
     uniform mat3 u_NormalMatrix;
     uniform mat4 u_ProjectionMatrix;
+#ifdef KEYFRAMES
+    uniform float u_FrameInterpolation;
+#endif
+    uniform bool u_SphereNormals;
+    uniform bool u_QuantizedVertices;
+    uniform vec3 u_PositionOffset;
+    uniform vec3 u_PositionScale;
     
     varying vec3 v_Position;
     varying vec3 v_Normal;
+    varying vec4 v_Color;
     varying vec2 v_ColorTexCoord;
+
+    vec2 signNotZero(vec2 v) {
+        return vec2(v.x >= 0. ? 1. : -1., v.y >= 0. ? 1. : -1.);
+    }
+
+    vec3 octahedralNormal(vec2 e) {
+        vec3 n = vec3(e, 1. - abs(e.x) - abs(e.y));
+        if(n.z < 0.) {
+          n.xy = (1. - abs(n.yx)) * signNotZero(n.xy);
+        }
+        return n;
+    }
+
     void main() {
+        vec4 vertex = a_Vertex;
+        vec3 normal = a_Normal;
+        if(u_QuantizedVertices) {
+          vertex.xyz = u_PositionOffset + u_PositionScale * a_Vertex.xyz;
+          normal = octahedralNormal(a_Normal.xy);
+        }
+        if(u_SphereNormals) {
+          normal = a_Vertex.xyz;
+        }
         mat4 transformMatrix = mat4(
           a_Transformation,
           a_Transformation1,
           a_Transformation2,
           a_Transformation3
         );
-        vec4 position = u_ModelViewMatrix * transformMatrix * a_Vertex;
+#ifdef KEYFRAMES
+        mat4 nextTransformMatrix = mat4(
+          a_NextTransformation,
+          a_NextTransformation1,
+          a_NextTransformation2,
+          a_NextTransformation3
+        );
+        transformMatrix +=
+          (nextTransformMatrix - transformMatrix) * u_FrameInterpolation;
+#endif
+        vec4 position = u_ModelViewMatrix * transformMatrix * vertex;
         v_Position = position.xyz / position.w;
+        v_Color = a_Color;
         v_ColorTexCoord = a_TexCoord0;
         v_Normal = u_NormalMatrix * mat3(
           transformMatrix[0].xyz,
           transformMatrix[1].xyz,
-          transformMatrix[2].xyz) * a_Normal;
+          transformMatrix[2].xyz) * normal;
         gl_Position = u_ProjectionMatrix * position;
         gl_Position /= gl_Position.w;
     }
     )";
+
+  static const auto keyframes_source =
+   std::string{"#define KEYFRAMES\n"} + source;
+  return keyframes_supported() ? keyframes_source.c_str() : source;
 }
 
 auto color_light_shader::frag_shader_source() const noexcept -> const GLchar*
@@ -86,9 +162,12 @@ auto color_light_shader::frag_shader_source() const noexcept -> const GLchar*
     uniform float u_Fog_visibilityRange;
 
     uniform sampler2D u_TexColorImage;
+
+    uniform bool u_DepthOnly;
     
     varying vec3 v_Position;
     varying vec3 v_Normal;
+    varying vec4 v_Color;
     varying vec2 v_ColorTexCoord;
 
     float fogInterpolant(float dV) {
@@ -109,7 +188,12 @@ auto color_light_shader::frag_shader_source() const noexcept -> const GLchar*
     }
 
     void main() {
-      vec4 texRgba = texture2D(u_TexColorImage, v_ColorTexCoord.st);
+      if(u_DepthOnly) {
+        gl_FragColor = vec4(0.);
+        return;
+      }
+
+      vec4 texRgba = texture2D(u_TexColorImage, v_ColorTexCoord.st) * v_Color;
       bool isDirLight = u_LightSource_radius < 0.;
 
       vec3 N = normalize(v_Normal);
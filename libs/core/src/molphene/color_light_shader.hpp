@@ -25,16 +25,30 @@ class color_light_shader
                                           light_source_uniform,
                                           material_uniform,
                                           fog_uniform,
-                                          color2d_sampler_uniform>> {
+                                          color2d_sampler_uniform,
+                                          depth_only_uniform,
+                                          frame_interpolation_uniform,
+                                          sphere_normals_uniform,
+                                          vertex_quantization_uniform>> {
 public:
   using attrib_locations =
    shader_attrib_list<shader_attrib_location::vertex,
                       shader_attrib_location::normal,
+                      shader_attrib_location::color,
                       shader_attrib_location::texcoordcolor,
                       shader_attrib_location::transformation,
                       shader_attrib_location::transformation_1,
                       shader_attrib_location::transformation_2,
-                      shader_attrib_location::transformation_3>;
+                      shader_attrib_location::transformation_3,
+                      shader_attrib_location::next_transformation,
+                      shader_attrib_location::next_transformation_1,
+                      shader_attrib_location::next_transformation_2,
+                      shader_attrib_location::next_transformation_3>;
+
+  // Whether the twelve attributes of interpolated instance transforms fit.
+  // WebGL 1 and OpenGL ES 2 only guarantee 8, so there instances are drawn
+  // at their latest keyframe.
+  static auto keyframes_supported() noexcept -> bool;
 
 protected:
   auto vert_shader_source() const noexcept -> const GLchar*;
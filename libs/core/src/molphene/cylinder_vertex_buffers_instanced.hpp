@@ -10,6 +10,7 @@
 #include "color_light_shader.hpp"
 
 #include "buffers_builder.hpp"
+#include "chunk_vertex_arrays.hpp"
 #include "cylinder_mesh_attribute.hpp"
 #include "cylinder_mesh_builder.hpp"
 #include "gl_vertex_attribs_guard.hpp"
@@ -21,6 +22,19 @@ namespace molphene {
 template<typename = void>
 class basic_cylinder_vertex_buffers_instanced {
 public:
+  using attribs_guard =
+   gl_vertex_attribs_guard<shader_attrib_location::vertex,
+                           shader_attrib_location::normal,
+                           shader_attrib_location::texcoordcolor,
+                           shader_attrib_location::transformation,
+                           shader_attrib_location::transformation_1,
+                           shader_attrib_location::transformation_2,
+                           shader_attrib_location::transformation_3,
+                           shader_attrib_location::next_transformation,
+                           shader_attrib_location::next_transformation_1,
+                           shader_attrib_location::next_transformation_2,
+                           shader_attrib_location::next_transformation_3>;
+
   static constexpr auto cyl_mesh_builder = cylinder_mesh_builder<20>{};
 
   static constexpr auto copy_builder = instance_copy_builder{};
@@ -35,6 +49,15 @@ public:
 
   std::unique_ptr<transforms_instances_buffer_array> buffer_transforms;
 
+  std::unique_ptr<next_transforms_instances_buffer_array>
+   buffer_next_transforms;
+
+  // Where the instances are drawn between the earlier and the later of the
+  // two keyframes held, from 0 to 1.
+  float frame_interpolation{0};
+
+  chunk_vertex_arrays vertex_arrays;
+
   template<typename TRangeCylinderMeshAttr>
   void build_buffers(TRangeCylinderMeshAttr&& cylinder_mesh_attrs)
   {
@@ -52,49 +75,160 @@ public:
     buffer_transforms =
      build_cylinder_mesh_transform_instances(copy_builder, cylinder_mesh_attrs);
 
+    if(color_light_shader::keyframes_supported()) {
+      buffer_next_transforms = build_cylinder_mesh_transform_instances<
+       next_transforms_instances_buffer_array>(copy_builder,
+                                               cylinder_mesh_attrs);
+    }
+
     color_texture = build_shape_color_texture(cylinder_mesh_attrs);
+
+    record_vertex_arrays();
   }
 
-  void draw(const color_light_shader& shader) const noexcept
+  // Every task holds cylinder_mesh_attrs, which the caller makes own these
+  // buffers as well.
+  template<typename TRangeCylinderMeshAttr, typename TUploadQueue>
+  void enqueue_build_buffers(
+   std::shared_ptr<const TRangeCylinderMeshAttr> cylinder_mesh_attrs,
+   TUploadQueue& queue)
   {
-    const auto verts_guard =
-     gl_vertex_attribs_guard<shader_attrib_location::vertex,
-                             shader_attrib_location::normal,
-                             shader_attrib_location::texcoordcolor,
-                             shader_attrib_location::transformation,
-                             shader_attrib_location::transformation_1,
-                             shader_attrib_location::transformation_2,
-                             shader_attrib_location::transformation_3>{};
+    queue.push([this, cylinder_mesh_attrs] {
+      const auto cylinder_attr = std::array<cylinder_mesh_attribute, 1>{};
 
-    {
-      assert(all_has_same_props(*buffer_positions, *buffer_normals));
+      buffer_positions =
+       build_cylinder_mesh_positions(cyl_mesh_builder, cylinder_attr);
 
-      assert(all_has_same_props(*buffer_transforms, *buffer_texcoords));
+      buffer_normals =
+       build_cylinder_mesh_normals(cyl_mesh_builder, cylinder_attr);
+    });
 
-      shader.color_texture_image(color_texture->texture());
+    enqueue_cylinder_mesh_texcoord_instances(
+     queue, buffer_texcoords, copy_builder, cylinder_mesh_attrs);
 
-      const auto size = buffer_transforms->size();
-      const auto remain_instances = buffer_transforms->remain_instances();
-      const auto instances_per_block = buffer_transforms->instances_per_block();
-      const auto verts_per_instance = buffer_positions->verts_per_instance();
+    enqueue_cylinder_mesh_transform_instances(
+     queue, buffer_transforms, copy_builder, cylinder_mesh_attrs);
 
-      buffer_positions->bind_attrib_pointer_index(0);
-      buffer_normals->bind_attrib_pointer_index(0);
+    if(color_light_shader::keyframes_supported()) {
+      enqueue_cylinder_mesh_transform_instances(
+       queue, buffer_next_transforms, copy_builder, cylinder_mesh_attrs);
+    }
 
-      for(auto i = GLsizei{0}; i < size; ++i) {
-        const auto total_instances =
-         GLsizei{i == (size - 1) ? remain_instances : instances_per_block};
+    queue.push([this, cylinder_mesh_attrs] {
+      color_texture = build_shape_color_texture(*cylinder_mesh_attrs);
+    });
+
+    queue.push([this, cylinder_mesh_attrs] { record_vertex_arrays(); });
+  }
+
+  // Moves the instances to the cylinders of cylinder_mesh_attrs, the same
+  // cylinders the buffers were built from. The base mesh, the texcoords and
+  // the color texture are left as they are.
+  template<typename TRangeCylinderMeshAttr>
+  void update_transforms(const TRangeCylinderMeshAttr& cylinder_mesh_attrs)
+  {
+    push_keyframe(cylinder_mesh_attrs);
+    frame_interpolation = 1;
+  }
+
+  // Makes cylinder_mesh_attrs the later keyframe and the later one the
+  // earlier, uploading only the new transforms, over those of the earlier.
+  // Without the next transforms the instances move to each keyframe as it
+  // is pushed.
+  template<typename TRangeCylinderMeshAttr>
+  void push_keyframe(const TRangeCylinderMeshAttr& cylinder_mesh_attrs)
+  {
+    if(!buffer_next_transforms) {
+      update_cylinder_mesh_transform_instances(
+       copy_builder, *buffer_transforms, cylinder_mesh_attrs);
+      return;
+    }
+
+    if(later_is_next_) {
+      update_cylinder_mesh_transform_instances(
+       copy_builder, *buffer_transforms, cylinder_mesh_attrs);
+    } else {
+      update_cylinder_mesh_transform_instances(
+       copy_builder, *buffer_next_transforms, cylinder_mesh_attrs);
+    }
+    later_is_next_ = !later_is_next_;
+  }
+
+  auto size_bytes() const noexcept -> GLsizeiptr
+  {
+    return buffer_size_bytes(buffer_positions) +
+           buffer_size_bytes(buffer_normals) +
+           buffer_size_bytes(buffer_texcoords) +
+           buffer_size_bytes(buffer_transforms) +
+           buffer_size_bytes(buffer_next_transforms) +
+           buffer_size_bytes(color_texture);
+  }
 
-        buffer_texcoords->bind_attrib_pointer_index(i);
-        buffer_transforms->bind_attrib_pointer_index(i);
+  void draw(const color_light_shader& shader) const noexcept
+  {
+    assert(all_has_same_props(*buffer_positions, *buffer_normals));
+    assert(all_has_same_props(*buffer_transforms, *buffer_texcoords));
+    assert(!buffer_next_transforms ||
+           all_has_same_props(*buffer_transforms, *buffer_next_transforms));
 
-        gl::draw_arrays_instanced(
-         GL_TRIANGLE_STRIP, 0, verts_per_instance, total_instances);
+    shader.color_texture_image(color_texture->texture());
+    shader.frame_interpolation(later_is_next_ ? frame_interpolation
+                                              : 1 - frame_interpolation);
+
+    const auto size = buffer_transforms->size();
+
+    if(!vertex_arrays.empty()) {
+      for(auto i = GLsizei{0}; i < size; ++i) {
+        vertex_arrays[i]->bind();
+        draw_chunk(i);
       }
+      gl::vertex_array::unbind();
+      return;
+    }
+
+    const auto verts_guard = attribs_guard{};
+
+    for(auto i = GLsizei{0}; i < size; ++i) {
+      bind_chunk_attribs(i);
+      draw_chunk(i);
     }
   }
 
 private:
+  // The shader weighs the next transforms by the interpolation, so when the
+  // later keyframe sits in the current transforms the weight is reversed.
+  bool later_is_next_{true};
+
+  void record_vertex_arrays()
+  {
+    vertex_arrays = record_chunk_vertex_arrays<attribs_guard>(
+     buffer_transforms->size(),
+     [this](GLsizei index) noexcept { bind_chunk_attribs(index); });
+  }
+
+  void bind_chunk_attribs(GLsizei index) const noexcept
+  {
+    buffer_positions->bind_attrib_pointer_index(0);
+    buffer_normals->bind_attrib_pointer_index(0);
+    buffer_texcoords->bind_attrib_pointer_index(index);
+    buffer_transforms->bind_attrib_pointer_index(index);
+    if(buffer_next_transforms) {
+      buffer_next_transforms->bind_attrib_pointer_index(index);
+    }
+  }
+
+  void draw_chunk(GLsizei index) const noexcept
+  {
+    const auto size = buffer_transforms->size();
+    const auto total_instances =
+     GLsizei{index == (size - 1) ? buffer_transforms->remain_instances()
+                                 : buffer_transforms->instances_per_block()};
+
+    gl::draw_arrays_instanced(GL_TRIANGLE_STRIP,
+                              0,
+                              buffer_positions->verts_per_instance(),
+                              total_instances);
+  }
 };
 
 using cylinder_vertex_buffers_instanced =
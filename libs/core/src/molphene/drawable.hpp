@@ -21,6 +21,11 @@ public:
     model_ptr_->render(shader);
   }
 
+  auto size_bytes() const noexcept -> std::size_t
+  {
+    return model_ptr_->size_bytes();
+  }
+
 private:
   struct basic_concept {
     basic_concept() noexcept = default;
@@ -36,6 +41,8 @@ private:
     virtual ~basic_concept() noexcept = default;
 
     virtual void render(color_light_shader const& shader) const = 0;
+
+    virtual auto size_bytes() const noexcept -> std::size_t = 0;
   };
 
   template<typename T>
@@ -50,6 +57,11 @@ private:
       object_.render(shader);
     }
 
+    auto size_bytes() const noexcept -> std::size_t override
+    {
+      return object_.size_bytes();
+    }
+
   private:
     T object_;
   };
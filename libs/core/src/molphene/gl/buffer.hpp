@@ -3,9 +3,32 @@
 
 #include "../opengl.hpp"
 #include "../stdafx.hpp"
+#include "state_cache.hpp"
+
+#if !defined(__EMSCRIPTEN__) && defined(GL_MAP_PERSISTENT_BIT)
+#define MOLPHENE_GL_BUFFER_STORAGE 1
+#endif
 
 namespace molphene::gl {
 
+// Whether buffers can have immutable storage mapped for as long as they
+// live, which takes OpenGL 4.4.
+inline auto buffer_storage_supported() noexcept -> bool
+{
+#ifdef MOLPHENE_GL_BUFFER_STORAGE
+  static const auto supported = [] {
+    auto major = GLint{0};
+    auto minor = GLint{0};
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    return major > 4 || (major == 4 && minor >= 4);
+  }();
+  return supported;
+#else
+  return false;
+#endif
+}
+
 template<typename TData,
          GLenum VTarget = GL_ARRAY_BUFFER,
          GLenum VUsage = GL_STATIC_DRAW>
@@ -31,12 +54,18 @@ public:
 
   ~buffer() noexcept
   {
+    state().forget_buffer(buffer_);
     glDeleteBuffers(1, &buffer_);
   }
 
   void bind() const noexcept
   {
-    glBindBuffer(target, buffer_);
+    state().bind_buffer(target, buffer_);
+  }
+
+  auto id() const noexcept -> GLuint
+  {
+    return buffer_;
   }
 
   void data(gsl::span<const data_type> cont) noexcept
@@ -53,6 +82,14 @@ public:
     glBufferData(target, size_bytes(), nullptr, usage);
   }
 
+  // Gives the buffer new storage of the same size, so that writing all of
+  // it next does not wait for draws still reading the old storage.
+  void orphan() const noexcept
+  {
+    bind();
+    glBufferData(target, size_bytes(), nullptr, usage);
+  }
+
   auto size() const noexcept -> GLsizeiptr
   {
     return size_;
@@ -72,6 +109,25 @@ public:
                     cont.data());
   }
 
+#ifdef MOLPHENE_GL_BUFFER_STORAGE
+  // Copies size elements to offset out of the bytes of the source buffer
+  // from source_offset on, without the data passing through the CPU.
+  void copy_subdata(GLintptr offset,
+                    GLsizeiptr size,
+                    GLuint source,
+                    GLintptr source_offset) const noexcept
+  {
+    auto& state = gl::state();
+    state.bind_buffer(GL_COPY_READ_BUFFER, source);
+    state.bind_buffer(GL_COPY_WRITE_BUFFER, buffer_);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                        GL_COPY_WRITE_BUFFER,
+                        source_offset,
+                        offset * sizeof(data_type),
+                        size * sizeof(data_type));
+  }
+#endif
+
 private:
   GLuint buffer_{0};
   GLsizeiptr size_{0};
@@ -0,0 +1,39 @@
+#ifndef MOLPHENE_GL_DEPTH_TEXTURE_HPP
+#define MOLPHENE_GL_DEPTH_TEXTURE_HPP
+
+#include "../opengl.hpp"
+
+namespace molphene::gl {
+namespace detail {
+
+#ifdef __EMSCRIPTEN__
+inline auto depth_texture_support = false;
+#else
+inline auto depth_texture_support = true;
+#endif
+
+} // namespace detail
+
+inline auto depth_texture_supported() noexcept -> bool
+{
+  return detail::depth_texture_support;
+}
+
+// Set from the result of enabling WEBGL_depth_texture; desktop GL can always
+// sample depth attachments.
+inline void depth_texture_supported(bool value) noexcept
+{
+  detail::depth_texture_support = value;
+}
+
+// Internal format of a sampleable depth attachment.
+inline constexpr auto depth_texture_internal_format =
+#ifdef __EMSCRIPTEN__
+ GLint{GL_DEPTH_COMPONENT};
+#else
+ GLint{GL_DEPTH_COMPONENT24};
+#endif
+
+} // namespace molphene::gl
+
+#endif
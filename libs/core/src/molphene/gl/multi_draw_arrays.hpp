@@ -0,0 +1,56 @@
+#ifndef MOLPHENE_GL_MULTI_DRAW_ARRAYS_HPP
+#define MOLPHENE_GL_MULTI_DRAW_ARRAYS_HPP
+
+#include "../opengl.hpp"
+
+#if defined(__EMSCRIPTEN__) && __has_include(<webgl/webgl1_ext.h>)
+#include <webgl/webgl1_ext.h>
+#define MOLPHENE_WEBGL_MULTI_DRAW 1
+#endif
+
+namespace molphene::gl {
+namespace detail {
+
+#ifdef __EMSCRIPTEN__
+inline auto multi_draw_support = false;
+#else
+inline auto multi_draw_support = true;
+#endif
+
+} // namespace detail
+
+inline auto multi_draw_supported() noexcept -> bool
+{
+  return detail::multi_draw_support;
+}
+
+// Set from the result of enabling WEBGL_multi_draw; desktop GL always has
+// glMultiDrawArrays.
+inline void multi_draw_supported(bool value) noexcept
+{
+  detail::multi_draw_support = value;
+}
+
+inline void multi_draw_arrays(GLenum mode,
+                              const GLint* firsts,
+                              const GLsizei* counts,
+                              GLsizei drawcount) noexcept
+{
+#ifdef __EMSCRIPTEN__
+#ifdef MOLPHENE_WEBGL_MULTI_DRAW
+  if(multi_draw_supported()) {
+    glMultiDrawArraysWEBGL(mode, firsts, counts, drawcount);
+    return;
+  }
+#endif
+  for(auto i = GLsizei{0}; i < drawcount; ++i) {
+    glDrawArrays(mode, firsts[i], counts[i]);
+  }
+#else
+  glMultiDrawArrays(mode, firsts, counts, drawcount);
+#endif
+}
+
+} // namespace molphene::gl
+
+#endif
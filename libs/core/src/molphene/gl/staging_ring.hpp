@@ -0,0 +1,189 @@
+#ifndef MOLPHENE_GL_STAGING_RING_HPP
+#define MOLPHENE_GL_STAGING_RING_HPP
+
+#include "../opengl.hpp"
+#include "../stdafx.hpp"
+#include "buffer.hpp"
+#include "state_cache.hpp"
+
+#include <deque>
+
+namespace molphene::gl {
+
+// Upload memory mapped for as long as the ring lives, so that any thread can
+// write into it. Regions are handed out in order and fenced once the copies
+// out of them are issued; a region comes back when its fence has signalled,
+// which is only ever polled, never waited on. Without buffer storage the ring
+// is disabled and uploads go through glBufferSubData.
+template<typename = void>
+class basic_staging_ring {
+public:
+  explicit basic_staging_ring(GLsizeiptr size) noexcept
+  {
+#ifdef MOLPHENE_GL_BUFFER_STORAGE
+    if(!buffer_storage_supported()) {
+      return;
+    }
+
+    constexpr auto flags =
+     GLbitfield{GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT};
+
+    glGenBuffers(1, &buffer_);
+    state().bind_buffer(GL_COPY_READ_BUFFER, buffer_);
+    glBufferStorage(GL_COPY_READ_BUFFER, size, nullptr, flags);
+    data_ = static_cast<GLubyte*>(
+     glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, flags));
+    size_ = data_ ? size : 0;
+#endif
+  }
+
+  basic_staging_ring(const basic_staging_ring&) = delete;
+
+  basic_staging_ring(basic_staging_ring&&) = delete;
+
+  auto operator=(const basic_staging_ring&) -> basic_staging_ring& = delete;
+
+  auto operator=(basic_staging_ring&&) -> basic_staging_ring& = delete;
+
+  ~basic_staging_ring() noexcept
+  {
+#ifdef MOLPHENE_GL_BUFFER_STORAGE
+    for(const auto& r : regions_) {
+      if(r.fence) {
+        glDeleteSync(r.fence);
+      }
+    }
+
+    if(buffer_) {
+      state().bind_buffer(GL_COPY_READ_BUFFER, buffer_);
+      glUnmapBuffer(GL_COPY_READ_BUFFER);
+      glDeleteBuffers(1, &buffer_);
+    }
+#endif
+  }
+
+  auto enabled() const noexcept -> bool
+  {
+    return data_ != nullptr;
+  }
+
+  auto id() const noexcept -> GLuint
+  {
+    return buffer_;
+  }
+
+  auto size() const noexcept -> GLsizeiptr
+  {
+    return size_;
+  }
+
+  auto data(GLintptr offset) const noexcept -> void*
+  {
+    assert(enabled() && offset < size_);
+    return data_ + offset;
+  }
+
+  // Offset of a region of size bytes, or nothing while the GPU still copies
+  // out of the space it needs.
+  auto allocate(GLsizeiptr size) noexcept -> std::optional<GLintptr>
+  {
+    assert(enabled());
+
+    constexpr auto alignment = GLsizeiptr{16};
+    size = (size + alignment - 1) / alignment * alignment;
+    assert(size > 0 && size <= size_);
+
+    retire();
+
+    auto offset = GLintptr{0};
+    if(!regions_.empty()) {
+      const auto tail = regions_.front().offset;
+      const auto wrapped = head_ <= tail;
+      if(!wrapped && head_ + size <= size_) {
+        offset = head_;
+      } else if(!wrapped && size <= tail) {
+        offset = 0;
+      } else if(wrapped && head_ + size <= tail) {
+        offset = head_;
+      } else {
+        return std::nullopt;
+      }
+    }
+
+    regions_.push_back({offset, nullptr});
+    head_ = offset + size;
+    return offset;
+  }
+
+  // Fences the copies issued so far out of the region at offset.
+  void fence(GLintptr offset) noexcept
+  {
+#ifdef MOLPHENE_GL_BUFFER_STORAGE
+    const auto it = std::find_if(
+     regions_.rbegin(), regions_.rend(), [offset](const auto& r) noexcept {
+       return r.offset == offset;
+     });
+    assert(it != regions_.rend() && !it->fence);
+
+    it->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+  }
+
+  // Gives back the newest regions, allocated but never copied out of.
+  void discard_unfenced() noexcept
+  {
+    while(!regions_.empty() && !regions_.back().fence) {
+      head_ = regions_.back().offset;
+      regions_.pop_back();
+    }
+  }
+
+private:
+#ifdef MOLPHENE_GL_BUFFER_STORAGE
+  using fence_type = GLsync;
+#else
+  using fence_type = const void*;
+#endif
+
+  struct region {
+    GLintptr offset;
+    fence_type fence;
+  };
+
+  void retire() noexcept
+  {
+#ifdef MOLPHENE_GL_BUFFER_STORAGE
+    while(!regions_.empty() && regions_.front().fence) {
+      const auto status = glClientWaitSync(
+       regions_.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+      if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        break;
+      }
+
+      glDeleteSync(regions_.front().fence);
+      regions_.pop_front();
+    }
+#endif
+
+    if(regions_.empty()) {
+      head_ = 0;
+    }
+  }
+
+  GLuint buffer_{0};
+
+  GLsizeiptr size_{0};
+
+  GLubyte* data_{nullptr};
+
+  // End of the newest region.
+  GLintptr head_{0};
+
+  std::deque<region> regions_;
+};
+
+using staging_ring = basic_staging_ring<void>;
+
+} // namespace molphene::gl
+
+#endif
@@ -0,0 +1,312 @@
+#ifndef MOLPHENE_GL_STATE_CACHE_HPP
+#define MOLPHENE_GL_STATE_CACHE_HPP
+
+#include "../stdafx.hpp"
+
+#include "../opengl.hpp"
+#include "draw_instanced_arrays.hpp"
+
+namespace molphene::gl {
+
+// GL_MAX_VERTEX_ATTRIBS, which WebGL 1 and OpenGL ES 2 only guarantee to be
+// 8, capped at the attributes the state cache tracks.
+inline auto vertex_attribs_limit() noexcept -> GLuint
+{
+  static const auto limit = [] {
+    auto max_attribs = GLint{0};
+    glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &max_attribs);
+    return std::min(static_cast<GLuint>(max_attribs), GLuint{16});
+  }();
+  return limit;
+}
+
+struct state_cache_stats {
+  std::size_t issued{0};
+  std::size_t skipped{0};
+};
+
+// Shadow copy of the GL state the renderer touches, so that binds which would
+// not change anything are never issued. There is one instance for the single
+// context the application renders with; call invalidate() after anything
+// outside this layer changes the same state, or when the context changes.
+template<typename = void>
+class basic_state_cache {
+public:
+  static constexpr auto max_vertex_attribs = std::size_t{16};
+
+  static constexpr auto max_texture_units = std::size_t{8};
+
+  static auto instance() noexcept -> basic_state_cache&
+  {
+    static auto cache = basic_state_cache{};
+    return cache;
+  }
+
+  void bind_buffer(GLenum target, GLuint buffer) noexcept
+  {
+    if(target != GL_ARRAY_BUFFER && target != GL_ELEMENT_ARRAY_BUFFER) {
+      glBindBuffer(target, buffer);
+      count_issued();
+      return;
+    }
+
+    auto& bound = target == GL_ARRAY_BUFFER ? array_buffer_
+                                            : element_array_buffer_;
+    if(bound == buffer) {
+      count_skipped();
+      return;
+    }
+
+    glBindBuffer(target, buffer);
+    bound = buffer;
+    count_issued();
+  }
+
+  void forget_buffer(GLuint buffer) noexcept
+  {
+    if(array_buffer_ == buffer) {
+      array_buffer_ = 0;
+    }
+    if(element_array_buffer_ == buffer) {
+      element_array_buffer_ = 0;
+    }
+    for(auto& pointer : attrib_pointers_) {
+      if(pointer.buffer == buffer) {
+        pointer = attrib_pointer_state{};
+      }
+    }
+  }
+
+  // Returns whether the bind has to be issued. Attribute arrays, pointers and
+  // the element buffer binding belong to the vertex array object, so they
+  // become unknown whenever it changes.
+  auto bind_vertex_array(GLuint vertex_array) noexcept -> bool
+  {
+    if(vertex_array_ == vertex_array) {
+      count_skipped();
+      return false;
+    }
+
+    vertex_array_ = vertex_array;
+    element_array_buffer_ = unknown_object;
+    invalidate_vertex_attribs();
+    count_issued();
+    return true;
+  }
+
+  void forget_vertex_array(GLuint vertex_array) noexcept
+  {
+    if(vertex_array_ == vertex_array) {
+      vertex_array_ = 0;
+      element_array_buffer_ = unknown_object;
+      invalidate_vertex_attribs();
+    }
+  }
+
+  // Leaves exactly the attribute arrays in the mask enabled. Arrays past the
+  // limit of the implementation do not exist and are skipped.
+  void vertex_attrib_arrays(std::uint32_t mask) noexcept
+  {
+    const auto limit = vertex_attribs_limit();
+    for(auto index = GLuint{0}; index < limit; ++index) {
+      const auto bit = std::uint32_t{1} << index;
+      if(enabled_attribs_ && (mask & bit) == (*enabled_attribs_ & bit)) {
+        if(mask & bit) {
+          count_skipped();
+        }
+        continue;
+      }
+
+      if(mask & bit) {
+        glEnableVertexAttribArray(index);
+      } else {
+        glDisableVertexAttribArray(index);
+      }
+      count_issued();
+    }
+
+    enabled_attribs_ = mask;
+  }
+
+  void vertex_attrib_pointer(GLuint buffer,
+                             GLuint index,
+                             GLint size,
+                             GLenum type,
+                             GLboolean normalized,
+                             GLsizei stride,
+                             const GLvoid* pointer,
+                             GLuint divisor) noexcept
+  {
+    assert(index < vertex_attribs_limit());
+
+    const auto state =
+     attrib_pointer_state{buffer, size, type, normalized, stride, pointer};
+    auto& current = attrib_pointers_[index];
+
+    if(current == state) {
+      count_skipped();
+    } else {
+      bind_buffer(GL_ARRAY_BUFFER, buffer);
+      glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+      current = state;
+      count_issued();
+    }
+
+    if(attrib_divisors_[index] == divisor) {
+      count_skipped();
+    } else {
+      gl::vertex_attrib_divisor(index, divisor);
+      attrib_divisors_[index] = divisor;
+      count_issued();
+    }
+  }
+
+  void use_program(GLuint program) noexcept
+  {
+    if(program_ == program) {
+      count_skipped();
+      return;
+    }
+
+    glUseProgram(program);
+    program_ = program;
+    count_issued();
+  }
+
+  void active_texture(GLenum unit) noexcept
+  {
+    if(active_texture_ == unit) {
+      count_skipped();
+      return;
+    }
+
+    glActiveTexture(unit);
+    active_texture_ = unit;
+    count_issued();
+  }
+
+  void bind_texture(GLenum target, GLuint texture) noexcept
+  {
+    const auto unit = static_cast<std::size_t>(active_texture_ - GL_TEXTURE0);
+    if(target != GL_TEXTURE_2D || unit >= max_texture_units) {
+      glBindTexture(target, texture);
+      count_issued();
+      return;
+    }
+
+    if(bound_textures_[unit] == texture) {
+      count_skipped();
+      return;
+    }
+
+    glBindTexture(target, texture);
+    bound_textures_[unit] = texture;
+    count_issued();
+  }
+
+  void forget_texture(GLuint texture) noexcept
+  {
+    for(auto& bound : bound_textures_) {
+      if(bound == texture) {
+        bound = 0;
+      }
+    }
+  }
+
+  // Forget what is known about vertex attribute state, e.g. after a vertex
+  // array object bind swapped it out.
+  void invalidate_vertex_attribs() noexcept
+  {
+    enabled_attribs_.reset();
+    attrib_pointers_.fill(attrib_pointer_state{});
+    attrib_divisors_.fill(unknown_divisor);
+  }
+
+  void invalidate() noexcept
+  {
+    array_buffer_ = unknown_object;
+    element_array_buffer_ = unknown_object;
+    vertex_array_ = unknown_object;
+    program_ = unknown_object;
+    active_texture_ = unknown_object;
+    bound_textures_.fill(unknown_object);
+    invalidate_vertex_attribs();
+  }
+
+  auto stats() const noexcept -> state_cache_stats
+  {
+    return stats_;
+  }
+
+  void reset_stats() noexcept
+  {
+    stats_ = state_cache_stats{};
+  }
+
+  void count_issued() noexcept
+  {
+    ++stats_.issued;
+  }
+
+  void count_skipped() noexcept
+  {
+    ++stats_.skipped;
+  }
+
+private:
+  static constexpr auto unknown_object = ~GLuint{0};
+
+  static constexpr auto unknown_divisor = ~GLuint{0};
+
+  struct attrib_pointer_state {
+    GLuint buffer{unknown_object};
+    GLint size{0};
+    GLenum type{0};
+    GLboolean normalized{GL_FALSE};
+    GLsizei stride{0};
+    const GLvoid* pointer{nullptr};
+
+    auto operator==(const attrib_pointer_state& other) const noexcept -> bool
+    {
+      return buffer == other.buffer && size == other.size &&
+             type == other.type && normalized == other.normalized &&
+             stride == other.stride && pointer == other.pointer;
+    }
+  };
+
+  basic_state_cache() noexcept
+  {
+    invalidate();
+  }
+
+  GLuint array_buffer_;
+
+  GLuint element_array_buffer_;
+
+  GLuint vertex_array_;
+
+  std::optional<std::uint32_t> enabled_attribs_;
+
+  std::array<attrib_pointer_state, max_vertex_attribs> attrib_pointers_;
+
+  std::array<GLuint, max_vertex_attribs> attrib_divisors_;
+
+  GLuint program_;
+
+  GLenum active_texture_;
+
+  std::array<GLuint, max_texture_units> bound_textures_;
+
+  state_cache_stats stats_;
+};
+
+using state_cache = basic_state_cache<void>;
+
+inline auto state() noexcept -> state_cache&
+{
+  return state_cache::instance();
+}
+
+} // namespace molphene::gl
+
+#endif
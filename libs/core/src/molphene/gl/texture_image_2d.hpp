@@ -4,6 +4,7 @@
 #include "../stdafx.hpp"
 
 #include "../opengl.hpp"
+#include "state_cache.hpp"
 
 namespace molphene::gl {
 
@@ -17,7 +18,7 @@ public:
   texture_image_2d() noexcept
   {
     glGenTextures(1, &texture_);
-    glBindTexture(target, texture_);
+    state().bind_texture(target, texture_);
     glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -35,18 +36,19 @@ public:
 
   ~texture_image_2d() noexcept
   {
+    state().forget_texture(texture_);
     glDeleteTextures(1, &texture_);
   }
 
   template<typename TView>
-  void data(TView&& view) const noexcept
+  void data(TView&& view) noexcept
   {
     const auto sqrt = std::sqrt(view.size());
     assert(sqrt == std::floor(sqrt));
 
-    const auto size = static_cast<GLsizei>(sqrt);
-    glBindTexture(target, texture_);
-    glTexImage2D(target, 0, format, size, size, 0, format, type, view.data());
+    size_ = static_cast<GLsizei>(sqrt);
+    state().bind_texture(target, texture_);
+    glTexImage2D(target, 0, format, size_, size_, 0, format, type, view.data());
   }
 
   auto texture() const noexcept -> GLuint
@@ -54,8 +56,18 @@ public:
     return texture_;
   }
 
+  auto size_bytes() const noexcept -> GLsizeiptr
+  {
+    return GLsizeiptr{size_} * size_ * texel_size;
+  }
+
 private:
+  static constexpr auto texel_size =
+   GLsizeiptr{format == GL_RGBA ? 4 : format == GL_RGB ? 3 : 1};
+
   GLuint texture_{0};
+
+  GLsizei size_{0};
 };
 
 } // namespace molphene::gl
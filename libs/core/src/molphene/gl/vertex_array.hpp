@@ -0,0 +1,131 @@
+#ifndef MOLPHENE_GL_VERTEX_ARRAY_HPP
+#define MOLPHENE_GL_VERTEX_ARRAY_HPP
+
+#include "../stdafx.hpp"
+
+#include <cstdlib>
+
+#include "../opengl.hpp"
+#include "state_cache.hpp"
+
+namespace molphene::gl {
+
+// Vertex array object, native on desktop GL 3.0+ or ARB_vertex_array_object,
+// OES_vertex_array_object on WebGL. Check supported() before recording one;
+// callers keep their per-draw attribute setup as the fallback.
+template<typename = void>
+class basic_vertex_array {
+public:
+  basic_vertex_array() noexcept
+  {
+    assert(supported());
+#ifdef __EMSCRIPTEN__
+    glGenVertexArraysOES(1, &vertex_array_);
+#else
+    glGenVertexArrays(1, &vertex_array_);
+#endif
+  }
+
+  basic_vertex_array(const basic_vertex_array&) noexcept = delete;
+
+  basic_vertex_array(basic_vertex_array&&) noexcept = delete;
+
+  auto operator=(const basic_vertex_array&) noexcept
+   -> basic_vertex_array& = delete;
+
+  auto operator=(basic_vertex_array&&) noexcept -> basic_vertex_array& = delete;
+
+  ~basic_vertex_array() noexcept
+  {
+    state().forget_vertex_array(vertex_array_);
+#ifdef __EMSCRIPTEN__
+    glDeleteVertexArraysOES(1, &vertex_array_);
+#else
+    glDeleteVertexArrays(1, &vertex_array_);
+#endif
+  }
+
+  void bind() const noexcept
+  {
+    bind(vertex_array_);
+  }
+
+  static void unbind() noexcept
+  {
+    bind(0);
+  }
+
+  static auto supported() noexcept -> bool
+  {
+    if(!supported_) {
+      supported_ = detect_support();
+    }
+    return *supported_;
+  }
+
+  // Overrides detection, e.g. with the result of enabling the WebGL
+  // extension.
+  static void supported(bool value) noexcept
+  {
+    supported_ = value;
+  }
+
+private:
+  static void bind(GLuint vertex_array) noexcept
+  {
+    if(!state().bind_vertex_array(vertex_array)) {
+      return;
+    }
+
+#ifdef __EMSCRIPTEN__
+    glBindVertexArrayOES(vertex_array);
+#else
+    glBindVertexArray(vertex_array);
+#endif
+  }
+
+  static auto has_extension(std::string_view name) noexcept -> bool
+  {
+    const auto* extensions =
+     reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if(!extensions) {
+      return false;
+    }
+
+    const auto all = std::string_view{extensions};
+    for(auto pos = all.find(name); pos != std::string_view::npos;
+        pos = all.find(name, pos + 1)) {
+      const auto end = pos + name.size();
+      if((pos == 0 || all[pos - 1] == ' ') &&
+         (end == all.size() || all[end] == ' ')) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static auto detect_support() noexcept -> bool
+  {
+#ifdef __EMSCRIPTEN__
+    return has_extension("GL_OES_vertex_array_object") ||
+           has_extension("OES_vertex_array_object");
+#else
+    const auto* version =
+     reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    if(version && std::atoi(version) >= 3) {
+      return true;
+    }
+    return has_extension("GL_ARB_vertex_array_object");
+#endif
+  }
+
+  inline static std::optional<bool> supported_;
+
+  GLuint vertex_array_{0};
+};
+
+using vertex_array = basic_vertex_array<void>;
+
+} // namespace molphene::gl
+
+#endif
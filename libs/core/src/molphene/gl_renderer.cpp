@@ -2,41 +2,22 @@
 #include "molecule_display.hpp"
 #include "shader_attrib_location.hpp"
 
+#if !defined(__EMSCRIPTEN__) && defined(GL_SAMPLES_PASSED)
+#define MOLPHENE_OCCLUSION_QUERY 1
+#endif
+
 namespace molphene {
 
 void gl_renderer::init() noexcept
 {
+  gl::state().invalidate();
+
   glClearColor(0.5, 0.5, 0.5, 1.0);
   glEnable(GL_DEPTH_TEST);
 
-  color_light_shader_.init_program();
-  quad_shader_.init_program();
-
-  glGenFramebuffers(1, &color_light_fbo_);
-
-  glGenTextures(1, &color_light_color_tex_);
-  glBindTexture(GL_TEXTURE_2D, color_light_color_tex_);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-  glGenRenderbuffers(1, &color_light_depth_rbo_);
-
-  glBindFramebuffer(GL_FRAMEBUFFER, color_light_fbo_);
-  glBindTexture(GL_TEXTURE_2D, color_light_color_tex_);
-  glFramebufferTexture2D(GL_FRAMEBUFFER,
-                         GL_COLOR_ATTACHMENT0 + 0,
-                         GL_TEXTURE_2D,
-                         color_light_color_tex_,
-                         0);
-
-  glBindFramebuffer(GL_FRAMEBUFFER, color_light_fbo_);
-  glBindRenderbuffer(GL_RENDERBUFFER, color_light_depth_rbo_);
-  glFramebufferRenderbuffer(GL_FRAMEBUFFER,
-                            GL_DEPTH_ATTACHMENT,
-                            GL_RENDERBUFFER,
-                            color_light_depth_rbo_);
+  color_light_shader_.init_program(&program_cache_);
+  ssao_shader_.init_program(&program_cache_);
+  ssao_composite_shader_.init_program(&program_cache_);
 
   quad_verts_buffer_ =
    std::make_unique<decltype(quad_verts_buffer_)::element_type>();
@@ -44,26 +25,290 @@ void gl_renderer::init() noexcept
    vec2f{-1, 1}, vec2f{-1, -1}, vec2f{1, 1}, vec2f{1, -1}});
 }
 
+void gl_renderer::program_cache_directory(std::string path)
+{
+  program_cache_.directory(std::move(path));
+}
+
 void gl_renderer::change_dimension(std::size_t width,
                                    std::size_t height) noexcept
 {
   viewport_.width = width;
   viewport_.height = height;
+}
+
+auto gl_renderer::post_processing() const noexcept -> bool
+{
+  return ssao_quality_ != ssao_quality::off;
+}
+
+void gl_renderer::ambient_occlusion(ssao_quality quality) noexcept
+{
+  ssao_quality_ = gl::depth_texture_supported() ? quality : ssao_quality::off;
+  if(!post_processing()) {
+    release_offscreen_target();
+  }
+}
+
+auto gl_renderer::ambient_occlusion() const noexcept -> ssao_quality
+{
+  return ssao_quality_;
+}
+
+void gl_renderer::depth_prepass(bool enabled) noexcept
+{
+  depth_prepass_ = enabled;
+}
+
+auto gl_renderer::depth_prepass() const noexcept -> bool
+{
+  return depth_prepass_;
+}
+
+void gl_renderer::overdraw_measurement(bool enabled) noexcept
+{
+#ifdef MOLPHENE_OCCLUSION_QUERY
+  overdraw_measurement_ = enabled;
+  if(!enabled) {
+    last_overdraw_.reset();
+  }
+#else
+  static_cast<void>(enabled);
+#endif
+}
+
+auto gl_renderer::overdraw_measurement() const noexcept -> bool
+{
+  return overdraw_measurement_;
+}
+
+auto gl_renderer::last_overdraw() const noexcept -> std::optional<double>
+{
+  return last_overdraw_;
+}
+
+void gl_renderer::begin_overdraw_query() noexcept
+{
+#ifdef MOLPHENE_OCCLUSION_QUERY
+  if(!overdraw_measurement_) {
+    return;
+  }
+
+  if(overdraw_query_ == 0) {
+    glGenQueries(1, &overdraw_query_);
+  }
+
+  // Never wait for the GPU: keep the previous query until its result is in.
+  if(overdraw_query_pending_) {
+    auto available = GLuint{GL_FALSE};
+    glGetQueryObjectuiv(
+     overdraw_query_, GL_QUERY_RESULT_AVAILABLE, &available);
+    if(!available) {
+      return;
+    }
+
+    auto samples = GLuint{0};
+    glGetQueryObjectuiv(overdraw_query_, GL_QUERY_RESULT, &samples);
+    overdraw_query_pending_ = false;
+
+    const auto pixels = viewport_.width * viewport_.height;
+    if(pixels != 0) {
+      last_overdraw_ = static_cast<double>(samples) / pixels;
+    }
+  }
+
+  glBeginQuery(GL_SAMPLES_PASSED, overdraw_query_);
+  overdraw_query_pending_ = true;
+  overdraw_query_active_ = true;
+#endif
+}
+
+void gl_renderer::end_overdraw_query() noexcept
+{
+#ifdef MOLPHENE_OCCLUSION_QUERY
+  if(overdraw_query_active_) {
+    glEndQuery(GL_SAMPLES_PASSED);
+    overdraw_query_active_ = false;
+  }
+#endif
+}
+
+void gl_renderer::begin_scene_pass() noexcept
+{
+  if(post_processing()) {
+    acquire_offscreen_target();
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, post_processing() ? color_light_fbo_ : 0);
+  glViewport(viewport_.x, viewport_.y, viewport_.width, viewport_.height);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void gl_renderer::end_scene_pass(const mat4<GLfloat>& projection) noexcept
+{
+  if(!post_processing()) {
+    return;
+  }
 
-  glBindTexture(GL_TEXTURE_2D, color_light_color_tex_);
+  glDisable(GL_DEPTH_TEST);
+
+  ambient_occlusion_pass(projection);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(viewport_.x, viewport_.y, viewport_.width, viewport_.height);
+
+  {
+    const auto verts_guard =
+     gl_vertex_attribs_guard<shader_attrib_location::vertex>{};
+
+    ssao_composite_shader_.use_program();
+    ssao_composite_shader_.color_texture_image(color_light_color_tex_);
+    ssao_composite_shader_.depth_texture_image(color_light_depth_tex_);
+    ssao_composite_shader_.occlusion_texture_image(
+     occlusion_tex_, occlusion_width_, occlusion_height_);
+    ssao_composite_shader_.depth_reconstruction(projection);
+
+    quad_verts_buffer_->attrib_pointer();
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+}
+
+void gl_renderer::ambient_occlusion_pass(
+ const mat4<GLfloat>& projection) noexcept
+{
+  const auto settings = ssao_quality_settings(ssao_quality_);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, occlusion_fbo_);
+  glViewport(0, 0, occlusion_width_, occlusion_height_);
+
+  const auto verts_guard =
+   gl_vertex_attribs_guard<shader_attrib_location::vertex>{};
+
+  ssao_shader_.use_program();
+  ssao_shader_.depth_texture_image(color_light_depth_tex_);
+  ssao_shader_.depth_reconstruction(projection);
+  ssao_shader_.ssao_sample_count(settings.sample_count);
+  ssao_shader_.ssao_radius(settings.radius);
+  ssao_shader_.ssao_texel_size(offscreen_width_, offscreen_height_);
+
+  quad_verts_buffer_->attrib_pointer();
+
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void gl_renderer::acquire_offscreen_target() noexcept
+{
+  const auto create_texture = [](GLint filter) noexcept {
+    auto texture = GLuint{0};
+    glGenTextures(1, &texture);
+    gl::state().bind_texture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+  };
+
+  if(color_light_fbo_ == 0) {
+    glGenFramebuffers(1, &color_light_fbo_);
+    color_light_color_tex_ = create_texture(GL_NEAREST);
+    color_light_depth_tex_ = create_texture(GL_NEAREST);
+
+    glGenFramebuffers(1, &occlusion_fbo_);
+    occlusion_tex_ = create_texture(GL_NEAREST);
+
+    offscreen_width_ = 0;
+    offscreen_height_ = 0;
+  }
+
+  if(offscreen_width_ == viewport_.width &&
+     offscreen_height_ == viewport_.height) {
+    return;
+  }
+
+  offscreen_width_ = viewport_.width;
+  offscreen_height_ = viewport_.height;
+
+  gl::state().bind_texture(GL_TEXTURE_2D, color_light_color_tex_);
+  glTexImage2D(GL_TEXTURE_2D,
+               0,
+               GL_RGBA,
+               offscreen_width_,
+               offscreen_height_,
+               0,
+               GL_RGBA,
+               GL_UNSIGNED_BYTE,
+               nullptr);
+
+  gl::state().bind_texture(GL_TEXTURE_2D, color_light_depth_tex_);
+  glTexImage2D(GL_TEXTURE_2D,
+               0,
+               gl::depth_texture_internal_format,
+               offscreen_width_,
+               offscreen_height_,
+               0,
+               GL_DEPTH_COMPONENT,
+               GL_UNSIGNED_INT,
+               nullptr);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, color_light_fbo_);
+  glFramebufferTexture2D(GL_FRAMEBUFFER,
+                         GL_COLOR_ATTACHMENT0 + 0,
+                         GL_TEXTURE_2D,
+                         color_light_color_tex_,
+                         0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER,
+                         GL_DEPTH_ATTACHMENT,
+                         GL_TEXTURE_2D,
+                         color_light_depth_tex_,
+                         0);
+
+  occlusion_width_ =
+   std::max(std::size_t{1}, offscreen_width_ / ssao_resolution_divisor);
+  occlusion_height_ =
+   std::max(std::size_t{1}, offscreen_height_ / ssao_resolution_divisor);
+
+  gl::state().bind_texture(GL_TEXTURE_2D, occlusion_tex_);
   glTexImage2D(GL_TEXTURE_2D,
                0,
                GL_RGBA,
-               viewport_.width,
-               viewport_.height,
+               occlusion_width_,
+               occlusion_height_,
                0,
                GL_RGBA,
                GL_UNSIGNED_BYTE,
                nullptr);
 
-  glBindRenderbuffer(GL_RENDERBUFFER, color_light_depth_rbo_);
-  glRenderbufferStorage(
-   GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, viewport_.width, viewport_.height);
+  glBindFramebuffer(GL_FRAMEBUFFER, occlusion_fbo_);
+  glFramebufferTexture2D(GL_FRAMEBUFFER,
+                         GL_COLOR_ATTACHMENT0 + 0,
+                         GL_TEXTURE_2D,
+                         occlusion_tex_,
+                         0);
+}
+
+void gl_renderer::release_offscreen_target() noexcept
+{
+  if(color_light_fbo_ == 0) {
+    return;
+  }
+
+  for(const auto texture :
+      {color_light_color_tex_, color_light_depth_tex_, occlusion_tex_}) {
+    gl::state().forget_texture(texture);
+    glDeleteTextures(1, &texture);
+  }
+  glDeleteFramebuffers(1, &color_light_fbo_);
+  glDeleteFramebuffers(1, &occlusion_fbo_);
+
+  color_light_fbo_ = 0;
+  color_light_depth_tex_ = 0;
+  color_light_color_tex_ = 0;
+  occlusion_fbo_ = 0;
+  occlusion_tex_ = 0;
 }
 
 } // namespace molphene
@@ -4,10 +4,14 @@
 #include "stdafx.hpp"
 
 #include "color_light_shader.hpp"
+#include "gl/depth_texture.hpp"
 #include "gl_vertex_attribs_guard.hpp"
 #include "m3d.hpp"
-#include "quad_shader.hpp"
+#include "program_binary_cache.hpp"
 #include "scene.hpp"
+#include "ssao_composite_shader.hpp"
+#include "ssao_quality.hpp"
+#include "ssao_shader.hpp"
 #include "vertex_attribs_buffer.hpp"
 #include "viewport.hpp"
 
@@ -24,6 +28,8 @@ public:
 
   void init() noexcept;
 
+  void program_cache_directory(std::string path);
+
   template<typename TDrawableRange, typename TCamera>
   void render(const Scene& scene,
               const TCamera& camera,
@@ -32,18 +38,11 @@ public:
     using mat3f = typename Scene::mat3f;
     using mat4f = typename Scene::mat4f;
 
-    constexpr auto color_buff_bit =
-     static_cast<GLbitfield>(GL_COLOR_BUFFER_BIT);
-    constexpr auto depth_buff_bit =
-     static_cast<GLbitfield>(GL_DEPTH_BUFFER_BIT);
-
     const auto mv_matrix = scene.model_matrix() * camera.view_matrix();
     const auto norm_matrix = mat3f{mat4f{mv_matrix}.inverse().transpose()};
     const auto proj_matrix = camera.projection_matrix();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, color_light_fbo_);
-    glViewport(viewport_.x, viewport_.y, viewport_.width, viewport_.height);
-    glClear(color_buff_bit | depth_buff_bit);
+    begin_scene_pass();
 
     {
       color_light_shader_.use_program();
@@ -58,47 +57,122 @@ public:
       color_light_shader_.fog(scene.fog());
       color_light_shader_.material(scene.material());
 
+      if(depth_prepass_) {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        color_light_shader_.depth_only(true);
+        for(auto&& drawable_v : drawables) {
+          drawable_v.render(color_light_shader_);
+        }
+
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_LEQUAL);
+      }
+
+      color_light_shader_.depth_only(false);
+      begin_overdraw_query();
       for(auto&& drawable_v : drawables) {
         drawable_v.render(color_light_shader_);
       }
+      end_overdraw_query();
+
+      if(depth_prepass_) {
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+      }
     }
 
-    glFlush();
+    end_scene_pass(mat4f{proj_matrix});
+  }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(viewport_.x, viewport_.y, viewport_.width, viewport_.height);
-    glClear(color_buff_bit | depth_buff_bit);
+  void change_dimension(std::size_t width, std::size_t height) noexcept;
 
-    {
-      const auto verts_guard =
-       gl_vertex_attribs_guard<shader_attrib_location::vertex>{};
+  // Whether the scene goes through an offscreen target for post-processing
+  // passes to read. Otherwise it renders straight into the default
+  // framebuffer and the target is not allocated.
+  auto post_processing() const noexcept -> bool;
 
-      quad_shader_.use_program();
-      quad_shader_.color_texture_image(color_light_color_tex_);
+  // Screen-space ambient occlusion; needs sampleable depth textures, and stays
+  // off without them.
+  void ambient_occlusion(ssao_quality quality) noexcept;
 
-      quad_verts_buffer_->attrib_pointer();
+  auto ambient_occlusion() const noexcept -> ssao_quality;
 
-      glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    }
-    glFlush();
-  }
+  // Lays down depth in a first pass with shading disabled, so that the lit
+  // pass shades each pixel once.
+  void depth_prepass(bool enabled) noexcept;
 
-  void change_dimension(std::size_t width, std::size_t height) noexcept;
+  auto depth_prepass() const noexcept -> bool;
+
+  // Counts the samples passing the depth test in the lit pass. Unavailable
+  // without occlusion queries, i.e. on WebGL 1.
+  void overdraw_measurement(bool enabled) noexcept;
+
+  auto overdraw_measurement() const noexcept -> bool;
+
+  // Shaded samples per pixel of the latest finished measurement.
+  auto last_overdraw() const noexcept -> std::optional<double>;
 
 private:
+  void begin_scene_pass() noexcept;
+
+  void end_scene_pass(const mat4<GLfloat>& projection) noexcept;
+
+  void ambient_occlusion_pass(const mat4<GLfloat>& projection) noexcept;
+
+  // Creates the offscreen targets on first use and resizes them when the
+  // viewport changed since the last frame.
+  void acquire_offscreen_target() noexcept;
+
+  void release_offscreen_target() noexcept;
+
+  void begin_overdraw_query() noexcept;
+
+  void end_overdraw_query() noexcept;
+
   GLuint color_light_fbo_{0};
 
-  GLuint color_light_depth_rbo_{0};
+  GLuint color_light_depth_tex_{0};
 
   GLuint color_light_color_tex_{0};
 
+  GLuint occlusion_fbo_{0};
+
+  GLuint occlusion_tex_{0};
+
   std::unique_ptr<vertex_attribs_buffer> quad_verts_buffer_;
 
   color_light_shader color_light_shader_;
 
-  quad_shader quad_shader_;
+  ssao_shader ssao_shader_;
+
+  ssao_composite_shader ssao_composite_shader_;
+
+  program_binary_cache program_cache_;
 
   viewport_type viewport_;
+
+  ssao_quality ssao_quality_{ssao_quality::off};
+
+  std::size_t offscreen_width_{0};
+
+  std::size_t offscreen_height_{0};
+
+  std::size_t occlusion_width_{0};
+
+  std::size_t occlusion_height_{0};
+
+  bool depth_prepass_{false};
+
+  bool overdraw_measurement_{false};
+
+  GLuint overdraw_query_{0};
+
+  bool overdraw_query_pending_{false};
+
+  bool overdraw_query_active_{false};
+
+  std::optional<double> last_overdraw_;
 };
 
 } // namespace molphene
@@ -0,0 +1,166 @@
+#ifndef MOLPHENE_GL_UPLOAD_QUEUE_HPP
+#define MOLPHENE_GL_UPLOAD_QUEUE_HPP
+
+#include "stdafx.hpp"
+
+#include "gl/staging_ring.hpp"
+
+#include <chrono>
+#include <deque>
+#include <future>
+#include <thread>
+
+namespace molphene {
+
+// Tasks that must run on the thread owning the GL context, drained a little
+// every frame. Whoever pushes a task keeps the objects it references alive
+// until the task has run or the queue has been cleared.
+template<typename = void>
+class basic_gl_upload_queue {
+public:
+  using task_type = std::function<void()>;
+
+  using clock_type = std::chrono::steady_clock;
+
+  static constexpr auto staging_ring_bytes = GLsizeiptr{1024 * 1024 * 64};
+
+  void push(task_type task)
+  {
+    push_until([task = std::move(task)] {
+      task();
+      return true;
+    });
+  }
+
+  // Runs the task every time the queue is drained until it returns true,
+  // holding back the tasks after it meanwhile.
+  void push_until(std::function<bool()> task)
+  {
+    tasks_.push_back(std::move(task));
+    ++total_tasks_;
+  }
+
+  // Runs the work on a worker thread, so it must not touch GL. The tasks
+  // after it wait for it without blocking the drain. Without thread support
+  // the work runs inline.
+  void push_async(task_type work)
+  {
+    push([this, work = std::move(work)]() mutable {
+#ifdef __EMSCRIPTEN__
+      work();
+#else
+      pending_ = std::async(std::launch::async, std::move(work));
+#endif
+    });
+  }
+
+  // Upload memory shared by the tasks, made on first use from the GL thread.
+  auto staging_ring() -> gl::staging_ring&
+  {
+    if(!staging_ring_) {
+      staging_ring_ = std::make_unique<gl::staging_ring>(staging_ring_bytes);
+    }
+    return *staging_ring_;
+  }
+
+  auto run_for(clock_type::duration budget) -> std::size_t
+  {
+    const auto now = clock_type::now();
+    const auto deadline = budget < clock_type::time_point::max() - now
+                           ? now + budget
+                           : clock_type::time_point::max();
+
+    auto executed = std::size_t{0};
+    while(true) {
+      if(pending_.valid()) {
+        if(pending_.wait_for(clock_type::duration::zero()) !=
+           std::future_status::ready) {
+          break;
+        }
+        pending_.get();
+      }
+
+      if(tasks_.empty()) {
+        break;
+      }
+
+      auto task = std::move(tasks_.front());
+      tasks_.pop_front();
+
+      if(!task()) {
+        tasks_.push_front(std::move(task));
+        break;
+      }
+      ++executed;
+      ++completed_tasks_;
+
+      if(clock_type::now() >= deadline) {
+        break;
+      }
+    }
+
+    if(empty()) {
+      total_tasks_ = completed_tasks_ = 0;
+    }
+
+    return executed;
+  }
+
+  // Keeps draining until the tasks waiting on work or on the GPU are done.
+  void run_all()
+  {
+    while(!empty()) {
+      run_for(clock_type::duration::max());
+      if(!empty()) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // Waits for the work running on a worker thread, which still references
+  // the objects of its tasks.
+  void clear() noexcept
+  {
+    if(pending_.valid()) {
+      pending_.wait();
+      pending_ = {};
+    }
+
+    tasks_.clear();
+    total_tasks_ = completed_tasks_ = 0;
+
+    if(staging_ring_) {
+      staging_ring_->discard_unfenced();
+    }
+  }
+
+  auto empty() const noexcept -> bool
+  {
+    return tasks_.empty() && !pending_.valid();
+  }
+
+  auto progress() const noexcept -> double
+  {
+    return total_tasks_ ? static_cast<double>(completed_tasks_) / total_tasks_
+                        : 1.;
+  }
+
+private:
+  std::deque<std::function<bool()>> tasks_;
+
+  std::unique_ptr<gl::staging_ring> staging_ring_;
+
+  // Declared last, so that a destroyed queue waits for the work before
+  // letting go of the tasks and of the memory the work writes into.
+  std::future<void> pending_;
+
+  std::size_t total_tasks_{0};
+
+  std::size_t completed_tasks_{0};
+};
+
+using gl_upload_queue = basic_gl_upload_queue<void>;
+
+} // namespace molphene
+
+#endif
@@ -1,17 +1,24 @@
 #ifndef MOLPHENE_GL_VERTEX_ATTRIBS_GUARD_HPP
 #define MOLPHENE_GL_VERTEX_ATTRIBS_GUARD_HPP
 
+#include "gl/state_cache.hpp"
 #include "opengl.hpp"
 #include "shader_attrib_location.hpp"
 
 namespace molphene {
 
+// Leaves exactly the listed attribute arrays enabled for the draws in its
+// scope. They are not disabled afterwards; the next guard only toggles the
+// arrays whose state differs.
 template<shader_attrib_location... locations>
 class gl_vertex_attribs_guard {
 public:
+  static constexpr auto mask =
+   ((std::uint32_t{1} << static_cast<GLuint>(locations)) | ... | 0U);
+
   gl_vertex_attribs_guard() noexcept
   {
-    (glEnableVertexAttribArray(static_cast<GLuint>(locations)), ...);
+    gl::state().vertex_attrib_arrays(mask);
   }
 
   gl_vertex_attribs_guard(const gl_vertex_attribs_guard&) noexcept = delete;
@@ -24,10 +31,7 @@ public:
   auto operator=(gl_vertex_attribs_guard&&) noexcept
    -> gl_vertex_attribs_guard& = delete;
 
-  ~gl_vertex_attribs_guard() noexcept
-  {
-    (glDisableVertexAttribArray(static_cast<GLuint>(locations)), ...);
-  }
+  ~gl_vertex_attribs_guard() noexcept = default;
 };
 
 } // namespace molphene
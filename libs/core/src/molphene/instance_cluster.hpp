@@ -0,0 +1,276 @@
+#ifndef MOLPHENE_INSTANCE_CLUSTER_HPP
+#define MOLPHENE_INSTANCE_CLUSTER_HPP
+
+#include "stdafx.hpp"
+
+#include <numeric>
+
+#include "attribs_buffer_array.hpp"
+#include "cylinder_mesh_attribute.hpp"
+#include "gl/multi_draw_arrays.hpp"
+#include "m3d.hpp"
+#include "ribbon_mesh_attribute.hpp"
+#include "sphere_mesh_attribute.hpp"
+
+namespace molphene {
+
+// Bounding sphere of a run of consecutive instances inside one buffer chunk.
+struct instance_cluster {
+  vec3<GLfloat> center;
+  GLfloat radius;
+  GLsizei chunk;
+  instance_range range;
+};
+
+inline auto shape_bounding_sphere(const sphere_mesh_attribute& attr) noexcept
+ -> Sphere<double>
+{
+  return attr.sphere;
+}
+
+inline auto shape_bounding_sphere(const cylinder_mesh_attribute& attr) noexcept
+ -> Sphere<double>
+{
+  const auto& cylinder = attr.cylinder;
+  const auto half_axis = (cylinder.top - cylinder.bottom) / 2;
+  return Sphere<double>{half_axis.magnitude() + cylinder.radius,
+                        cylinder.bottom + half_axis};
+}
+
+// The segment stays inside the convex hull of its Bezier control points.
+inline auto shape_bounding_sphere(const ribbon_mesh_attribute& attr) noexcept
+ -> Sphere<double>
+{
+  const auto& points = attr.points;
+  const auto center = (points[1] + points[2]) / 2;
+  const auto controls = std::array<vec3<double>, 4>{
+   points[1],
+   points[1] + (points[2] - points[0]) / 6,
+   points[2] - (points[3] - points[1]) / 6,
+   points[2]};
+
+  auto radius = 0.;
+  for(const auto& control : controls) {
+    radius = std::max(radius, (control - center).magnitude());
+  }
+  return Sphere<double>{radius + attr.width / 2, center};
+}
+
+template<typename TShapeMeshSizedRange>
+auto build_instance_clusters(const TShapeMeshSizedRange& shape_attrs,
+                             GLsizei instances_per_block)
+ -> std::vector<instance_cluster>
+{
+  constexpr auto max_cluster_instances = GLsizei{256};
+
+  const auto total_instances = static_cast<GLsizei>(shape_attrs.size());
+
+  auto clusters = std::vector<instance_cluster>{};
+  if(instances_per_block <= 0) {
+    return clusters;
+  }
+  clusters.reserve(total_instances / max_cluster_instances + 1);
+
+  auto attr_it = std::begin(shape_attrs);
+  for(auto first = GLsizei{0}; first < total_instances;) {
+    const auto chunk = first / instances_per_block;
+    const auto chunk_last =
+     std::min(total_instances, (chunk + 1) * instances_per_block);
+    const auto last = std::min(first + max_cluster_instances, chunk_last);
+
+    auto spheres = std::array<Sphere<double>, max_cluster_instances>{};
+    auto center = vec3<double>{0, 0, 0};
+    for(auto i = first; i < last; ++i, ++attr_it) {
+      spheres[i - first] = shape_bounding_sphere(*attr_it);
+      center += spheres[i - first].center;
+    }
+    center /= (last - first);
+
+    auto radius = 0.;
+    for(auto i = first; i < last; ++i) {
+      const auto& sphere = spheres[i - first];
+      radius =
+       std::max(radius, (sphere.center - center).magnitude() + sphere.radius);
+    }
+
+    clusters.push_back({vec3<GLfloat>{static_cast<GLfloat>(center.x()),
+                                      static_cast<GLfloat>(center.y()),
+                                      static_cast<GLfloat>(center.z())},
+                        static_cast<GLfloat>(radius),
+                        chunk,
+                        {first, last - first}});
+
+    first = last;
+  }
+
+  return clusters;
+}
+
+// Orders cluster indices nearest first by view-space depth, keeping the
+// clusters of a chunk together so that each chunk is bound once.
+template<typename TMat4>
+void order_front_to_back(const std::vector<instance_cluster>& clusters,
+                         const TMat4& modelview,
+                         std::vector<std::size_t>& order)
+{
+  const auto* m = static_cast<const GLfloat*>(modelview.m);
+  const auto view_distance = [m](const instance_cluster& cluster) noexcept {
+    const auto& c = cluster.center;
+    return -(m[2] * c.x() + m[6] * c.y() + m[10] * c.z() + m[14]) -
+           cluster.radius;
+  };
+
+  order.resize(clusters.size());
+  std::iota(order.begin(), order.end(), std::size_t{0});
+  std::sort(order.begin(), order.end(), [&](auto lhs, auto rhs) noexcept {
+    return view_distance(clusters[lhs]) < view_distance(clusters[rhs]);
+  });
+
+  if(clusters.empty() || clusters.back().chunk == 0) {
+    return;
+  }
+
+  auto chunk_rank = std::vector<std::size_t>(
+   clusters.back().chunk + 1, std::numeric_limits<std::size_t>::max());
+  auto rank = std::size_t{0};
+  for(auto index : order) {
+    auto& chunk = chunk_rank[clusters[index].chunk];
+    if(chunk == std::numeric_limits<std::size_t>::max()) {
+      chunk = rank++;
+    }
+  }
+
+  std::stable_sort(
+   order.begin(), order.end(), [&](auto lhs, auto rhs) noexcept {
+     return chunk_rank[clusters[lhs].chunk] < chunk_rank[clusters[rhs].chunk];
+   });
+}
+
+// Draws instance ranges out of the chunks of a vertex buffer array with one
+// multi-draw call per chunk. Ranges that touch are merged, since the strips
+// of consecutive instances are joined by degenerate triangles. The vertex
+// ranges are kept between draws so that drawing does not allocate.
+class chunk_multi_draw {
+public:
+  // Draws the clusters nearest first, calling bind_chunk(chunk) before the
+  // draw of each chunk. Without multi-draw every range costs a draw call, so
+  // the clusters of a chunk are drawn in buffer order to merge them instead.
+  template<typename TBufferArray, typename TMat4, typename TBindChunk>
+  void draw_clusters(GLenum mode,
+                     const TBufferArray& buffer,
+                     const std::vector<instance_cluster>& clusters,
+                     const TMat4& modelview,
+                     TBindChunk bind_chunk)
+  {
+    order_front_to_back(clusters, modelview, order_);
+
+    const auto instances_per_block = buffer.instances_per_block();
+    const auto verts_per_instance = buffer.verts_per_instance();
+
+    for(auto it = order_.begin(); it != order_.end();) {
+      const auto chunk = clusters[*it].chunk;
+      const auto chunk_end =
+       std::find_if(it, order_.end(), [&](auto index) noexcept {
+         return clusters[index].chunk != chunk;
+       });
+
+      // Clusters are built in buffer order.
+      if(!gl::multi_draw_supported()) {
+        std::sort(it, chunk_end);
+      }
+
+      const auto chunk_first = chunk * instances_per_block;
+
+      clear();
+      for(; it != chunk_end; ++it) {
+        const auto& range = clusters[*it].range;
+        push((range.first - chunk_first) * verts_per_instance,
+             range.count * verts_per_instance);
+      }
+
+      bind_chunk(chunk);
+      draw(mode);
+    }
+  }
+
+  // Draws sorted, non-overlapping instance ranges, calling bind_chunk(chunk)
+  // before the draw of each chunk they touch.
+  template<typename TBufferArray, typename TBindChunk>
+  void draw_ranges(GLenum mode,
+                   const TBufferArray& buffer,
+                   gsl::span<const instance_range> ranges,
+                   TBindChunk bind_chunk)
+  {
+    const auto size = buffer.size();
+    const auto remain_instances = buffer.remain_instances();
+    const auto instances_per_block = buffer.instances_per_block();
+    const auto verts_per_instance = buffer.verts_per_instance();
+
+    auto range_it = ranges.begin();
+    for(auto i = GLsizei{0}; i < size && range_it != ranges.end(); ++i) {
+      const auto chunk_first = i * instances_per_block;
+      const auto chunk_last =
+       chunk_first + (i == (size - 1) ? remain_instances : instances_per_block);
+
+      clear();
+      for(; range_it != ranges.end() && range_it->first < chunk_last;
+          ++range_it) {
+        const auto range_last = range_it->first + range_it->count;
+        const auto first = std::max(range_it->first, chunk_first);
+        const auto last = std::min(range_last, chunk_last);
+
+        if(first < last) {
+          push((first - chunk_first) * verts_per_instance,
+               (last - first) * verts_per_instance);
+        }
+
+        if(range_last > chunk_last) {
+          break;
+        }
+      }
+
+      if(counts_.empty()) {
+        continue;
+      }
+
+      bind_chunk(i);
+      draw(mode);
+    }
+  }
+
+private:
+  void clear() noexcept
+  {
+    firsts_.clear();
+    counts_.clear();
+  }
+
+  void push(GLint first, GLsizei count)
+  {
+    if(!counts_.empty() && firsts_.back() + counts_.back() == first) {
+      counts_.back() += count;
+      return;
+    }
+
+    firsts_.push_back(first);
+    counts_.push_back(count);
+  }
+
+  void draw(GLenum mode) const noexcept
+  {
+    gl::multi_draw_arrays(mode,
+                          firsts_.data(),
+                          counts_.data(),
+                          static_cast<GLsizei>(counts_.size()));
+  }
+
+  std::vector<std::size_t> order_;
+
+  std::vector<GLint> firsts_;
+
+  std::vector<GLsizei> counts_;
+};
+
+} // namespace molphene
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef MOLPHENE_LOADING_PROGRESS_HPP
+#define MOLPHENE_LOADING_PROGRESS_HPP
+
+namespace molphene {
+
+enum class loading_stage {
+  idle,
+  preparing,
+  uploading,
+  finished,
+  cancelled,
+  failed
+};
+
+struct loading_progress {
+  loading_stage stage{loading_stage::idle};
+  double fraction{0};
+};
+
+} // namespace molphene
+
+#endif
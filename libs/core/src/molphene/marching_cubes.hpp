@@ -0,0 +1,144 @@
+#ifndef MOLPHENE_MARCHING_CUBES_HPP
+#define MOLPHENE_MARCHING_CUBES_HPP
+
+#include "stdafx.hpp"
+
+namespace molphene::marching_cubes {
+
+// Cube corners as x, y, z offsets, numbered counter-clockwise around the
+// bottom face and then the top face.
+inline constexpr std::array<std::array<std::uint8_t, 3>, 8> corner_offsets{{
+ {0, 0, 0},
+ {1, 0, 0},
+ {1, 1, 0},
+ {0, 1, 0},
+ {0, 0, 1},
+ {1, 0, 1},
+ {1, 1, 1},
+ {0, 1, 1},
+}};
+
+inline constexpr std::array<std::array<std::uint8_t, 2>, 12> edge_corners{{
+ {0, 1},
+ {1, 2},
+ {2, 3},
+ {3, 0},
+ {4, 5},
+ {5, 6},
+ {6, 7},
+ {7, 4},
+ {0, 4},
+ {1, 5},
+ {2, 6},
+ {3, 7},
+}};
+
+// Corners of each face, counter-clockwise as seen from outside the cube.
+inline constexpr std::array<std::array<std::uint8_t, 4>, 6> face_corners{{
+ {0, 3, 2, 1},
+ {4, 5, 6, 7},
+ {0, 1, 5, 4},
+ {2, 3, 7, 6},
+ {0, 4, 7, 3},
+ {1, 2, 6, 5},
+}};
+
+inline constexpr auto max_case_triangles = std::size_t{5};
+
+// Edges holding the triangle vertices of one corner configuration, three per
+// triangle, wound counter-clockwise seen from the outside of the surface.
+struct case_triangles {
+  std::array<std::uint8_t, max_case_triangles * 3> edges{};
+  std::uint8_t count{0};
+};
+
+constexpr auto corner_edge(std::uint8_t first, std::uint8_t second) noexcept
+ -> std::uint8_t
+{
+  for(auto edge = std::uint8_t{0}; edge < edge_corners.size(); ++edge) {
+    const auto& corners = edge_corners[edge];
+    if((corners[0] == first && corners[1] == second) ||
+       (corners[0] == second && corners[1] == first)) {
+      return edge;
+    }
+  }
+  return 0;
+}
+
+// Builds the triangles of a case from its cube faces: on every face each run
+// of inside corners is cut off by a segment from the edge entering the run to
+// the edge leaving it. Neighbouring cubes see the same corners on a shared
+// face, so the surface has no cracks, and chaining the segments gives closed
+// loops that are triangulated as fans.
+constexpr auto make_case_triangles(std::uint8_t inside_mask) noexcept
+ -> case_triangles
+{
+  constexpr auto no_edge = std::uint8_t{0xff};
+
+  const auto inside = [inside_mask](std::uint8_t corner) noexcept {
+    return ((inside_mask >> corner) & 1) != 0;
+  };
+
+  auto next_edge = std::array<std::uint8_t, 12>{};
+  for(auto& edge : next_edge) {
+    edge = no_edge;
+  }
+
+  for(const auto& face : face_corners) {
+    for(auto k = std::size_t{0}; k < face.size(); ++k) {
+      const auto from = face[k];
+      const auto to = face[(k + 1) % face.size()];
+      if(inside(from) || !inside(to)) {
+        continue;
+      }
+
+      auto last = (k + 1) % face.size();
+      while(inside(face[(last + 1) % face.size()])) {
+        last = (last + 1) % face.size();
+      }
+
+      next_edge[corner_edge(from, to)] =
+       corner_edge(face[last], face[(last + 1) % face.size()]);
+    }
+  }
+
+  auto result = case_triangles{};
+  auto visited = std::array<bool, 12>{};
+  for(auto start = std::uint8_t{0}; start < next_edge.size(); ++start) {
+    if(next_edge[start] == no_edge || visited[start]) {
+      continue;
+    }
+
+    visited[start] = true;
+    auto previous = next_edge[start];
+    visited[previous] = true;
+    for(auto edge = next_edge[previous]; edge != start;
+        edge = next_edge[edge]) {
+      visited[edge] = true;
+      result.edges[result.count * 3 + 0] = start;
+      result.edges[result.count * 3 + 1] = previous;
+      result.edges[result.count * 3 + 2] = edge;
+      ++result.count;
+      previous = edge;
+    }
+  }
+
+  return result;
+}
+
+constexpr auto make_triangle_table() noexcept
+ -> std::array<case_triangles, 256>
+{
+  auto table = std::array<case_triangles, 256>{};
+  for(auto mask = std::size_t{0}; mask < table.size(); ++mask) {
+    table[mask] = make_case_triangles(static_cast<std::uint8_t>(mask));
+  }
+  return table;
+}
+
+// Indexed by the mask of corners inside the surface, bit i for corner i.
+inline constexpr auto triangle_table = make_triangle_table();
+
+} // namespace molphene::marching_cubes
+
+#endif
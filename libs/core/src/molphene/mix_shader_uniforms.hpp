@@ -3,6 +3,7 @@
 
 #include "stdafx.hpp"
 
+#include "gl/state_cache.hpp"
 #include "m3d.hpp"
 #include "opengl.hpp"
 
@@ -14,6 +15,43 @@
 #include "material.hpp"
 
 namespace molphene {
+namespace detail {
+
+// Last value uploaded to a uniform, so that setting it again is skipped.
+template<typename T, std::size_t N>
+class uniform_value_cache {
+public:
+  auto update(const T* values) noexcept -> bool
+  {
+    if(valid_ && std::equal(values, values + N, values_.begin())) {
+      gl::state().count_skipped();
+      return false;
+    }
+
+    std::copy_n(values, N, values_.begin());
+    valid_ = true;
+    gl::state().count_issued();
+    return true;
+  }
+
+  auto update(T value) noexcept -> bool
+  {
+    static_assert(N == 1);
+    return update(&value);
+  }
+
+  void reset() noexcept
+  {
+    valid_ = false;
+  }
+
+private:
+  std::array<T, N> values_{};
+
+  bool valid_{false};
+};
+
+} // namespace detail
 
 template<typename TShader>
 class model_view_matrix_uniform {
@@ -32,12 +70,23 @@ public:
     auto program = accessor::call_gprogram(static_cast<const TShader*>(this));
     modelview_matrix_location_ =
      glGetUniformLocation(program, "u_ModelViewMatrix");
+    modelview_matrix_cache_.reset();
   }
 
   void modelview_matrix(const mat4f& m4) const noexcept
   {
-    glUniformMatrix4fv(
-     modelview_matrix_location_, 1, GL_FALSE, static_cast<const float*>(m4.m));
+    modelview_matrix_ = m4;
+
+    const auto* values = static_cast<const float*>(m4.m);
+    if(modelview_matrix_cache_.update(values)) {
+      glUniformMatrix4fv(modelview_matrix_location_, 1, GL_FALSE, values);
+    }
+  }
+
+  // Last model view matrix set, for drawables that order work by depth.
+  auto modelview_matrix() const noexcept -> const mat4f&
+  {
+    return modelview_matrix_;
   }
 
   template<typename U,
@@ -49,6 +98,10 @@ public:
 
 private:
   GLint modelview_matrix_location_{-1};
+
+  mutable mat4f modelview_matrix_{};
+
+  mutable detail::uniform_value_cache<GLfloat, 16> modelview_matrix_cache_;
 };
 
 template<typename TShader>
@@ -60,12 +113,15 @@ public:
   {
     projection_matrix_location_ =
      glGetUniformLocation(gprogram, "u_ProjectionMatrix");
+    projection_matrix_cache_.reset();
   }
 
   void projection_matrix(const mat4f& m4) const noexcept
   {
-    glUniformMatrix4fv(
-     projection_matrix_location_, 1, GL_FALSE, static_cast<const float*>(m4.m));
+    const auto* values = static_cast<const float*>(m4.m);
+    if(projection_matrix_cache_.update(values)) {
+      glUniformMatrix4fv(projection_matrix_location_, 1, GL_FALSE, values);
+    }
   }
 
   template<typename U>
@@ -77,6 +133,8 @@ public:
 
 private:
   GLint projection_matrix_location_{-1};
+
+  mutable detail::uniform_value_cache<GLfloat, 16> projection_matrix_cache_;
 };
 
 template<typename TShader>
@@ -89,12 +147,15 @@ public:
   void init_uniform_location(GLuint gprogram) noexcept
   {
     normal_matrix_location_ = glGetUniformLocation(gprogram, varname);
+    normal_matrix_cache_.reset();
   }
 
   void normal_matrix(const mat3f& m) const noexcept
   {
-    glUniformMatrix3fv(
-     normal_matrix_location_, 1, GL_FALSE, static_cast<const float*>(m.m));
+    const auto* values = static_cast<const float*>(m.m);
+    if(normal_matrix_cache_.update(values)) {
+      glUniformMatrix3fv(normal_matrix_location_, 1, GL_FALSE, values);
+    }
   }
 
   template<typename U>
@@ -106,6 +167,8 @@ public:
 
 private:
   GLint normal_matrix_location_{-1};
+
+  mutable detail::uniform_value_cache<GLfloat, 9> normal_matrix_cache_;
 };
 
 template<typename TShader>
@@ -127,6 +190,12 @@ public:
      glGetUniformLocation(gprogram, "u_Material_shininess");
     material_specular_color_location_ =
      glGetUniformLocation(gprogram, "u_Material_specularColor");
+
+    material_ambient_intensity_cache_.reset();
+    material_emissive_color_cache_.reset();
+    material_diffuse_color_cache_.reset();
+    material_shininess_cache_.reset();
+    material_specular_color_cache_.reset();
   }
 
   template<typename TColor, typename TScalar>
@@ -145,7 +214,9 @@ public:
   std::enable_if_t<std::is_convertible_v<T, GLfloat>>
   material_ambient_intensity(T&& val) const noexcept
   {
-    glUniform1f(material_ambient_intensity_location_, val);
+    if(material_ambient_intensity_cache_.update(static_cast<GLfloat>(val))) {
+      glUniform1f(material_ambient_intensity_location_, val);
+    }
   }
 
   template<typename... Ts>
@@ -153,9 +224,10 @@ public:
   material_emissive_color(Ts&&... args) const noexcept
   {
     const auto col = rgba32f{std::forward<Ts>(args)...};
-    glUniform4fv(material_emissive_color_location_,
-                 1,
-                 reinterpret_cast<const GLfloat*>(&col));
+    const auto values = reinterpret_cast<const GLfloat*>(&col);
+    if(material_emissive_color_cache_.update(values)) {
+      glUniform4fv(material_emissive_color_location_, 1, values);
+    }
   }
 
   template<typename... Ts>
@@ -163,9 +235,10 @@ public:
   material_diffuse_color(Ts&&... args) const noexcept
   {
     const auto col = rgba32f{std::forward<Ts>(args)...};
-    glUniform4fv(material_diffuse_color_location_,
-                 1,
-                 reinterpret_cast<const GLfloat*>(&col));
+    const auto values = reinterpret_cast<const GLfloat*>(&col);
+    if(material_diffuse_color_cache_.update(values)) {
+      glUniform4fv(material_diffuse_color_location_, 1, values);
+    }
   }
 
   template<typename... Ts>
@@ -173,16 +246,19 @@ public:
   material_specular_color(Ts&&... args) const noexcept
   {
     const auto col = rgba32f{std::forward<Ts>(args)...};
-    glUniform4fv(material_specular_color_location_,
-                 1,
-                 reinterpret_cast<const GLfloat*>(&col));
+    const auto values = reinterpret_cast<const GLfloat*>(&col);
+    if(material_specular_color_cache_.update(values)) {
+      glUniform4fv(material_specular_color_location_, 1, values);
+    }
   }
 
   template<typename T>
   std::enable_if_t<std::is_convertible_v<T, GLfloat>>
   material_shininess(T&& v) const noexcept
   {
-    glUniform1f(material_shininess_location_, v);
+    if(material_shininess_cache_.update(static_cast<GLfloat>(v))) {
+      glUniform1f(material_shininess_location_, v);
+    }
   }
 
 private:
@@ -191,6 +267,15 @@ private:
   GLint material_diffuse_color_location_{-1};
   GLint material_specular_color_location_{-1};
   GLint material_shininess_location_{-1};
+
+  mutable detail::uniform_value_cache<GLfloat, 1>
+   material_ambient_intensity_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 4>
+   material_emissive_color_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 4> material_diffuse_color_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 1> material_shininess_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 4>
+   material_specular_color_cache_;
 };
 
 template<typename TShader>
@@ -205,6 +290,10 @@ public:
      glGetUniformLocation(gprogram, "u_Fog_fogTypeLinear");
     fog_visibility_range_location_ =
      glGetUniformLocation(gprogram, "u_Fog_visibilityRange");
+
+    fog_color_cache_.reset();
+    fog_fog_type_cache_.reset();
+    fog_visibility_range_cache_.reset();
   }
 
   template<typename TColor, typename TScalar>
@@ -222,28 +311,38 @@ public:
   fog_color(Ts&&... args) const noexcept
   {
     const auto col = rgba32f{std::forward<Ts>(args)...};
-    glUniform4fv(
-     fog_color_location_, 1, reinterpret_cast<const GLfloat*>(&col));
+    const auto values = reinterpret_cast<const GLfloat*>(&col);
+    if(fog_color_cache_.update(values)) {
+      glUniform4fv(fog_color_location_, 1, values);
+    }
   }
 
   template<typename T>
   std::enable_if_t<std::is_convertible_v<T, GLint>> fog_fog_type(T&& val) const
    noexcept
   {
-    glUniform1i(fog_fog_type_location_, val);
+    if(fog_fog_type_cache_.update(static_cast<GLint>(val))) {
+      glUniform1i(fog_fog_type_location_, val);
+    }
   }
 
   template<typename T>
   std::enable_if_t<std::is_convertible_v<T, GLfloat>>
   fog_visibility_range(T&& val) const noexcept
   {
-    glUniform1f(fog_visibility_range_location_, val);
+    if(fog_visibility_range_cache_.update(static_cast<GLfloat>(val))) {
+      glUniform1f(fog_visibility_range_location_, val);
+    }
   }
 
 private:
   GLint fog_color_location_{-1};
   GLint fog_fog_type_location_{-1};
   GLint fog_visibility_range_location_{-1};
+
+  mutable detail::uniform_value_cache<GLfloat, 4> fog_color_cache_;
+  mutable detail::uniform_value_cache<GLint, 1> fog_fog_type_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 1> fog_visibility_range_cache_;
 };
 
 template<typename TShader>
@@ -273,6 +372,16 @@ public:
      glGetUniformLocation(gprogram, "u_LightSource_beamWidth");
     light_source_cut_off_angle_location_ =
      glGetUniformLocation(gprogram, "u_LightSource_cutOffAngle");
+
+    light_source_ambient_intensity_cache_.reset();
+    light_source_attenuation_cache_.reset();
+    light_source_beam_width_cache_.reset();
+    light_source_intensity_cache_.reset();
+    light_source_color_cache_.reset();
+    light_source_cut_off_angle_cache_.reset();
+    light_source_direction_cache_.reset();
+    light_source_position_cache_.reset();
+    light_source_radius_cache_.reset();
   }
 
   template<typename TColor, typename TConfig>
@@ -324,14 +433,19 @@ public:
   std::enable_if_t<std::is_convertible_v<T, GLfloat>>
   light_source_ambient_intensity(T&& val) const noexcept
   {
-    glUniform1f(light_source_ambient_intensity_location_, val);
+    const auto value = static_cast<GLfloat>(val);
+    if(light_source_ambient_intensity_cache_.update(value)) {
+      glUniform1f(light_source_ambient_intensity_location_, value);
+    }
   }
 
   template<typename T>
   std::enable_if_t<std::is_convertible_v<T, GLfloat>>
   light_source_beam_width(T&& val) const noexcept
   {
-    glUniform1f(light_source_beam_width_location_, val);
+    if(light_source_beam_width_cache_.update(static_cast<GLfloat>(val))) {
+      glUniform1f(light_source_beam_width_location_, val);
+    }
   }
 
   template<typename... Ts>
@@ -339,15 +453,19 @@ public:
   light_source_color(Ts&&... args) const noexcept
   {
     const auto col = rgba32f{std::forward<Ts>(args)...};
-    glUniform4fv(
-     light_source_color_location_, 1, reinterpret_cast<const GLfloat*>(&col));
+    const auto values = reinterpret_cast<const GLfloat*>(&col);
+    if(light_source_color_cache_.update(values)) {
+      glUniform4fv(light_source_color_location_, 1, values);
+    }
   }
 
   template<typename T>
   std::enable_if_t<std::is_convertible_v<T, GLfloat>>
   light_source_cut_off_angle(T&& val) const noexcept
   {
-    glUniform1f(light_source_cut_off_angle_location_, val);
+    if(light_source_cut_off_angle_cache_.update(static_cast<GLfloat>(val))) {
+      glUniform1f(light_source_cut_off_angle_location_, val);
+    }
   }
 
   template<typename... Ts>
@@ -355,14 +473,19 @@ public:
   light_source_direction(Ts&&... args) const noexcept
   {
     const auto v = vec3f{std::forward<Ts>(args)...};
-    glUniform3f(light_source_direction_location_, v.x(), v.y(), v.z());
+    const auto values = std::array<GLfloat, 3>{v.x(), v.y(), v.z()};
+    if(light_source_direction_cache_.update(values.data())) {
+      glUniform3fv(light_source_direction_location_, 1, values.data());
+    }
   }
 
   template<typename T>
   std::enable_if_t<std::is_convertible_v<T, GLfloat>>
   light_source_intensity(T&& val) const noexcept
   {
-    glUniform1f(light_source_intensity_location_, val);
+    if(light_source_intensity_cache_.update(static_cast<GLfloat>(val))) {
+      glUniform1f(light_source_intensity_location_, val);
+    }
   }
 
   template<typename... Ts>
@@ -370,7 +493,10 @@ public:
   light_source_attenuation(Ts&&... args) const noexcept
   {
     const auto v = vec3f{std::forward<Ts>(args)...};
-    glUniform3f(light_source_attenuation_location_, v.x(), v.y(), v.z());
+    const auto values = std::array<GLfloat, 3>{v.x(), v.y(), v.z()};
+    if(light_source_attenuation_cache_.update(values.data())) {
+      glUniform3fv(light_source_attenuation_location_, 1, values.data());
+    }
   }
 
   template<typename... Ts>
@@ -378,14 +504,19 @@ public:
   light_source_position(Ts&&... args) const noexcept
   {
     const auto v = vec3f{std::forward<Ts>(args)...};
-    glUniform3f(light_source_position_location_, v.x(), v.y(), v.z());
+    const auto values = std::array<GLfloat, 3>{v.x(), v.y(), v.z()};
+    if(light_source_position_cache_.update(values.data())) {
+      glUniform3fv(light_source_position_location_, 1, values.data());
+    }
   }
 
   template<typename T>
   std::enable_if_t<std::is_convertible_v<T, GLfloat>>
   light_source_radius(T&& val) const noexcept
   {
-    glUniform1f(light_source_radius_location_, val);
+    if(light_source_radius_cache_.update(static_cast<GLfloat>(val))) {
+      glUniform1f(light_source_radius_location_, val);
+    }
   }
 
 private:
@@ -398,6 +529,20 @@ private:
   GLint light_source_direction_location_{-1};
   GLint light_source_position_location_{-1};
   GLint light_source_radius_location_{-1};
+
+  mutable detail::uniform_value_cache<GLfloat, 1>
+   light_source_ambient_intensity_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 3>
+   light_source_attenuation_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 1>
+   light_source_beam_width_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 1> light_source_intensity_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 4> light_source_color_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 1>
+   light_source_cut_off_angle_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 3> light_source_direction_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 3> light_source_position_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 1> light_source_radius_cache_;
 };
 
 template<typename TShader>
@@ -407,17 +552,298 @@ public:
   {
     color_2d_sampler_uniform_location_ =
      glGetUniformLocation(gprogram, "u_TexColorImage");
+    color_2d_sampler_cache_.reset();
   }
 
   void color_texture_image(GLuint texture) const noexcept
   {
-    glUniform1i(color_2d_sampler_uniform_location_, 0);
-    glActiveTexture(GL_TEXTURE0 + 0);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    if(color_2d_sampler_cache_.update(0)) {
+      glUniform1i(color_2d_sampler_uniform_location_, 0);
+    }
+    gl::state().active_texture(GL_TEXTURE0 + 0);
+    gl::state().bind_texture(GL_TEXTURE_2D, texture);
   }
 
 private:
   GLint color_2d_sampler_uniform_location_{-1};
+
+  mutable detail::uniform_value_cache<GLint, 1> color_2d_sampler_cache_;
+};
+
+template<typename TShader>
+class depth2d_sampler_uniform {
+public:
+  void init_uniform_location(GLuint gprogram) noexcept
+  {
+    depth_2d_sampler_uniform_location_ =
+     glGetUniformLocation(gprogram, "u_TexDepth");
+    depth_2d_sampler_cache_.reset();
+  }
+
+  void depth_texture_image(GLuint texture) const noexcept
+  {
+    if(depth_2d_sampler_cache_.update(1)) {
+      glUniform1i(depth_2d_sampler_uniform_location_, 1);
+    }
+    gl::state().active_texture(GL_TEXTURE0 + 1);
+    gl::state().bind_texture(GL_TEXTURE_2D, texture);
+  }
+
+private:
+  GLint depth_2d_sampler_uniform_location_{-1};
+
+  mutable detail::uniform_value_cache<GLint, 1> depth_2d_sampler_cache_;
+};
+
+template<typename TShader>
+class occlusion2d_sampler_uniform {
+public:
+  void init_uniform_location(GLuint gprogram) noexcept
+  {
+    occlusion_2d_sampler_uniform_location_ =
+     glGetUniformLocation(gprogram, "u_TexOcclusion");
+    occlusion_size_location_ =
+     glGetUniformLocation(gprogram, "u_OcclusionSize");
+    occlusion_2d_sampler_cache_.reset();
+    occlusion_size_cache_.reset();
+  }
+
+  void occlusion_texture_image(GLuint texture,
+                               GLsizei width,
+                               GLsizei height) const noexcept
+  {
+    if(occlusion_2d_sampler_cache_.update(2)) {
+      glUniform1i(occlusion_2d_sampler_uniform_location_, 2);
+    }
+
+    const GLfloat size[] = {static_cast<GLfloat>(width),
+                            static_cast<GLfloat>(height)};
+    if(occlusion_size_cache_.update(size)) {
+      glUniform2fv(occlusion_size_location_, 1, size);
+    }
+
+    gl::state().active_texture(GL_TEXTURE0 + 2);
+    gl::state().bind_texture(GL_TEXTURE_2D, texture);
+  }
+
+private:
+  GLint occlusion_2d_sampler_uniform_location_{-1};
+  GLint occlusion_size_location_{-1};
+
+  mutable detail::uniform_value_cache<GLint, 1> occlusion_2d_sampler_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 2> occlusion_size_cache_;
+};
+
+// Projection terms needed to turn a depth buffer value back into a view
+// space position, for perspective and orthographic projections alike.
+template<typename TShader>
+class depth_reconstruction_uniform {
+public:
+  using mat4f = mat4<GLfloat>;
+
+  void init_uniform_location(GLuint gprogram) noexcept
+  {
+    projection_scale_location_ =
+     glGetUniformLocation(gprogram, "u_ProjectionScale");
+    projection_depth_location_ =
+     glGetUniformLocation(gprogram, "u_ProjectionDepth");
+    projection_scale_cache_.reset();
+    projection_depth_cache_.reset();
+  }
+
+  void depth_reconstruction(const mat4f& projection) const noexcept
+  {
+    const auto* m = static_cast<const GLfloat*>(projection.m);
+
+    const GLfloat scale[] = {m[0], m[5], m[8], m[9]};
+    if(projection_scale_cache_.update(scale)) {
+      glUniform4fv(projection_scale_location_, 1, scale);
+    }
+
+    const GLfloat depth[] = {m[10], m[11], m[14], m[15]};
+    if(projection_depth_cache_.update(depth)) {
+      glUniform4fv(projection_depth_location_, 1, depth);
+    }
+  }
+
+private:
+  GLint projection_scale_location_{-1};
+  GLint projection_depth_location_{-1};
+
+  mutable detail::uniform_value_cache<GLfloat, 4> projection_scale_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 4> projection_depth_cache_;
+};
+
+template<typename TShader>
+class ssao_uniform {
+public:
+  void init_uniform_location(GLuint gprogram) noexcept
+  {
+    ssao_sample_count_location_ =
+     glGetUniformLocation(gprogram, "u_Ssao_sampleCount");
+    ssao_radius_location_ = glGetUniformLocation(gprogram, "u_Ssao_radius");
+    ssao_texel_size_location_ =
+     glGetUniformLocation(gprogram, "u_Ssao_texelSize");
+    ssao_sample_count_cache_.reset();
+    ssao_radius_cache_.reset();
+    ssao_texel_size_cache_.reset();
+  }
+
+  void ssao_sample_count(GLint count) const noexcept
+  {
+    if(ssao_sample_count_cache_.update(static_cast<GLfloat>(count))) {
+      glUniform1f(ssao_sample_count_location_, static_cast<GLfloat>(count));
+    }
+  }
+
+  void ssao_radius(GLfloat radius) const noexcept
+  {
+    if(ssao_radius_cache_.update(radius)) {
+      glUniform1f(ssao_radius_location_, radius);
+    }
+  }
+
+  // Size of one texel of the depth texture being sampled.
+  void ssao_texel_size(GLsizei width, GLsizei height) const noexcept
+  {
+    const GLfloat size[] = {GLfloat{1} / width, GLfloat{1} / height};
+    if(ssao_texel_size_cache_.update(size)) {
+      glUniform2fv(ssao_texel_size_location_, 1, size);
+    }
+  }
+
+private:
+  GLint ssao_sample_count_location_{-1};
+  GLint ssao_radius_location_{-1};
+  GLint ssao_texel_size_location_{-1};
+
+  mutable detail::uniform_value_cache<GLfloat, 1> ssao_sample_count_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 1> ssao_radius_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 2> ssao_texel_size_cache_;
+};
+
+template<typename TShader>
+class depth_only_uniform {
+public:
+  void init_uniform_location(GLuint gprogram) noexcept
+  {
+    depth_only_location_ = glGetUniformLocation(gprogram, "u_DepthOnly");
+    depth_only_cache_.reset();
+  }
+
+  // Skips the shading of fragments when only the depth buffer is written.
+  void depth_only(bool value) const noexcept
+  {
+    if(depth_only_cache_.update(static_cast<GLint>(value))) {
+      glUniform1i(depth_only_location_, value);
+    }
+  }
+
+private:
+  GLint depth_only_location_{-1};
+
+  mutable detail::uniform_value_cache<GLint, 1> depth_only_cache_;
+};
+
+template<typename TShader>
+class frame_interpolation_uniform {
+public:
+  void init_uniform_location(GLuint gprogram) noexcept
+  {
+    frame_interpolation_location_ =
+     glGetUniformLocation(gprogram, "u_FrameInterpolation");
+    frame_interpolation_cache_.reset();
+  }
+
+  // Weight of the next transformation of an instance against its current
+  // one, between two keyframes of a trajectory.
+  void frame_interpolation(GLfloat value) const noexcept
+  {
+    if(frame_interpolation_cache_.update(value)) {
+      glUniform1f(frame_interpolation_location_, value);
+    }
+  }
+
+private:
+  GLint frame_interpolation_location_{-1};
+
+  mutable detail::uniform_value_cache<GLfloat, 1> frame_interpolation_cache_;
+};
+
+template<typename TShader>
+class sphere_normals_uniform {
+public:
+  void init_uniform_location(GLuint gprogram) noexcept
+  {
+    sphere_normals_location_ =
+     glGetUniformLocation(gprogram, "u_SphereNormals");
+    sphere_normals_cache_.reset();
+  }
+
+  // Takes the normals from the vertex positions of a unit sphere mesh, which
+  // then needs no normal attribute.
+  void sphere_normals(bool value) const noexcept
+  {
+    if(sphere_normals_cache_.update(static_cast<GLint>(value))) {
+      glUniform1i(sphere_normals_location_, value);
+    }
+  }
+
+private:
+  GLint sphere_normals_location_{-1};
+
+  mutable detail::uniform_value_cache<GLint, 1> sphere_normals_cache_;
+};
+
+template<typename TShader>
+class vertex_quantization_uniform {
+public:
+  void init_uniform_location(GLuint gprogram) noexcept
+  {
+    quantized_vertices_location_ =
+     glGetUniformLocation(gprogram, "u_QuantizedVertices");
+    position_offset_location_ =
+     glGetUniformLocation(gprogram, "u_PositionOffset");
+    position_scale_location_ =
+     glGetUniformLocation(gprogram, "u_PositionScale");
+    quantized_vertices_cache_.reset();
+    position_offset_cache_.reset();
+    position_scale_cache_.reset();
+  }
+
+  // Reads positions as 16-bit fractions of the bounds given by
+  // position_quantization, and normals as 8-bit octahedral pairs.
+  void quantized_vertices(bool value) const noexcept
+  {
+    if(quantized_vertices_cache_.update(static_cast<GLint>(value))) {
+      glUniform1i(quantized_vertices_location_, value);
+    }
+  }
+
+  void position_quantization(const vec3<GLfloat>& offset,
+                             const vec3<GLfloat>& scale) const noexcept
+  {
+    const auto offset_values =
+     std::array<GLfloat, 3>{offset.x(), offset.y(), offset.z()};
+    if(position_offset_cache_.update(offset_values.data())) {
+      glUniform3fv(position_offset_location_, 1, offset_values.data());
+    }
+
+    const auto scale_values =
+     std::array<GLfloat, 3>{scale.x(), scale.y(), scale.z()};
+    if(position_scale_cache_.update(scale_values.data())) {
+      glUniform3fv(position_scale_location_, 1, scale_values.data());
+    }
+  }
+
+private:
+  GLint quantized_vertices_location_{-1};
+  GLint position_offset_location_{-1};
+  GLint position_scale_location_{-1};
+
+  mutable detail::uniform_value_cache<GLint, 1> quantized_vertices_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 3> position_offset_cache_;
+  mutable detail::uniform_value_cache<GLfloat, 3> position_scale_cache_;
 };
 
 template<typename TShader, template<typename> class... TShaderUniform>
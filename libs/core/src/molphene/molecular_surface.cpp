@@ -0,0 +1,463 @@
+#include "molecular_surface.hpp"
+
+#include <numeric>
+
+#include "algorithm.hpp"
+#include "marching_cubes.hpp"
+
+namespace molphene {
+namespace {
+
+constexpr auto iso_level = 1.f;
+
+// Contributions below this are dropped, which bounds the voxels an atom
+// touches.
+constexpr auto min_density = 0.01f;
+
+// The brick corners plus one halo sample on each side for the gradients.
+constexpr auto samples_per_axis = molecular_surface::brick_cells + 3;
+
+constexpr auto corners_per_axis = molecular_surface::brick_cells + 1;
+
+constexpr auto samples_size = std::size_t{samples_per_axis} *
+                              samples_per_axis * samples_per_axis;
+
+constexpr auto sample_strides =
+ std::array<std::size_t, 3>{1, samples_per_axis,
+                            std::size_t{samples_per_axis} * samples_per_axis};
+
+constexpr auto no_vertex = std::numeric_limits<std::uint16_t>::max();
+
+constexpr auto no_brick = std::numeric_limits<std::uint32_t>::max();
+
+constexpr auto sample_index(int x, int y, int z) noexcept -> std::size_t
+{
+  return (static_cast<std::size_t>(z) * samples_per_axis + y) *
+          samples_per_axis +
+         x;
+}
+
+} // namespace
+
+struct molecular_surface::brick_samples {
+  std::array<int, 3> brick{0, 0, 0};
+
+  vec3<float> origin{0};
+
+  std::vector<float> density = std::vector<float>(samples_size);
+
+  // Strongest single contribution at each sample, and whose it is.
+  std::vector<float> peak = std::vector<float>(samples_size);
+
+  std::vector<std::uint32_t> atom = std::vector<std::uint32_t>(samples_size);
+
+  std::vector<surface_brick_mesh::index_type> edge_vertices =
+   std::vector<surface_brick_mesh::index_type>(
+    std::size_t{corners_per_axis} * corners_per_axis * corners_per_axis * 3);
+};
+
+molecular_surface::molecular_surface(gsl::span<const vec3<float>> positions,
+                                     gsl::span<const float> radii,
+                                     gsl::span<const rgba8> colors,
+                                     molecular_surface_options options)
+: options_{options}
+, positions_(positions.begin(), positions.end())
+, radii_(radii.begin(), radii.end())
+, colors_(colors.begin(), colors.end())
+{
+  assert(positions.size() == radii.size());
+  assert(positions.size() == colors.size());
+  assert(options.grid_spacing > 0 && options.falloff > 0);
+
+  if(positions_.empty()) {
+    return;
+  }
+
+  for(auto i = std::size_t{0}; i < radii_.size(); ++i) {
+    radii_[i] *= options_.radius_scale;
+    max_cutoff_ = std::max(max_cutoff_, atom_cutoff(i));
+  }
+  if(max_cutoff_ <= 0) {
+    return;
+  }
+
+  build_grid();
+}
+
+auto molecular_surface::move_atoms(gsl::span<const std::uint32_t> indices,
+                                   gsl::span<const vec3<float>> positions)
+ -> surface_update
+{
+  assert(indices.size() == positions.size());
+
+  auto update = surface_update{};
+  if(bricks_.empty() || indices.empty()) {
+    return update;
+  }
+
+  // Bricks the atoms leave are dirty as well as those they enter.
+  auto dirty = std::vector<bool>(brick_slots_.size());
+  const auto mark_dirty = [&](std::size_t atom) noexcept {
+    return for_each_brick_in_reach(
+     atom, [&](std::size_t brick) noexcept { dirty[brick] = true; });
+  };
+
+  for(auto i = std::size_t{0}; i < indices.size(); ++i) {
+    mark_dirty(indices[i]);
+    positions_[indices[i]] = positions[i];
+  }
+
+  for(const auto atom : indices) {
+    if(!mark_dirty(atom)) {
+      build_grid();
+      update.remeshed_all = true;
+      update.bricks.resize(bricks_.size());
+      std::iota(update.bricks.begin(), update.bricks.end(), std::size_t{0});
+      return update;
+    }
+  }
+
+  atom_cells_ = cell_list{positions_, max_cutoff_};
+
+  for(auto brick = std::size_t{0}; brick < dirty.size(); ++brick) {
+    if(!dirty[brick]) {
+      continue;
+    }
+
+    if(brick_slots_[brick] == no_brick) {
+      brick_slots_[brick] = static_cast<std::uint32_t>(bricks_.size());
+      bricks_.emplace_back().brick = brick_coords(brick);
+    }
+    update.bricks.push_back(brick_slots_[brick]);
+  }
+
+  std::sort(update.bricks.begin(), update.bricks.end());
+  mesh_bricks(update.bricks);
+
+  return update;
+}
+
+auto molecular_surface::options() const noexcept
+ -> const molecular_surface_options&
+{
+  return options_;
+}
+
+auto molecular_surface::bricks() const noexcept
+ -> const std::vector<surface_brick_mesh>&
+{
+  return bricks_;
+}
+
+auto molecular_surface::vertices_size() const noexcept -> std::size_t
+{
+  auto size = std::size_t{0};
+  for(const auto& brick : bricks_) {
+    size += brick.positions.size();
+  }
+  return size;
+}
+
+auto molecular_surface::indices_size() const noexcept -> std::size_t
+{
+  auto size = std::size_t{0};
+  for(const auto& brick : bricks_) {
+    size += brick.indices.size();
+  }
+  return size;
+}
+
+auto molecular_surface::atom_cutoff(std::size_t atom) const noexcept -> float
+{
+  return radii_[atom] *
+         std::sqrt(1 + std::log(1 / min_density) / options_.falloff);
+}
+
+void molecular_surface::build_grid()
+{
+  bricks_.clear();
+  brick_slots_.clear();
+
+  atom_cells_ = cell_list{positions_, max_cutoff_};
+
+  auto lower = positions_[0];
+  auto upper = positions_[0];
+  for(const auto& position : positions_) {
+    lower = {std::min(lower.x(), position.x()),
+             std::min(lower.y(), position.y()),
+             std::min(lower.z(), position.z())};
+    upper = {std::max(upper.x(), position.x()),
+             std::max(upper.y(), position.y()),
+             std::max(upper.z(), position.z())};
+  }
+
+  const auto spacing = options_.grid_spacing;
+  const auto margin = max_cutoff_ + spacing;
+  origin_ = lower - vec3<float>{margin};
+
+  const auto brick_size = spacing * brick_cells;
+  const auto extent = upper - lower + vec3<float>{2 * margin};
+  brick_dims_ = {static_cast<int>(extent.x() / brick_size) + 1,
+                 static_cast<int>(extent.y() / brick_size) + 1,
+                 static_cast<int>(extent.z() / brick_size) + 1};
+
+  // Only bricks with a corner sample in reach of some atom can hold surface.
+  brick_slots_.assign(static_cast<std::size_t>(brick_dims_[0]) *
+                       brick_dims_[1] * brick_dims_[2],
+                      no_brick);
+  for(auto i = std::size_t{0}; i < positions_.size(); ++i) {
+    for_each_brick_in_reach(
+     i, [this](std::size_t brick) noexcept { brick_slots_[brick] = 0; });
+  }
+
+  for(auto brick = std::size_t{0}; brick < brick_slots_.size(); ++brick) {
+    if(brick_slots_[brick] != no_brick) {
+      brick_slots_[brick] = static_cast<std::uint32_t>(bricks_.size());
+      bricks_.emplace_back().brick = brick_coords(brick);
+    }
+  }
+
+  auto all = std::vector<std::size_t>(bricks_.size());
+  std::iota(all.begin(), all.end(), std::size_t{0});
+  mesh_bricks(all);
+}
+
+void molecular_surface::mesh_bricks(const std::vector<std::size_t>& bricks)
+{
+  parallel_for_slice(
+   std::size_t{0},
+   bricks.size(),
+   std::size_t{1},
+   [&](std::size_t begin, std::size_t end) {
+     auto samples = brick_samples{};
+     for(auto i = begin; i < end; ++i) {
+       auto& mesh = bricks_[bricks[i]];
+       sample_brick(mesh.brick, samples);
+       mesh_brick(samples, mesh);
+     }
+   });
+}
+
+template<typename Function>
+auto molecular_surface::for_each_brick_in_reach(std::size_t atom,
+                                                Function func) const -> bool
+{
+  const auto brick_size = options_.grid_spacing * brick_cells;
+  const auto reach = vec3<float>{atom_cutoff(atom) + options_.grid_spacing};
+  const auto first = positions_[atom] - reach - origin_;
+  const auto last = positions_[atom] + reach - origin_;
+
+  const auto first_offsets =
+   std::array<float, 3>{first.x(), first.y(), first.z()};
+  const auto last_offsets = std::array<float, 3>{last.x(), last.y(), last.z()};
+
+  auto first_brick = std::array<int, 3>{};
+  auto last_brick = std::array<int, 3>{};
+  for(auto axis = 0; axis < 3; ++axis) {
+    first_brick[axis] =
+     static_cast<int>(std::floor(first_offsets[axis] / brick_size));
+    last_brick[axis] =
+     static_cast<int>(std::floor(last_offsets[axis] / brick_size));
+    if(first_brick[axis] < 0 || last_brick[axis] >= brick_dims_[axis]) {
+      return false;
+    }
+  }
+
+  for(auto z = first_brick[2]; z <= last_brick[2]; ++z) {
+    for(auto y = first_brick[1]; y <= last_brick[1]; ++y) {
+      for(auto x = first_brick[0]; x <= last_brick[0]; ++x) {
+        func((static_cast<std::size_t>(z) * brick_dims_[1] + y) *
+              brick_dims_[0] +
+             x);
+      }
+    }
+  }
+  return true;
+}
+
+auto molecular_surface::brick_coords(std::size_t brick) const noexcept
+ -> std::array<int, 3>
+{
+  const auto x = static_cast<int>(brick % brick_dims_[0]);
+  const auto yz = static_cast<int>(brick / brick_dims_[0]);
+  return {x, yz % brick_dims_[1], yz / brick_dims_[1]};
+}
+
+void molecular_surface::sample_brick(const std::array<int, 3>& brick,
+                                     brick_samples& samples) const
+{
+  const auto spacing = options_.grid_spacing;
+
+  samples.brick = brick;
+  samples.origin =
+   origin_ + vec3<float>{static_cast<float>(brick[0] * brick_cells - 1),
+                         static_cast<float>(brick[1] * brick_cells - 1),
+                         static_cast<float>(brick[2] * brick_cells - 1)} *
+              spacing;
+
+  std::fill(samples.density.begin(), samples.density.end(), 0.f);
+  std::fill(samples.peak.begin(), samples.peak.end(), 0.f);
+
+  const auto half_extent = (samples_per_axis - 1) * spacing / 2;
+  const auto center = samples.origin + vec3<float>{half_extent};
+
+  auto offsets_sq = std::array<std::array<float, samples_per_axis>, 3>{};
+  atom_cells_.for_each_candidate(
+   center, half_extent + max_cutoff_, [&](cell_list::index_type atom) {
+     const auto cutoff = atom_cutoff(atom);
+     // Offsets are taken in whole-grid coordinates, so that bricks sharing
+     // samples compute exactly the same density there.
+     const auto offset = (positions_[atom] - origin_) / spacing;
+     const auto grid = std::array<float, 3>{offset.x(), offset.y(), offset.z()};
+     const auto reach = cutoff / spacing;
+
+     auto first = std::array<int, 3>{};
+     auto last = std::array<int, 3>{};
+     for(auto axis = 0; axis < 3; ++axis) {
+       const auto base = samples.brick[axis] * brick_cells - 1;
+       first[axis] = std::max(
+        0, static_cast<int>(std::ceil(grid[axis] - reach)) - base);
+       last[axis] =
+        std::min(samples_per_axis - 1,
+                 static_cast<int>(std::floor(grid[axis] + reach)) - base);
+       if(first[axis] > last[axis]) {
+         return;
+       }
+
+       for(auto i = first[axis]; i <= last[axis]; ++i) {
+         const auto distance =
+          (static_cast<float>(base + i) - grid[axis]) * spacing;
+         offsets_sq[axis][i] = distance * distance;
+       }
+     }
+
+     const auto inv_radius_sq = 1 / (radii_[atom] * radii_[atom]);
+     const auto cutoff_sq = cutoff * cutoff;
+
+     for(auto z = first[2]; z <= last[2]; ++z) {
+       for(auto y = first[1]; y <= last[1]; ++y) {
+         const auto yz_sq = offsets_sq[1][y] + offsets_sq[2][z];
+         if(yz_sq >= cutoff_sq) {
+           continue;
+         }
+
+         for(auto x = first[0]; x <= last[0]; ++x) {
+           const auto dist_sq = offsets_sq[0][x] + yz_sq;
+           if(dist_sq >= cutoff_sq) {
+             continue;
+           }
+
+           const auto value =
+            std::exp(options_.falloff * (1 - dist_sq * inv_radius_sq));
+           const auto index = sample_index(x, y, z);
+           samples.density[index] += value;
+           if(value > samples.peak[index]) {
+             samples.peak[index] = value;
+             samples.atom[index] = atom;
+           }
+         }
+       }
+     }
+   });
+}
+
+void molecular_surface::mesh_brick(brick_samples& samples,
+                                   surface_brick_mesh& mesh) const
+{
+  namespace mc = marching_cubes;
+
+  mesh.positions.clear();
+  mesh.normals.clear();
+  mesh.colors.clear();
+  mesh.indices.clear();
+
+  auto& edge_vertices = samples.edge_vertices;
+  std::fill(edge_vertices.begin(), edge_vertices.end(), no_vertex);
+
+  const auto& density = samples.density;
+  const auto spacing = options_.grid_spacing;
+
+  const auto gradient = [&density](std::size_t index) noexcept {
+    return vec3<float>{
+     density[index + sample_strides[0]] - density[index - sample_strides[0]],
+     density[index + sample_strides[1]] - density[index - sample_strides[1]],
+     density[index + sample_strides[2]] - density[index - sample_strides[2]]};
+  };
+
+  // Corner samples are at 1 to brick_cells + 1 on each axis.
+  const auto edge_vertex = [&](std::array<int, 3> lower, int axis) {
+    auto& vertex = edge_vertices[((static_cast<std::size_t>(lower[2] - 1) *
+                                    corners_per_axis +
+                                   (lower[1] - 1)) *
+                                   corners_per_axis +
+                                  (lower[0] - 1)) *
+                                  3 +
+                                 axis];
+    if(vertex != no_vertex) {
+      return vertex;
+    }
+
+    const auto first = sample_index(lower[0], lower[1], lower[2]);
+    const auto second = first + sample_strides[axis];
+    const auto t =
+     (iso_level - density[first]) / (density[second] - density[first]);
+
+    // From grid coordinates, so that bricks sharing a face agree exactly.
+    auto coord = std::array<float, 3>{};
+    for(auto a = 0; a < 3; ++a) {
+      coord[a] =
+       static_cast<float>(samples.brick[a] * brick_cells + lower[a] - 1);
+    }
+    coord[axis] += t;
+
+    // The density falls outwards, so the outward normal is down the gradient.
+    auto normal = (gradient(first) * (1 - t) + gradient(second) * t) * -1.f;
+    const auto length = normal.magnitude();
+    normal = length > 0 ? normal / length : vec3<float>{0, 0, 1};
+
+    const auto inside = density[first] >= density[second] ? first : second;
+
+    vertex = static_cast<surface_brick_mesh::index_type>(mesh.positions.size());
+    mesh.positions.push_back(
+     origin_ + vec3<float>{coord[0], coord[1], coord[2]} * spacing);
+    mesh.normals.push_back(normal);
+    mesh.colors.push_back(colors_[samples.atom[inside]]);
+    return vertex;
+  };
+
+  for(auto z = 1; z <= brick_cells; ++z) {
+    for(auto y = 1; y <= brick_cells; ++y) {
+      for(auto x = 1; x <= brick_cells; ++x) {
+        auto inside_mask = 0U;
+        for(auto corner = 0U; corner < mc::corner_offsets.size(); ++corner) {
+          const auto& offset = mc::corner_offsets[corner];
+          if(density[sample_index(
+              x + offset[0], y + offset[1], z + offset[2])] >= iso_level) {
+            inside_mask |= 1U << corner;
+          }
+        }
+
+        const auto& triangles = mc::triangle_table[inside_mask];
+        for(auto i = 0; i < triangles.count * 3; ++i) {
+          const auto& corners = mc::edge_corners[triangles.edges[i]];
+          const auto& from = mc::corner_offsets[corners[0]];
+          const auto& to = mc::corner_offsets[corners[1]];
+
+          auto lower = std::array<int, 3>{};
+          auto axis = 0;
+          for(auto a = 0; a < 3; ++a) {
+            lower[a] = std::min(from[a], to[a]);
+            if(from[a] != to[a]) {
+              axis = a;
+            }
+          }
+
+          mesh.indices.push_back(
+           edge_vertex({x + lower[0], y + lower[1], z + lower[2]}, axis));
+        }
+      }
+    }
+  }
+}
+
+} // namespace molphene
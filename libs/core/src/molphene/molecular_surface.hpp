@@ -0,0 +1,124 @@
+#ifndef MOLPHENE_MOLECULAR_SURFACE_HPP
+#define MOLPHENE_MOLECULAR_SURFACE_HPP
+
+#include "stdafx.hpp"
+
+#include <molecule/cell_list.hpp>
+
+#include "m3d.hpp"
+
+namespace molphene {
+
+struct molecular_surface_options {
+  // Distance in angstrom between density samples. Halving it gives about four
+  // times the triangles and eight times the work.
+  float grid_spacing{1};
+
+  // How fast an atom's density decays past its radius. Low values blend
+  // neighbouring atoms into a smooth skin, high values follow the spheres.
+  float falloff{2};
+
+  float radius_scale{1};
+};
+
+// Triangles of one brick of the density grid, indexed within the brick.
+struct surface_brick_mesh {
+  using index_type = std::uint16_t;
+
+  std::array<int, 3> brick{0, 0, 0};
+
+  std::vector<vec3<float>> positions;
+
+  std::vector<vec3<float>> normals;
+
+  std::vector<rgba8> colors;
+
+  std::vector<index_type> indices;
+};
+
+// Bricks re-meshed by an update, as indices into molecular_surface::bricks().
+struct surface_update {
+  std::vector<std::size_t> bricks;
+
+  // Set when the grid was rebuilt and every brick may have moved.
+  bool remeshed_all{false};
+};
+
+// Gaussian density surface of a set of atom spheres. Each atom adds
+// exp(-falloff * (d^2 / r^2 - 1)) to the density, so a lone atom's isosurface
+// at density 1 is its sphere, and close atoms merge into a smooth molecular
+// skin. The grid is split into bricks of brick_cells^3 cells that are sampled
+// and meshed by marching cubes independently and in parallel; vertices take
+// the color of the atom dominating the density at the nearest inside sample.
+class molecular_surface {
+public:
+  static constexpr auto brick_cells = 16;
+
+  molecular_surface() noexcept = default;
+
+  molecular_surface(gsl::span<const vec3<float>> positions,
+                    gsl::span<const float> radii,
+                    gsl::span<const rgba8> colors,
+                    molecular_surface_options options = {});
+
+  // Moves the atoms at indices to positions. Only the bricks in reach of
+  // their old or new positions are sampled and meshed again; bricks they
+  // newly reach are appended. Moving an atom off the grid rebuilds it.
+  auto move_atoms(gsl::span<const std::uint32_t> indices,
+                  gsl::span<const vec3<float>> positions) -> surface_update;
+
+  auto options() const noexcept -> const molecular_surface_options&;
+
+  auto bricks() const noexcept -> const std::vector<surface_brick_mesh>&;
+
+  auto vertices_size() const noexcept -> std::size_t;
+
+  auto indices_size() const noexcept -> std::size_t;
+
+private:
+  struct brick_samples;
+
+  void build_grid();
+
+  void mesh_bricks(const std::vector<std::size_t>& bricks);
+
+  // Calls func(brick) with the grid index of every brick whose corner samples
+  // the atom reaches. Returns false, without calls, when some are off the
+  // grid.
+  template<typename Function>
+  auto for_each_brick_in_reach(std::size_t atom, Function func) const -> bool;
+
+  auto brick_coords(std::size_t brick) const noexcept -> std::array<int, 3>;
+
+  auto atom_cutoff(std::size_t atom) const noexcept -> float;
+
+  void sample_brick(const std::array<int, 3>& brick,
+                    brick_samples& samples) const;
+
+  void mesh_brick(brick_samples& samples, surface_brick_mesh& mesh) const;
+
+  molecular_surface_options options_;
+
+  std::vector<vec3<float>> positions_;
+
+  std::vector<float> radii_;
+
+  std::vector<rgba8> colors_;
+
+  float max_cutoff_{0};
+
+  cell_list atom_cells_;
+
+  vec3<float> origin_{0};
+
+  std::array<int, 3> brick_dims_{0, 0, 0};
+
+  // Index into bricks_ of each brick of the grid that has one.
+  std::vector<std::uint32_t> brick_slots_;
+
+  std::vector<surface_brick_mesh> bricks_;
+};
+
+} // namespace molphene
+
+#endif
@@ -7,7 +7,9 @@ enum class molecule_display {
   spacefill,
   ball_and_stick,
   spacefill_instance,
-  ball_and_stick_instance
+  ball_and_stick_instance,
+  surface,
+  ribbon
 };
 
 } // namespace molphene
@@ -1,25 +1,75 @@
 #ifndef MOLPHENE_MOLECULE_TO_SHAPE_HPP
 #define MOLPHENE_MOLECULE_TO_SHAPE_HPP
 
+#include <molecule/atom.hpp>
 #include <molecule/atom_radius_kind.hpp>
+#include <molecule/molecule.hpp>
 
 #include "color_manager.hpp"
 #include "cylinder_mesh_attribute.hpp"
+#include "ribbon_mesh_attribute.hpp"
 #include "sphere_mesh_attribute.hpp"
 
 namespace molphene {
 
+// Per-atom factors that darken the atom colors, indexed like the atoms of
+// the molecule starting at first_atom. Without factors colors are unchanged.
+struct atom_shading {
+  const atom* first_atom{nullptr};
+  gsl::span<const float> factors{};
+
+  auto shade(const atom& atom, rgba8 color) const noexcept -> rgba8
+  {
+    if(factors.empty()) {
+      return color;
+    }
+
+    const auto factor = factors[&atom - first_atom];
+    const auto scale = [factor](std::uint8_t channel) noexcept {
+      return static_cast<std::uint8_t>(std::lround(channel * factor));
+    };
+    return rgba8{scale(color.r), scale(color.g), scale(color.b), color.a};
+  }
+};
+
 struct atom_to_sphere_attrs_options {
   atom_radius_kind radius_type{atom_radius_kind::van_der_waals};
   double radius_size{1};
   double radius_scale{1};
+  atom_shading shading{};
 };
 
 struct bond_to_cylinder_attrs_options {
   bool is_first{true};
   double radius_size{1};
+  atom_shading shading{};
 };
 
+struct backbone_to_ribbon_attrs_options {
+  double width{2};
+  double thickness{0.5};
+  atom_shading shading{};
+};
+
+// Blue at fraction 0 through green to red at fraction 1.
+inline auto spectrum_color(double fraction) noexcept -> rgba8
+{
+  const auto hue = (1 - fraction) * 4;
+  const auto channel = [](double value) noexcept {
+    return static_cast<std::uint8_t>(
+     std::lround(std::clamp(value, 0., 1.) * 0xff));
+  };
+  return rgba8{channel(2 - hue),
+               channel(std::min(hue, 4 - hue)),
+               channel(hue - 2),
+               0xff};
+}
+
+inline auto is_alpha_carbon(const atom& atom) -> bool
+{
+  return atom.element().symbol == "C" && atom.name() == "CA";
+}
+
 template<typename TSizedRange, typename TOutIter>
 void atoms_to_sphere_attrs(const TSizedRange& atoms,
                            TOutIter output,
@@ -55,7 +105,8 @@ void atoms_to_sphere_attrs(const TSizedRange& atoms,
       return radius * options.radius_scale;
     }
     ();
-    const auto acol = col_manager.get_element_color(element.symbol);
+    const auto acol =
+     options.shading.shade(atom, col_manager.get_element_color(element.symbol));
 
     const auto atex = vec2f{float_type(aindex % tex_size),
                             std::floor(float_type(aindex) / tex_size)} /
@@ -106,11 +157,11 @@ void bonds_to_cylinder_attrs(const TSizeRange& bond_atoms,
     if(options.is_first) {
       cyl.top = apos1;
       cyl.bottom = midpos;
-      color = acol1;
+      color = options.shading.shade(atom1, acol1);
     } else {
       cyl.top = midpos;
       cyl.bottom = apos2;
-      color = acol2;
+      color = options.shading.shade(atom2, acol2);
     }
 
     auto cyl_mesh_attr = cylinder_mesh_attribute{};
@@ -123,6 +174,131 @@ void bonds_to_cylinder_attrs(const TSizeRange& bond_atoms,
   }
 }
 
+// Threads a ribbon through the alpha carbons of each chain of mol, one
+// segment per residue. The carbonyl oxygen of a residue lays the ribbon flat
+// in the peptide plane, and each chain is colored by spectrum_color from its
+// first residue to its last.
+template<typename TOutIter>
+void backbone_to_ribbon_attrs(const molecule& mol,
+                              TOutIter output,
+                              backbone_to_ribbon_attrs_options options)
+{
+  using float_type = double;
+  using vec2f = vec2<float_type>;
+  using vec3f = vec3<float_type>;
+
+  struct residue {
+    const atom* alpha;
+    vec3f position;
+    std::optional<vec3f> oxygen;
+  };
+
+  const auto to_vec3f = [](const atom& atom) noexcept {
+    const auto apos = atom.position();
+    return vec3f{apos.x(), apos.y(), apos.z()};
+  };
+
+  const auto& atoms = mol.atoms();
+
+  auto residues = std::vector<residue>{};
+  auto chain_firsts = std::vector<std::size_t>{};
+  auto segments_size = std::size_t{0};
+  for(auto c = std::size_t{0}; c < mol.chains_size(); ++c) {
+    const auto chain_first = residues.size();
+    chain_firsts.push_back(chain_first);
+
+    const auto chain_residues = mol.chain_residues(c);
+    for(auto r = chain_residues.first; r < chain_residues.last; ++r) {
+      const auto residue_atoms = mol.residue_atoms(r);
+      auto res = residue{nullptr, {}, std::nullopt};
+      for(auto a = residue_atoms.first; a < residue_atoms.last; ++a) {
+        const auto& atom = atoms[a];
+        if(!res.alpha && is_alpha_carbon(atom)) {
+          res.alpha = &atom;
+          res.position = to_vec3f(atom);
+        } else if(!res.oxygen && atom.name() == "O") {
+          res.oxygen = to_vec3f(atom);
+        }
+      }
+
+      if(res.alpha) {
+        residues.push_back(res);
+      }
+    }
+
+    const auto chain_size = residues.size() - chain_first;
+    segments_size += chain_size < 2 ? 0 : chain_size - 1;
+  }
+  chain_firsts.push_back(residues.size());
+
+  const auto tex_size =
+   static_cast<std::size_t>(std::ceil(std::sqrt(segments_size)));
+
+  auto sides = std::vector<vec3f>(residues.size());
+  auto sindex = std::size_t{0};
+  for(auto c = std::size_t{1}; c < chain_firsts.size(); ++c) {
+    const auto first = chain_firsts[c - 1];
+    const auto last = chain_firsts[c];
+    if(last - first < 2) {
+      continue;
+    }
+
+    const auto position = [&](std::ptrdiff_t i) noexcept {
+      const auto clamped = std::clamp<std::ptrdiff_t>(i, first, last - 1);
+      return residues[clamped].position;
+    };
+
+    for(auto i = first; i < last; ++i) {
+      const auto prev = position(i - 1);
+      const auto next = position(i + 1);
+      const auto tangent = (next - prev).to_unit();
+
+      const auto& res = residues[i];
+      const auto across =
+       res.oxygen ? *res.oxygen - res.position
+                  : (prev - res.position) + (next - res.position);
+
+      auto side = across - tangent * across.dot(tangent);
+      if(side.magnitude() < 1e-3) {
+        side = tangent.cross({0, 1, 0});
+        if(side.magnitude() < 1e-3) {
+          side = tangent.cross({0, 0, 1});
+        }
+      }
+      side = side.to_unit();
+
+      // Carbonyls alternate sides along a strand; keep the ribbon untwisted.
+      if(i > first && side.dot(sides[i - 1]) < 0) {
+        side = side * -1;
+      }
+      sides[i] = side;
+    }
+
+    const auto last_segment = std::max<std::size_t>(last - first - 2, 1);
+    for(auto i = first; i + 1 < last; ++i) {
+      const auto& res = residues[i];
+      const auto fraction = float_type(i - first) / last_segment;
+
+      const auto atex = vec2f{float_type(sindex % tex_size),
+                              std::floor(float_type(sindex) / tex_size)} /
+                        tex_size;
+
+      auto ribbon_mesh_attr = ribbon_mesh_attribute{};
+      ribbon_mesh_attr.points = {
+       position(i - 1), position(i), position(i + 1), position(i + 2)};
+      ribbon_mesh_attr.sides = {sides[i], sides[i + 1]};
+      ribbon_mesh_attr.width = options.width;
+      ribbon_mesh_attr.thickness = options.thickness;
+      ribbon_mesh_attr.index = sindex++;
+      ribbon_mesh_attr.texcoord = atex;
+      ribbon_mesh_attr.color =
+       options.shading.shade(*res.alpha, spectrum_color(fraction));
+
+      *output++ = ribbon_mesh_attr;
+    }
+  }
+}
+
 } // namespace molphene
 
 #endif
@@ -84,6 +84,11 @@ struct gl_vertex_attrib<vec3<T>> : gl_attrib_pointer_type<T> {
   static constexpr GLint size = 3;
 };
 
+template<typename T>
+struct gl_vertex_attrib<rgba<T>> : gl_attrib_pointer_type<T> {
+  static constexpr GLint size = 4;
+};
+
 template<typename T>
 struct gl_vertex_attrib<mat4<T>> : gl_attrib_pointer_type<T> {
   static constexpr GLint size = 4;
@@ -0,0 +1,197 @@
+#include "program_binary_cache.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+#if !defined(__EMSCRIPTEN__) && defined(GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+#define MOLPHENE_PROGRAM_BINARY 1
+#endif
+
+namespace molphene {
+namespace {
+
+constexpr auto fnv_offset_basis = std::uint64_t{0xcbf29ce484222325};
+constexpr auto fnv_prime = std::uint64_t{0x100000001b3};
+
+constexpr auto entry_magic = std::uint32_t{0x4d504243};
+
+struct entry_header {
+  std::uint32_t magic;
+  std::uint32_t format;
+  std::uint64_t key;
+  std::uint64_t length;
+};
+
+auto fnv1a(std::uint64_t hash, std::string_view str) noexcept -> std::uint64_t
+{
+  for(auto c : str) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= fnv_prime;
+  }
+  // separator, so that {"ab", "c"} and {"a", "bc"} hash differently
+  hash ^= 0xff;
+  hash *= fnv_prime;
+  return hash;
+}
+
+auto gl_string(GLenum name) noexcept -> std::string_view
+{
+  const auto* str = reinterpret_cast<const char*>(glGetString(name));
+  return str ? str : "";
+}
+
+#ifdef MOLPHENE_PROGRAM_BINARY
+auto program_binary_supported() noexcept -> bool
+{
+  auto formats = GLint{0};
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  return formats > 0;
+}
+#endif
+
+} // namespace
+
+program_binary_cache::program_binary_cache()
+{
+  if(const auto* dir = std::getenv("MOLPHENE_PROGRAM_CACHE_DIR")) {
+    directory_ = dir;
+  }
+}
+
+void program_binary_cache::directory(std::string path)
+{
+  directory_ = std::move(path);
+}
+
+auto program_binary_cache::directory() const noexcept -> const std::string&
+{
+  return directory_;
+}
+
+auto program_binary_cache::enabled() const noexcept -> bool
+{
+#ifdef MOLPHENE_PROGRAM_BINARY
+  return !directory_.empty();
+#else
+  return false;
+#endif
+}
+
+auto program_binary_cache::make_key(
+ std::initializer_list<std::string_view> sources) const noexcept -> key_type
+{
+  auto hash = fnv_offset_basis;
+  for(auto source : sources) {
+    hash = fnv1a(hash, source);
+  }
+  hash = fnv1a(hash, gl_string(GL_VENDOR));
+  hash = fnv1a(hash, gl_string(GL_RENDERER));
+  hash = fnv1a(hash, gl_string(GL_VERSION));
+  return hash;
+}
+
+void program_binary_cache::prepare(GLuint program) const noexcept
+{
+#ifdef MOLPHENE_PROGRAM_BINARY
+  if(enabled() && program_binary_supported()) {
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+#endif
+}
+
+auto program_binary_cache::load(GLuint program, key_type key) const noexcept
+ -> bool
+{
+#ifdef MOLPHENE_PROGRAM_BINARY
+  if(!enabled() || !program_binary_supported()) {
+    return false;
+  }
+
+  auto file =
+   std::ifstream{entry_path(key), std::ios::binary | std::ios::ate};
+  if(!file) {
+    return false;
+  }
+
+  const auto file_size = static_cast<std::uint64_t>(file.tellg());
+  file.seekg(0);
+
+  auto header = entry_header{};
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if(!file || header.magic != entry_magic || header.key != key ||
+     header.length == 0 || header.length > file_size - sizeof(header)) {
+    return false;
+  }
+
+  auto binary = std::vector<char>(header.length);
+  file.read(binary.data(), binary.size());
+  if(!file) {
+    return false;
+  }
+
+  glProgramBinary(program, header.format, binary.data(), binary.size());
+
+  auto link_status = GLint{GL_FALSE};
+  glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+  return link_status == GL_TRUE;
+#else
+  return false;
+#endif
+}
+
+void program_binary_cache::store(GLuint program, key_type key) const noexcept
+{
+#ifdef MOLPHENE_PROGRAM_BINARY
+  if(!enabled() || !program_binary_supported()) {
+    return;
+  }
+
+  auto length = GLint{0};
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if(length <= 0) {
+    return;
+  }
+
+  auto binary = std::vector<char>(length);
+  auto format = GLenum{0};
+  glGetProgramBinary(program, length, &length, &format, binary.data());
+  if(length <= 0) {
+    return;
+  }
+
+  // Written aside and renamed into place, so that a load never sees half an
+  // entry.
+  const auto target = entry_path(key);
+  const auto written = target + ".tmp";
+
+  {
+    auto file = std::ofstream{written, std::ios::binary | std::ios::trunc};
+    const auto header = entry_header{entry_magic,
+                                     format,
+                                     key,
+                                     static_cast<std::uint64_t>(length)};
+    if(!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+       !file.write(binary.data(), length)) {
+      file.close();
+      std::remove(written.c_str());
+      return;
+    }
+  }
+
+  std::rename(written.c_str(), target.c_str());
+#endif
+}
+
+auto program_binary_cache::entry_path(key_type key) const -> std::string
+{
+  constexpr auto digits = "0123456789abcdef";
+
+  auto name = std::string(sizeof(key) * 2, '0');
+  for(auto it = name.rbegin(); it != name.rend(); ++it, key >>= 4) {
+    *it = digits[key & 0xf];
+  }
+
+  return directory_ + '/' + name + ".glprog";
+}
+
+} // namespace molphene
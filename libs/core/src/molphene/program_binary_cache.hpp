@@ -0,0 +1,43 @@
+#ifndef MOLPHENE_PROGRAM_BINARY_CACHE_HPP
+#define MOLPHENE_PROGRAM_BINARY_CACHE_HPP
+
+#include "stdafx.hpp"
+
+#include "opengl.hpp"
+
+namespace molphene {
+
+// On-disk cache of linked program binaries. Entries are keyed by a hash of
+// the shader sources, the attribute bindings and the GL vendor, renderer and
+// version strings, so a driver update simply misses the cache. Does nothing
+// without a directory or where program binaries are unsupported (WebGL).
+class program_binary_cache {
+public:
+  using key_type = std::uint64_t;
+
+  program_binary_cache();
+
+  void directory(std::string path);
+
+  auto directory() const noexcept -> const std::string&;
+
+  auto enabled() const noexcept -> bool;
+
+  auto make_key(std::initializer_list<std::string_view> sources) const noexcept
+   -> key_type;
+
+  void prepare(GLuint program) const noexcept;
+
+  auto load(GLuint program, key_type key) const noexcept -> bool;
+
+  void store(GLuint program, key_type key) const noexcept;
+
+private:
+  auto entry_path(key_type key) const -> std::string;
+
+  std::string directory_;
+};
+
+} // namespace molphene
+
+#endif
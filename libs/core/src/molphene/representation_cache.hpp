@@ -0,0 +1,115 @@
+#ifndef MOLPHENE_REPRESENTATION_CACHE_HPP
+#define MOLPHENE_REPRESENTATION_CACHE_HPP
+
+#include "stdafx.hpp"
+
+#include "drawable.hpp"
+
+namespace molphene {
+
+// Built drawables kept by key in most-recently-used order. Once the summed
+// GPU size exceeds the budget the least recently used entries are dropped,
+// except the one just inserted.
+template<typename TKey>
+class basic_representation_cache {
+public:
+  using key_type = TKey;
+
+  using value_type = drawable;
+
+  explicit basic_representation_cache(std::size_t budget_bytes) noexcept
+  : budget_bytes_{budget_bytes}
+  {
+  }
+
+  auto find(const key_type& key) -> const value_type*
+  {
+    const auto it = boost::range::find_if(
+     entries_, [&](const auto& entry) noexcept { return entry.key == key; });
+
+    if(it == entries_.end()) {
+      return nullptr;
+    }
+
+    entries_.splice(entries_.begin(), entries_, it);
+    return &entries_.front().value;
+  }
+
+  auto insert(const key_type& key, value_type value) -> const value_type&
+  {
+    erase(key);
+
+    const auto size = value.size_bytes();
+    entries_.push_front({key, std::move(value), size});
+    size_bytes_ += size;
+
+    evict();
+
+    return entries_.front().value;
+  }
+
+  void erase(const key_type& key) noexcept
+  {
+    entries_.remove_if([&](const auto& entry) noexcept {
+      if(entry.key != key) {
+        return false;
+      }
+      size_bytes_ -= entry.size_bytes;
+      return true;
+    });
+  }
+
+  void clear() noexcept
+  {
+    entries_.clear();
+    size_bytes_ = 0;
+  }
+
+  void budget_bytes(std::size_t value)
+  {
+    budget_bytes_ = value;
+    evict();
+  }
+
+  auto budget_bytes() const noexcept -> std::size_t
+  {
+    return budget_bytes_;
+  }
+
+  auto size_bytes() const noexcept -> std::size_t
+  {
+    return size_bytes_;
+  }
+
+  auto size() const noexcept -> std::size_t
+  {
+    return entries_.size();
+  }
+
+private:
+  struct entry {
+    key_type key;
+
+    value_type value;
+
+    std::size_t size_bytes;
+  };
+
+  void evict() noexcept
+  {
+    while(size_bytes_ > budget_bytes_ && entries_.size() > 1) {
+      size_bytes_ -= entries_.back().size_bytes;
+      entries_.pop_back();
+    }
+  }
+
+  std::list<entry> entries_;
+
+  std::size_t budget_bytes_;
+
+  std::size_t size_bytes_{0};
+};
+
+} // namespace molphene
+
+#endif
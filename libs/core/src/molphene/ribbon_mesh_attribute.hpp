@@ -0,0 +1,27 @@
+#ifndef MOLPHENE_RIBBON_MESH_ATTRIBUTE_HPP
+#define MOLPHENE_RIBBON_MESH_ATTRIBUTE_HPP
+
+#include "stdafx.hpp"
+
+#include "m3d.hpp"
+
+namespace molphene {
+
+// One residue of a ribbon, the piece of a Catmull-Rom spline through the
+// alpha carbons that runs from points[1] to points[2].
+struct ribbon_mesh_attribute {
+  rgba8 color{};
+  std::size_t index{};
+  vec2<double> texcoord{};
+  std::array<vec3<double>, 4> points;
+
+  // Unit directions across the ribbon at points[1] and points[2].
+  std::array<vec3<double>, 2> sides;
+
+  double width{2};
+  double thickness{0.5};
+};
+
+} // namespace molphene
+
+#endif
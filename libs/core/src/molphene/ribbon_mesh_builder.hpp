@@ -0,0 +1,155 @@
+#ifndef MOLPHENE_RIBBON_MESH_BUILDER_HPP
+#define MOLPHENE_RIBBON_MESH_BUILDER_HPP
+
+#include "stdafx.hpp"
+
+#include "m3d.hpp"
+
+namespace molphene {
+
+template<typename TSegment>
+struct build_ribbon_mesh_position_params {
+  TSegment segment;
+
+  constexpr explicit build_ribbon_mesh_position_params(
+   TSegment segment) noexcept
+  : segment{segment}
+  {
+  }
+};
+
+template<typename TSegment>
+struct build_ribbon_mesh_normal_params {
+  TSegment segment;
+
+  constexpr explicit build_ribbon_mesh_normal_params(TSegment segment) noexcept
+  : segment{segment}
+  {
+  }
+};
+
+template<typename TSegment, typename TVertex>
+struct build_ribbon_mesh_fill_params {
+  TSegment segment;
+  TVertex vertex;
+
+  constexpr build_ribbon_mesh_fill_params(TSegment segment,
+                                          TVertex vertex) noexcept
+  : segment{segment}
+  , vertex{vertex}
+  {
+  }
+};
+
+// Sweeps an elliptic cross-section along one spline segment. The section is
+// split into VSectionDivs bands around, each a triangle strip of VSegmentDivs
+// quads along the segment, joined to the next band by degenerate triangles.
+template<std::size_t VSegmentDivs,
+         std::size_t VSectionDivs,
+         typename TConfig = void>
+class ribbon_mesh_builder {
+public:
+  using size_type = std::size_t;
+  using float_type = typename type_configs<TConfig>::float_type;
+
+  static constexpr auto segment_divs = VSegmentDivs;
+  static constexpr auto section_divs = VSectionDivs;
+
+public:
+  template<typename Seg, typename OutputIt, typename Function>
+  constexpr void build_vertices(Seg seg, OutputIt output, Function func) const
+   noexcept
+  {
+    const auto& p0 = seg.points[0];
+    const auto& p1 = seg.points[1];
+    const auto& p2 = seg.points[2];
+    const auto& p3 = seg.points[3];
+
+    const auto c1 = (p2 - p0) * 0.5;
+    const auto c2 = p0 - p1 * 2.5 + p2 * 2 - p3 * 0.5;
+    const auto c3 = (p1 - p2) * 1.5 + (p3 - p0) * 0.5;
+
+    const auto half_width = seg.width / 2;
+    const auto half_thickness = seg.thickness / 2;
+
+    constexpr auto pi = M_PI;
+
+    for(auto k = size_type{0}; k < section_divs; ++k) {
+      for(auto i = size_type{0}; i <= segment_divs; ++i) {
+        const auto t = double(i) / segment_divs;
+
+        const auto center = p1 + c1 * t + c2 * (t * t) + c3 * (t * t * t);
+        const auto tangent = (c1 + c2 * (2 * t) + c3 * (3 * t * t)).to_unit();
+
+        const auto blend = seg.sides[0] * (1 - t) + seg.sides[1] * t;
+        const auto side = (blend - tangent * blend.dot(tangent)).to_unit();
+        const auto up = tangent.cross(side);
+
+        for(auto j = k; j <= k + 1; ++j) {
+          const auto theta = pi * 2 * j / section_divs;
+          const auto sin_theta = std::sin(theta);
+          const auto cos_theta = std::cos(theta);
+
+          const auto pos = center + side * (cos_theta * half_width) +
+                           up * (sin_theta * half_thickness);
+          const auto norm = (side * (cos_theta / half_width) +
+                             up * (sin_theta / half_thickness))
+                             .to_unit();
+
+          *output++ = func(pos, norm);
+
+          if((i == 0 && j == k) || (i == segment_divs && j == k + 1)) {
+            *output++ = func(pos, norm);
+          }
+        }
+      }
+    }
+  }
+
+  template<typename Seg, typename OutputIt>
+  constexpr void build_positions(Seg seg, OutputIt output) const noexcept
+  {
+    build_vertices(
+     seg, output, [=](auto pos, auto) noexcept { return pos; });
+  }
+
+  template<typename TSeg, typename OutputIt>
+  constexpr void build(build_ribbon_mesh_position_params<TSeg> seg,
+                       OutputIt output) const noexcept
+  {
+    return build_positions(seg.segment, output);
+  }
+
+  template<typename Seg, typename OutputIt>
+  constexpr void build_normals(Seg seg, OutputIt output) const noexcept
+  {
+    build_vertices(
+     seg, output, [](auto, auto norm) noexcept { return norm; });
+  }
+
+  template<typename TSeg, typename OutputIt>
+  constexpr void build(build_ribbon_mesh_normal_params<TSeg> seg,
+                       OutputIt output) const noexcept
+  {
+    return build_normals(seg.segment, output);
+  }
+
+  template<typename Seg, typename Texcoord, typename OutputIt>
+  constexpr void build(build_ribbon_mesh_fill_params<Seg, Texcoord> params,
+                       OutputIt output) const noexcept
+  {
+    build_vertices(
+     params.segment, output, [vert = params.vertex](auto, auto) noexcept {
+       return vert;
+     });
+  }
+
+  constexpr auto vertices_size() const noexcept -> size_type
+  {
+    return ((segment_divs + 1) * 2 + 2) * section_divs;
+  }
+};
+
+} // namespace molphene
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef MOLPHENE_RIBBON_REPRESENTATION_HPP
+#define MOLPHENE_RIBBON_REPRESENTATION_HPP
+
+#include "stdafx.hpp"
+
+#include "assembly.hpp"
+#include "color_light_shader.hpp"
+#include "m3d.hpp"
+#include "molecule_to_shape.hpp"
+#include "ribbon_mesh_attribute.hpp"
+#include "ribbon_vertex_buffers_batch.hpp"
+#include "utility.hpp"
+
+#include <molecule/molecule.hpp>
+
+namespace molphene {
+
+template<typename TRibbonBuffers>
+class basic_ribbon_representation {
+public:
+  using ribbon_buffers_type = TRibbonBuffers;
+
+  double width{2};
+
+  double thickness{0.5};
+
+  atom_shading shading;
+
+  ribbon_buffers_type ribbon_buffers;
+
+  // Places the copies of the atoms in the biological assembly, as in
+  // molecule::assembly_transforms.
+  std::vector<mat4<float>> assembly_transforms;
+
+  using mesh_attributes_type = std::vector<ribbon_mesh_attribute>;
+
+  // Ribbons follow the chains of the molecule, so they take the whole of it
+  // rather than a range of atoms.
+  auto build_mesh_attributes(const molecule& mol) const -> mesh_attributes_type
+  {
+    auto ribbon_mesh_attrs = mesh_attributes_type{};
+
+    backbone_to_ribbon_attrs(mol,
+                             std::back_inserter(ribbon_mesh_attrs),
+                             {width, thickness, shading});
+
+    return ribbon_mesh_attrs;
+  }
+
+  void build_vertex_buffers(const molecule& mol)
+  {
+    const auto ribbon_mesh_attrs = build_mesh_attributes(mol);
+
+    ribbon_buffers.build_buffers(ribbon_mesh_attrs);
+  }
+
+  template<typename TUploadQueue>
+  void
+  enqueue_vertex_buffers(std::shared_ptr<const mesh_attributes_type> mesh_attrs,
+                         TUploadQueue& queue)
+  {
+    ribbon_buffers.enqueue_build_buffers(std::move(mesh_attrs), queue);
+  }
+
+  auto size_bytes() const noexcept -> std::size_t
+  {
+    return static_cast<std::size_t>(ribbon_buffers.size_bytes());
+  }
+
+  void render(const color_light_shader& shader) const noexcept
+  {
+    draw_assembly_copies(shader, assembly_transforms, [&]() noexcept {
+      ribbon_buffers.draw(shader);
+    });
+  }
+};
+
+using ribbon_representation =
+ basic_ribbon_representation<ribbon_vertex_buffers_packed>;
+
+} // namespace molphene
+
+#endif
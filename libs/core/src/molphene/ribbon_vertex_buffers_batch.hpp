@@ -0,0 +1,187 @@
+#ifndef MOLPHENE_RIBBON_VERTEX_BUFFERS_BATCH_HPP
+#define MOLPHENE_RIBBON_VERTEX_BUFFERS_BATCH_HPP
+
+#include "stdafx.hpp"
+
+#include "opengl.hpp"
+
+#include "attribs_buffer_array.hpp"
+#include "color_image_texture.hpp"
+#include "color_light_shader.hpp"
+
+#include "buffers_builder.hpp"
+#include "chunk_vertex_arrays.hpp"
+#include "gl_vertex_attribs_guard.hpp"
+#include "instance_cluster.hpp"
+#include "ribbon_mesh_builder.hpp"
+#include "shader_attrib_location.hpp"
+
+namespace molphene {
+
+template<typename TLayout = chunked_buffer_layout>
+class basic_ribbon_vertex_buffers_batch {
+public:
+  using layout_type = TLayout;
+
+  using attribs_guard =
+   gl_vertex_attribs_guard<shader_attrib_location::vertex,
+                           shader_attrib_location::normal,
+                           shader_attrib_location::texcoordcolor>;
+
+  static constexpr auto ribbon_builder = ribbon_mesh_builder<6, 8>{};
+
+  std::unique_ptr<color_image_texture> color_texture;
+
+  std::unique_ptr<positions_buffer_array> buffer_positions;
+
+  std::unique_ptr<normals_buffer_array> buffer_normals;
+
+  std::unique_ptr<texcoords_buffer_array> buffer_texcoords;
+
+  chunk_vertex_arrays vertex_arrays;
+
+  std::vector<instance_cluster> clusters;
+
+  template<typename TRangeRibbonMeshAttr>
+  void build_buffers(TRangeRibbonMeshAttr&& ribbon_mesh_attrs)
+  {
+    buffer_positions = build_ribbon_mesh_positions<layout_type>(
+     ribbon_builder, ribbon_mesh_attrs);
+
+    buffer_normals = build_ribbon_mesh_normals<layout_type>(
+     ribbon_builder, ribbon_mesh_attrs);
+
+    buffer_texcoords = build_ribbon_mesh_texcoords<layout_type>(
+     ribbon_builder, ribbon_mesh_attrs);
+
+    color_texture = build_shape_color_texture(ribbon_mesh_attrs);
+
+    clusters = build_instance_clusters(
+     ribbon_mesh_attrs, buffer_positions->instances_per_block());
+
+    record_vertex_arrays();
+  }
+
+  // Every task holds ribbon_mesh_attrs, which the caller makes own these
+  // buffers as well.
+  template<typename TRangeRibbonMeshAttr, typename TUploadQueue>
+  void enqueue_build_buffers(
+   std::shared_ptr<const TRangeRibbonMeshAttr> ribbon_mesh_attrs,
+   TUploadQueue& queue)
+  {
+    enqueue_ribbon_mesh_positions<layout_type>(
+     queue, buffer_positions, ribbon_builder, ribbon_mesh_attrs);
+
+    enqueue_ribbon_mesh_normals<layout_type>(
+     queue, buffer_normals, ribbon_builder, ribbon_mesh_attrs);
+
+    enqueue_ribbon_mesh_texcoords<layout_type>(
+     queue, buffer_texcoords, ribbon_builder, ribbon_mesh_attrs);
+
+    queue.push([this, ribbon_mesh_attrs] {
+      color_texture = build_shape_color_texture(*ribbon_mesh_attrs);
+    });
+
+    queue.push([this, ribbon_mesh_attrs] {
+      clusters = build_instance_clusters(
+       *ribbon_mesh_attrs, buffer_positions->instances_per_block());
+    });
+
+    queue.push([this, ribbon_mesh_attrs] { record_vertex_arrays(); });
+  }
+
+  auto size_bytes() const noexcept -> GLsizeiptr
+  {
+    return buffer_size_bytes(buffer_positions) +
+           buffer_size_bytes(buffer_normals) +
+           buffer_size_bytes(buffer_texcoords) +
+           buffer_size_bytes(color_texture);
+  }
+
+  // Draws the instance clusters nearest first, so that the depth test rejects
+  // the hidden fragments before they are shaded.
+  void draw(const color_light_shader& shader) const noexcept
+  {
+    if(clusters.empty()) {
+      const auto all = instance_range{0, buffer_positions->total_instances()};
+      draw(shader, gsl::span<const instance_range>{&all, 1});
+      return;
+    }
+
+    draw_chunks(shader, [&](auto bind_chunk) {
+      multi_draw_.draw_clusters(GL_TRIANGLE_STRIP,
+                                *buffer_positions,
+                                clusters,
+                                shader.modelview_matrix(),
+                                bind_chunk);
+    });
+  }
+
+  // Draws sorted, non-overlapping instance ranges with one multi-draw call
+  // per chunk they touch.
+  void draw(const color_light_shader& shader,
+            gsl::span<const instance_range> ranges) const noexcept
+  {
+    draw_chunks(shader, [&](auto bind_chunk) {
+      multi_draw_.draw_ranges(
+       GL_TRIANGLE_STRIP, *buffer_positions, ranges, bind_chunk);
+    });
+  }
+
+private:
+  void record_vertex_arrays()
+  {
+    vertex_arrays = record_chunk_vertex_arrays<attribs_guard>(
+     buffer_positions->size(),
+     [this](GLsizei index) noexcept { bind_chunk_attribs(index); });
+  }
+
+  // Sets the shader and attribute state around draw(bind_chunk), which draws
+  // from the chunks it binds with bind_chunk(index).
+  template<typename TDraw>
+  void draw_chunks(const color_light_shader& shader, TDraw draw) const noexcept
+  {
+    assert(
+     all_has_same_props(*buffer_positions, *buffer_normals, *buffer_texcoords));
+
+    shader.color_texture_image(color_texture->texture());
+
+    const auto use_vertex_arrays = !vertex_arrays.empty();
+
+    auto verts_guard = std::optional<attribs_guard>{};
+    if(!use_vertex_arrays) {
+      verts_guard.emplace();
+    }
+
+    draw([&](GLsizei index) noexcept {
+      if(use_vertex_arrays) {
+        vertex_arrays[index]->bind();
+      } else {
+        bind_chunk_attribs(index);
+      }
+    });
+
+    if(use_vertex_arrays) {
+      gl::vertex_array::unbind();
+    }
+  }
+
+  void bind_chunk_attribs(GLsizei index) const noexcept
+  {
+    buffer_positions->bind_attrib_pointer_index(index);
+    buffer_normals->bind_attrib_pointer_index(index);
+    buffer_texcoords->bind_attrib_pointer_index(index);
+  }
+
+  mutable chunk_multi_draw multi_draw_;
+};
+
+using ribbon_vertex_buffers_batch =
+ basic_ribbon_vertex_buffers_batch<chunked_buffer_layout>;
+
+using ribbon_vertex_buffers_packed =
+ basic_ribbon_vertex_buffers_batch<packed_buffer_layout>;
+
+} // namespace molphene
+
+#endif
@@ -7,6 +7,7 @@
 #include <molecule/molecule.hpp>
 
 #include "algorithm.hpp"
+#include "assembly.hpp"
 #include "ballstick_representation.hpp"
 #include "bounding_sphere.hpp"
 #include "cylinder_mesh_attribute.hpp"
@@ -62,17 +63,53 @@ public:
     return true;
   }
 
-  void reset_mesh(const molecule& mol) noexcept
+  static auto compute_bounding_sphere(const molecule& mol) noexcept
+   -> bounding_sphere_type
   {
     namespace range = boost::range;
 
-    // calculate bounding sphere
-    bounding_sphere_.reset();
+    auto bounding_sphere = bounding_sphere_type{};
     range::transform(
-     mol.atoms(), expand_iterator{bounding_sphere_}, [](auto atom) noexcept {
+     mol.atoms(), expand_iterator{bounding_sphere}, [](auto& atom) noexcept {
        return atom.position();
      });
 
+    const auto transforms = mol.assembly_transforms();
+    if(transforms.empty() || bounding_sphere.radius() < 0) {
+      return bounding_sphere;
+    }
+
+    // Grows over each copy of the atoms' sphere through its points nearest
+    // to and farthest from the center so far.
+    const auto unit = bounding_sphere;
+    bounding_sphere.reset();
+    for(const auto& transform : transforms) {
+      const auto center = transform_point(transform, unit.center());
+
+      auto outward = bounding_sphere.radius() < 0
+                      ? vec3f{1, 0, 0}
+                      : center - bounding_sphere.center();
+      if(outward.magnitude() == 0) {
+        outward = {1, 0, 0};
+      }
+      outward = outward.to_unit() * unit.radius();
+
+      bounding_sphere.expand(center + outward);
+      bounding_sphere.expand(center - outward);
+    }
+
+    return bounding_sphere;
+  }
+
+  void reset_mesh(const molecule& mol) noexcept
+  {
+    reset_mesh(compute_bounding_sphere(mol));
+  }
+
+  void reset_mesh(const bounding_sphere_type& bounding_sphere) noexcept
+  {
+    bounding_sphere_ = bounding_sphere;
+
     model_matrix_.identity().translate(-bounding_sphere_.center());
   }
 
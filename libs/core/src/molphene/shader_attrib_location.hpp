@@ -13,7 +13,11 @@ enum class shader_attrib_location : GLuint {
   transformation,
   transformation_1,
   transformation_2,
-  transformation_3
+  transformation_3,
+  next_transformation,
+  next_transformation_1,
+  next_transformation_2,
+  next_transformation_3
 };
 
 template<shader_attrib_location...>
@@ -63,6 +67,26 @@ struct traits<shader_attrib_location::transformation_3> {
   static inline const GLchar* name = "a_Transformation3";
 };
 
+template<>
+struct traits<shader_attrib_location::next_transformation> {
+  static inline const GLchar* name = "a_NextTransformation";
+};
+
+template<>
+struct traits<shader_attrib_location::next_transformation_1> {
+  static inline const GLchar* name = "a_NextTransformation1";
+};
+
+template<>
+struct traits<shader_attrib_location::next_transformation_2> {
+  static inline const GLchar* name = "a_NextTransformation2";
+};
+
+template<>
+struct traits<shader_attrib_location::next_transformation_3> {
+  static inline const GLchar* name = "a_NextTransformation3";
+};
+
 } // namespace molphene
 
 #endif
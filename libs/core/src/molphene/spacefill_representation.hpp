@@ -3,6 +3,7 @@
 
 #include "stdafx.hpp"
 
+#include "assembly.hpp"
 #include "attribs_buffer_array.hpp"
 #include "color_image_texture.hpp"
 #include "color_light_shader.hpp"
@@ -26,23 +27,74 @@ public:
 
   double radius_size{1};
 
+  atom_shading shading;
+
   ColorManager color_manager;
 
   sphere_buffers_type atom_sphere_buffers;
 
+  // Places the copies of the atoms in the biological assembly, as in
+  // molecule::assembly_transforms.
+  std::vector<mat4<float>> assembly_transforms;
+
+  using mesh_attributes_type = std::vector<sphere_mesh_attribute>;
+
   template<typename TSizedRangeAtoms>
-  void build_vertex_buffers(TSizedRangeAtoms&& atoms)
+  auto build_mesh_attributes(const TSizedRangeAtoms& atoms) const
+   -> mesh_attributes_type
   {
     auto sphere_mesh_attrs =
      detail::make_reserved_vector<sphere_mesh_attribute>(atoms.size());
 
-    atoms_to_sphere_attrs(std::forward<TSizedRangeAtoms>(atoms),
+    atoms_to_sphere_attrs(atoms,
                           std::back_inserter(sphere_mesh_attrs),
-                          {radius_type, radius_size, 1.});
+                          {radius_type, radius_size, 1., shading});
+
+    return sphere_mesh_attrs;
+  }
+
+  template<typename TSizedRangeAtoms>
+  void build_vertex_buffers(TSizedRangeAtoms&& atoms)
+  {
+    const auto sphere_mesh_attrs = build_mesh_attributes(atoms);
 
     atom_sphere_buffers.build_buffers(sphere_mesh_attrs);
   }
 
+  template<typename TUploadQueue>
+  void
+  enqueue_vertex_buffers(std::shared_ptr<const mesh_attributes_type> mesh_attrs,
+                         TUploadQueue& queue)
+  {
+    atom_sphere_buffers.enqueue_build_buffers(std::move(mesh_attrs), queue);
+  }
+
+  // Moves the spheres to the current positions of the same atoms the buffers
+  // were built from, as when stepping through a trajectory. Only the
+  // per-instance transforms are uploaded, so the sphere buffers must be
+  // instanced.
+  template<typename TSizedRangeAtoms>
+  void update_positions(const TSizedRangeAtoms& atoms)
+  {
+    atom_sphere_buffers.update_transforms(build_mesh_attributes(atoms));
+  }
+
+  // Makes the current positions of the atoms the later keyframe. The spheres
+  // stay where they were drawn until frame_interpolation moves them on.
+  template<typename TSizedRangeAtoms>
+  void push_keyframe(const TSizedRangeAtoms& atoms)
+  {
+    atom_sphere_buffers.push_keyframe(build_mesh_attributes(atoms));
+    frame_interpolation(0);
+  }
+
+  // Draws the spheres at t between the earlier keyframe, at 0, and the later
+  // one, at 1, without uploading anything.
+  void frame_interpolation(float t) noexcept
+  {
+    atom_sphere_buffers.frame_interpolation = t;
+  }
+
   template<typename TAtomElement>
   auto atom_radius(TAtomElement element) const noexcept -> double
   {
@@ -61,9 +113,16 @@ public:
     return color_manager.get_element_color(atom.element().symbol);
   }
 
+  auto size_bytes() const noexcept -> std::size_t
+  {
+    return static_cast<std::size_t>(atom_sphere_buffers.size_bytes());
+  }
+
   void render(const color_light_shader& shader) const noexcept
   {
-    atom_sphere_buffers.draw(shader);
+    draw_assembly_copies(shader, assembly_transforms, [&]() noexcept {
+      atom_sphere_buffers.draw(shader);
+    });
   }
 };
 
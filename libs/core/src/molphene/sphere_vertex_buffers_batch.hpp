@@ -11,76 +11,195 @@
 
 #include "algorithm.hpp"
 #include "buffers_builder.hpp"
+#include "chunk_vertex_arrays.hpp"
 #include "gl_vertex_attribs_guard.hpp"
+#include "instance_cluster.hpp"
 #include "shader_attrib_location.hpp"
 #include "sphere_mesh_builder.hpp"
 #include "utility.hpp"
+#include "vertex_format.hpp"
 
 namespace molphene {
 
-template<typename = void>
+template<typename TLayout = chunked_buffer_layout,
+         typename TFormat = float_vertex_format>
 class basic_sphere_vertex_buffers_batch {
 public:
+  using layout_type = TLayout;
+
+  using format_type = TFormat;
+
+  using attribs_guard =
+   gl_vertex_attribs_guard<shader_attrib_location::vertex,
+                           shader_attrib_location::normal,
+                           shader_attrib_location::texcoordcolor>;
+
   static constexpr auto sph_mesh_builder = sphere_mesh_builder<10, 20>{};
 
   std::unique_ptr<color_image_texture> color_texture;
 
-  std::unique_ptr<positions_buffer_array> buffer_positions;
+  std::unique_ptr<typename format_type::positions_array_type> buffer_positions;
+
+  std::unique_ptr<typename format_type::normals_array_type> buffer_normals;
+
+  std::unique_ptr<typename format_type::texcoords_array_type> buffer_texcoords;
 
-  std::unique_ptr<normals_buffer_array> buffer_normals;
+  chunk_vertex_arrays vertex_arrays;
 
-  std::unique_ptr<texcoords_buffer_array> buffer_texcoords;
+  std::vector<instance_cluster> clusters;
 
   template<typename TRangeSphereMeshAttr>
   void build_buffers(TRangeSphereMeshAttr&& sphere_mesh_attrs)
   {
-    buffer_positions = build_sphere_mesh_positions(
+    buffer_positions = build_sphere_mesh_positions<layout_type, format_type>(
      sph_mesh_builder, std::forward<TRangeSphereMeshAttr>(sphere_mesh_attrs));
 
-    buffer_normals = build_sphere_mesh_normals(
+    buffer_normals = build_sphere_mesh_normals<layout_type, format_type>(
      sph_mesh_builder, std::forward<TRangeSphereMeshAttr>(sphere_mesh_attrs));
 
-    buffer_texcoords = build_sphere_mesh_texcoords(
+    buffer_texcoords = build_sphere_mesh_texcoords<layout_type, format_type>(
      sph_mesh_builder, std::forward<TRangeSphereMeshAttr>(sphere_mesh_attrs));
 
     color_texture = build_shape_color_texture(
      std::forward<TRangeSphereMeshAttr>(sphere_mesh_attrs));
+
+    clusters = build_instance_clusters(
+     sphere_mesh_attrs, buffer_positions->instances_per_block());
+
+    record_vertex_arrays();
   }
 
+  // Every task holds sphere_mesh_attrs, which the caller makes own these
+  // buffers as well.
+  template<typename TRangeSphereMeshAttr, typename TUploadQueue>
+  void enqueue_build_buffers(
+   std::shared_ptr<const TRangeSphereMeshAttr> sphere_mesh_attrs,
+   TUploadQueue& queue)
+  {
+    enqueue_sphere_mesh_positions<layout_type, format_type>(
+     queue, buffer_positions, sph_mesh_builder, sphere_mesh_attrs);
+
+    enqueue_sphere_mesh_normals<layout_type, format_type>(
+     queue, buffer_normals, sph_mesh_builder, sphere_mesh_attrs);
+
+    enqueue_sphere_mesh_texcoords<layout_type, format_type>(
+     queue, buffer_texcoords, sph_mesh_builder, sphere_mesh_attrs);
+
+    queue.push([this, sphere_mesh_attrs] {
+      color_texture = build_shape_color_texture(*sphere_mesh_attrs);
+    });
+
+    queue.push([this, sphere_mesh_attrs] {
+      clusters = build_instance_clusters(
+       *sphere_mesh_attrs, buffer_positions->instances_per_block());
+    });
+
+    queue.push([this, sphere_mesh_attrs] { record_vertex_arrays(); });
+  }
+
+  auto size_bytes() const noexcept -> GLsizeiptr
+  {
+    return buffer_size_bytes(buffer_positions) +
+           buffer_size_bytes(buffer_normals) +
+           buffer_size_bytes(buffer_texcoords) +
+           buffer_size_bytes(color_texture);
+  }
+
+  // Draws the instance clusters nearest first, so that the depth test rejects
+  // the hidden fragments before they are shaded.
   void draw(const color_light_shader& shader) const noexcept
   {
-    const auto verts_guard =
-     gl_vertex_attribs_guard<shader_attrib_location::vertex,
-                             shader_attrib_location::normal,
-                             shader_attrib_location::texcoordcolor>{};
+    if(clusters.empty()) {
+      const auto all = instance_range{0, buffer_positions->total_instances()};
+      draw(shader, gsl::span<const instance_range>{&all, 1});
+      return;
+    }
+
+    draw_chunks(shader, [&](auto bind_chunk) {
+      multi_draw_.draw_clusters(GL_TRIANGLE_STRIP,
+                                *buffer_positions,
+                                clusters,
+                                shader.modelview_matrix(),
+                                bind_chunk);
+    });
+  }
+
+  // Draws sorted, non-overlapping instance ranges with one multi-draw call
+  // per chunk they touch.
+  void draw(const color_light_shader& shader,
+            gsl::span<const instance_range> ranges) const noexcept
+  {
+    draw_chunks(shader, [&](auto bind_chunk) {
+      multi_draw_.draw_ranges(
+       GL_TRIANGLE_STRIP, *buffer_positions, ranges, bind_chunk);
+    });
+  }
+
+private:
+  void record_vertex_arrays()
+  {
+    vertex_arrays = record_chunk_vertex_arrays<attribs_guard>(
+     buffer_positions->size(),
+     [this](GLsizei index) noexcept { bind_chunk_attribs(index); });
+  }
 
+  // Sets the shader and attribute state around draw(bind_chunk), which draws
+  // from the chunks it binds with bind_chunk(index).
+  template<typename TDraw>
+  void draw_chunks(const color_light_shader& shader, TDraw draw) const noexcept
+  {
     assert(
      all_has_same_props(*buffer_positions, *buffer_normals, *buffer_texcoords));
 
     shader.color_texture_image(color_texture->texture());
+    shader.quantized_vertices(format_type::quantized);
 
-    const auto size = buffer_positions->size();
-    const auto remain_instances = buffer_positions->remain_instances();
-    const auto instances_per_block = buffer_positions->instances_per_block();
-    const auto verts_per_instance = buffer_positions->verts_per_instance();
+    const auto use_vertex_arrays = !vertex_arrays.empty();
 
-    for(auto i = GLsizei{0}; i < size; ++i) {
-      const auto verts_count =
-       GLsizei{i == (size - 1) ? remain_instances : instances_per_block};
-      const auto count = verts_count * verts_per_instance;
-
-      buffer_positions->bind_attrib_pointer_index(i);
-      buffer_normals->bind_attrib_pointer_index(i);
-      buffer_texcoords->bind_attrib_pointer_index(i);
+    auto verts_guard = std::optional<attribs_guard>{};
+    if(!use_vertex_arrays) {
+      verts_guard.emplace();
+    }
 
-      glDrawArrays(GL_TRIANGLE_STRIP, 0, count);
+    draw([&](GLsizei index) noexcept {
+      if constexpr(format_type::quantized) {
+        const auto& quantization = buffer_positions->quantizations[index];
+        shader.position_quantization(quantization.offset, quantization.scale);
+      }
+
+      if(use_vertex_arrays) {
+        vertex_arrays[index]->bind();
+      } else {
+        bind_chunk_attribs(index);
+      }
+    });
+
+    if(use_vertex_arrays) {
+      gl::vertex_array::unbind();
     }
+
+    shader.quantized_vertices(false);
   }
 
-private:
+  void bind_chunk_attribs(GLsizei index) const noexcept
+  {
+    buffer_positions->bind_attrib_pointer_index(index);
+    buffer_normals->bind_attrib_pointer_index(index);
+    buffer_texcoords->bind_attrib_pointer_index(index);
+  }
+
+  mutable chunk_multi_draw multi_draw_;
 };
 
-using sphere_vertex_buffers_batch = basic_sphere_vertex_buffers_batch<void>;
+using sphere_vertex_buffers_batch =
+ basic_sphere_vertex_buffers_batch<chunked_buffer_layout>;
+
+using sphere_vertex_buffers_packed =
+ basic_sphere_vertex_buffers_batch<packed_buffer_layout>;
+
+using sphere_vertex_buffers_quantized =
+ basic_sphere_vertex_buffers_batch<packed_buffer_layout,
+                                   quantized_vertex_format>;
 
 } // namespace molphene
 
@@ -10,6 +10,7 @@
 #include "color_light_shader.hpp"
 
 #include "buffers_builder.hpp"
+#include "chunk_vertex_arrays.hpp"
 #include "gl/draw_instanced_arrays.hpp"
 #include "gl_vertex_attribs_guard.hpp"
 #include "instance_copy_builder.hpp"
@@ -23,6 +24,18 @@ namespace molphene {
 template<typename = void>
 class basic_sphere_vertex_buffers_instanced {
 public:
+  using attribs_guard =
+   gl_vertex_attribs_guard<shader_attrib_location::vertex,
+                           shader_attrib_location::texcoordcolor,
+                           shader_attrib_location::transformation,
+                           shader_attrib_location::transformation_1,
+                           shader_attrib_location::transformation_2,
+                           shader_attrib_location::transformation_3,
+                           shader_attrib_location::next_transformation,
+                           shader_attrib_location::next_transformation_1,
+                           shader_attrib_location::next_transformation_2,
+                           shader_attrib_location::next_transformation_3>;
+
   static constexpr auto sph_mesh_builder = sphere_mesh_builder<10, 20>{};
 
   static constexpr auto copy_builder = instance_copy_builder{};
@@ -31,69 +44,184 @@ public:
 
   std::unique_ptr<positions_buffer_array> buffer_positions;
 
-  std::unique_ptr<normals_buffer_array> buffer_normals;
-
   std::unique_ptr<texcoords_instances_buffer_array> buffer_texcoords;
 
   std::unique_ptr<transforms_instances_buffer_array> buffer_transforms;
 
+  std::unique_ptr<next_transforms_instances_buffer_array>
+   buffer_next_transforms;
+
+  // Where the instances are drawn between the earlier and the later of the
+  // two keyframes held, from 0 to 1.
+  float frame_interpolation{0};
+
+  chunk_vertex_arrays vertex_arrays;
+
   template<typename TRangeSphereMeshAttr>
   void build_buffers(TRangeSphereMeshAttr&& sphere_mesh_attrs)
   {
+    // A unit sphere at the origin, whose normals are its positions.
     const auto sphere_attr = std::array<sphere_mesh_attribute, 1>{};
 
     buffer_positions =
      build_sphere_mesh_positions(sph_mesh_builder, sphere_attr);
 
-    buffer_normals = build_sphere_mesh_normals(sph_mesh_builder, sphere_attr);
-
     buffer_texcoords = build_sphere_mesh_texcoord_instances(
      copy_builder, std::forward<TRangeSphereMeshAttr>(sphere_mesh_attrs));
 
     buffer_transforms = build_sphere_mesh_transform_instances(
      copy_builder, std::forward<TRangeSphereMeshAttr>(sphere_mesh_attrs));
 
+    if(color_light_shader::keyframes_supported()) {
+      buffer_next_transforms = build_sphere_mesh_transform_instances<
+       next_transforms_instances_buffer_array>(copy_builder, sphere_mesh_attrs);
+    }
+
     color_texture = build_shape_color_texture(
      std::forward<TRangeSphereMeshAttr>(sphere_mesh_attrs));
+
+    record_vertex_arrays();
+  }
+
+  // Every task holds sphere_mesh_attrs, which the caller makes own these
+  // buffers as well.
+  template<typename TRangeSphereMeshAttr, typename TUploadQueue>
+  void enqueue_build_buffers(
+   std::shared_ptr<const TRangeSphereMeshAttr> sphere_mesh_attrs,
+   TUploadQueue& queue)
+  {
+    queue.push([this, sphere_mesh_attrs] {
+      const auto sphere_attr = std::array<sphere_mesh_attribute, 1>{};
+
+      buffer_positions =
+       build_sphere_mesh_positions(sph_mesh_builder, sphere_attr);
+    });
+
+    enqueue_sphere_mesh_texcoord_instances(
+     queue, buffer_texcoords, copy_builder, sphere_mesh_attrs);
+
+    enqueue_sphere_mesh_transform_instances(
+     queue, buffer_transforms, copy_builder, sphere_mesh_attrs);
+
+    if(color_light_shader::keyframes_supported()) {
+      enqueue_sphere_mesh_transform_instances(
+       queue, buffer_next_transforms, copy_builder, sphere_mesh_attrs);
+    }
+
+    queue.push([this, sphere_mesh_attrs] {
+      color_texture = build_shape_color_texture(*sphere_mesh_attrs);
+    });
+
+    queue.push([this, sphere_mesh_attrs] { record_vertex_arrays(); });
+  }
+
+  // Moves the instances to the spheres of sphere_mesh_attrs, the same
+  // spheres the buffers were built from. The base mesh, the texcoords and the
+  // color texture are left as they are.
+  template<typename TRangeSphereMeshAttr>
+  void update_transforms(const TRangeSphereMeshAttr& sphere_mesh_attrs)
+  {
+    push_keyframe(sphere_mesh_attrs);
+    frame_interpolation = 1;
+  }
+
+  // Makes sphere_mesh_attrs the later keyframe and the later one the
+  // earlier, uploading only the new transforms, over those of the earlier.
+  // Without the next transforms the instances move to each keyframe as it
+  // is pushed.
+  template<typename TRangeSphereMeshAttr>
+  void push_keyframe(const TRangeSphereMeshAttr& sphere_mesh_attrs)
+  {
+    if(!buffer_next_transforms) {
+      update_sphere_mesh_transform_instances(
+       copy_builder, *buffer_transforms, sphere_mesh_attrs);
+      return;
+    }
+
+    if(later_is_next_) {
+      update_sphere_mesh_transform_instances(
+       copy_builder, *buffer_transforms, sphere_mesh_attrs);
+    } else {
+      update_sphere_mesh_transform_instances(
+       copy_builder, *buffer_next_transforms, sphere_mesh_attrs);
+    }
+    later_is_next_ = !later_is_next_;
+  }
+
+  auto size_bytes() const noexcept -> GLsizeiptr
+  {
+    return buffer_size_bytes(buffer_positions) +
+           buffer_size_bytes(buffer_texcoords) +
+           buffer_size_bytes(buffer_transforms) +
+           buffer_size_bytes(buffer_next_transforms) +
+           buffer_size_bytes(color_texture);
   }
 
   void draw(const color_light_shader& shader) const noexcept
   {
-    const auto verts_guard =
-     gl_vertex_attribs_guard<shader_attrib_location::vertex,
-                             shader_attrib_location::normal,
-                             shader_attrib_location::texcoordcolor,
-                             shader_attrib_location::transformation,
-                             shader_attrib_location::transformation_1,
-                             shader_attrib_location::transformation_2,
-                             shader_attrib_location::transformation_3>{};
-
-    assert(all_has_same_props(*buffer_positions, *buffer_normals));
     assert(all_has_same_props(*buffer_transforms, *buffer_texcoords));
+    assert(!buffer_next_transforms ||
+           all_has_same_props(*buffer_transforms, *buffer_next_transforms));
 
     shader.color_texture_image(color_texture->texture());
+    shader.sphere_normals(true);
+    shader.frame_interpolation(later_is_next_ ? frame_interpolation
+                                              : 1 - frame_interpolation);
 
     const auto size = buffer_transforms->size();
-    const auto remain_instances = buffer_transforms->remain_instances();
-    const auto instances_per_block = buffer_transforms->instances_per_block();
-    const auto verts_per_instance = buffer_positions->verts_per_instance();
 
-    buffer_positions->bind_attrib_pointer_index(0);
-    buffer_normals->bind_attrib_pointer_index(0);
+    if(!vertex_arrays.empty()) {
+      for(auto i = GLsizei{0}; i < size; ++i) {
+        vertex_arrays[i]->bind();
+        draw_chunk(i);
+      }
+      gl::vertex_array::unbind();
+    } else {
+      const auto verts_guard = attribs_guard{};
+
+      for(auto i = GLsizei{0}; i < size; ++i) {
+        bind_chunk_attribs(i);
+        draw_chunk(i);
+      }
+    }
 
-    for(auto i = GLsizei{0}; i < size; ++i) {
-      const auto total_instances =
-       GLsizei{i == (size - 1) ? remain_instances : instances_per_block};
+    shader.sphere_normals(false);
+  }
+
+private:
+  // The shader weighs the next transforms by the interpolation, so when the
+  // later keyframe sits in the current transforms the weight is reversed.
+  bool later_is_next_{true};
 
-      buffer_texcoords->bind_attrib_pointer_index(i);
-      buffer_transforms->bind_attrib_pointer_index(i);
+  void record_vertex_arrays()
+  {
+    vertex_arrays = record_chunk_vertex_arrays<attribs_guard>(
+     buffer_transforms->size(),
+     [this](GLsizei index) noexcept { bind_chunk_attribs(index); });
+  }
 
-      gl::draw_arrays_instanced(
-       GL_TRIANGLE_STRIP, 0, verts_per_instance, total_instances);
+  void bind_chunk_attribs(GLsizei index) const noexcept
+  {
+    buffer_positions->bind_attrib_pointer_index(0);
+    buffer_texcoords->bind_attrib_pointer_index(index);
+    buffer_transforms->bind_attrib_pointer_index(index);
+    if(buffer_next_transforms) {
+      buffer_next_transforms->bind_attrib_pointer_index(index);
     }
   }
 
-private:
+  void draw_chunk(GLsizei index) const noexcept
+  {
+    const auto size = buffer_transforms->size();
+    const auto total_instances =
+     GLsizei{index == (size - 1) ? buffer_transforms->remain_instances()
+                                 : buffer_transforms->instances_per_block()};
+
+    gl::draw_arrays_instanced(GL_TRIANGLE_STRIP,
+                              0,
+                              buffer_positions->verts_per_instance(),
+                              total_instances);
+  }
 };
 
 using sphere_vertex_buffers_instanced =
@@ -0,0 +1,78 @@
+#include "ssao_composite_shader.hpp"
+
+namespace molphene {
+
+void ssao_composite_shader::setup_gl_attribs_val() const noexcept
+{
+  glVertexAttrib4f(
+   static_cast<GLuint>(shader_attrib_location::vertex), 0, 0, 0, 1);
+}
+
+auto ssao_composite_shader::vert_shader_source() const noexcept
+ -> const GLchar*
+{
+  return R"VERTEX_SHADER(
+    attribute vec4 a_Vertex;
+
+    varying vec2 v_TexCoord;
+
+    void main() {
+      gl_Position = a_Vertex;
+      v_TexCoord = a_Vertex.xy * 0.5 + 0.5;
+    }
+  )VERTEX_SHADER";
+}
+
+auto ssao_composite_shader::frag_shader_source() const noexcept
+ -> const GLchar*
+{
+  return R"FRAGMENT_SHADER(
+#ifdef GL_ES
+    precision highp float;
+#endif
+    uniform sampler2D u_TexColorImage;
+    uniform sampler2D u_TexDepth;
+    uniform sampler2D u_TexOcclusion;
+
+    uniform vec2 u_OcclusionSize;
+    uniform vec4 u_ProjectionDepth;
+
+    varying vec2 v_TexCoord;
+
+    float viewDepth(vec2 uv) {
+      float d = texture2D(u_TexDepth, uv).r * 2. - 1.;
+      return (u_ProjectionDepth.z - d * u_ProjectionDepth.w) /
+             (d * u_ProjectionDepth.y - u_ProjectionDepth.x);
+    }
+
+    void main() {
+      vec4 color = texture2D(u_TexColorImage, v_TexCoord);
+      float depth = viewDepth(v_TexCoord);
+
+      // Bilinear upsample of the occlusion, with taps across a depth
+      // discontinuity weighted down so that edges stay sharp.
+      vec2 coord = v_TexCoord * u_OcclusionSize - 0.5;
+      vec2 base = floor(coord);
+      vec2 f = coord - base;
+
+      float occlusion = 0.;
+      float weights = 0.;
+      for(int j = 0; j < 2; ++j) {
+        for(int i = 0; i < 2; ++i) {
+          vec2 corner = vec2(float(i), float(j));
+          vec2 tap = (base + corner + 0.5) / u_OcclusionSize;
+          vec2 bilinear = mix(1. - f, f, corner);
+          float w = bilinear.x * bilinear.y /
+                    (1e-3 + abs(viewDepth(tap) - depth) / abs(depth));
+          occlusion += texture2D(u_TexOcclusion, tap).r * w;
+          weights += w;
+        }
+      }
+
+      float ao = weights > 0. ? occlusion / weights : 1.;
+      gl_FragColor = vec4(color.rgb * ao, color.a);
+    }
+    )FRAGMENT_SHADER";
+}
+
+} // namespace molphene
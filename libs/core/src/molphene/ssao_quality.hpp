@@ -0,0 +1,56 @@
+#ifndef MOLPHENE_SSAO_QUALITY_HPP
+#define MOLPHENE_SSAO_QUALITY_HPP
+
+#include "stdafx.hpp"
+
+#include "opengl.hpp"
+
+namespace molphene {
+
+enum class ssao_quality { off, low, medium, high };
+
+struct ssao_settings {
+  // Depth samples taken per occlusion texel.
+  GLint sample_count;
+
+  // Sampling radius as a fraction of the viewport height.
+  GLfloat radius;
+};
+
+// Occlusion is computed at this fraction of the viewport size and upsampled
+// with depth-aware weights, so every tier costs at most a quarter of the
+// pixels times its sample count.
+inline constexpr auto ssao_resolution_divisor = std::size_t{2};
+
+constexpr auto ssao_quality_settings(ssao_quality quality) noexcept
+ -> ssao_settings
+{
+  switch(quality) {
+  case ssao_quality::low:
+    return {4, 0.02f};
+  case ssao_quality::medium:
+    return {8, 0.03f};
+  case ssao_quality::high:
+    return {16, 0.04f};
+  default:
+    return {0, 0.f};
+  }
+}
+
+constexpr auto next_ssao_quality(ssao_quality quality) noexcept -> ssao_quality
+{
+  switch(quality) {
+  case ssao_quality::off:
+    return ssao_quality::low;
+  case ssao_quality::low:
+    return ssao_quality::medium;
+  case ssao_quality::medium:
+    return ssao_quality::high;
+  default:
+    return ssao_quality::off;
+  }
+}
+
+} // namespace molphene
+
+#endif
@@ -0,0 +1,97 @@
+#include "ssao_shader.hpp"
+
+namespace molphene {
+
+void ssao_shader::setup_gl_attribs_val() const noexcept
+{
+  glVertexAttrib4f(
+   static_cast<GLuint>(shader_attrib_location::vertex), 0, 0, 0, 1);
+}
+
+auto ssao_shader::vert_shader_source() const noexcept -> const GLchar*
+{
+  return R"VERTEX_SHADER(
+    attribute vec4 a_Vertex;
+
+    varying vec2 v_TexCoord;
+
+    void main() {
+      gl_Position = a_Vertex;
+      v_TexCoord = a_Vertex.xy * 0.5 + 0.5;
+    }
+  )VERTEX_SHADER";
+}
+
+auto ssao_shader::frag_shader_source() const noexcept -> const GLchar*
+{
+  return R"FRAGMENT_SHADER(
+#ifdef GL_ES
+    precision highp float;
+#endif
+    const int MAX_SAMPLES = 16;
+    const float GOLDEN_ANGLE = 2.39996323;
+
+    uniform sampler2D u_TexDepth;
+
+    uniform vec4 u_ProjectionScale;
+    uniform vec4 u_ProjectionDepth;
+
+    uniform float u_Ssao_sampleCount;
+    uniform float u_Ssao_radius;
+    uniform vec2 u_Ssao_texelSize;
+
+    varying vec2 v_TexCoord;
+
+    float clipW(float z) {
+      return u_ProjectionDepth.y * z + u_ProjectionDepth.w;
+    }
+
+    vec3 viewPosition(vec2 uv) {
+      float d = texture2D(u_TexDepth, uv).r * 2. - 1.;
+      float z = (u_ProjectionDepth.z - d * u_ProjectionDepth.w) /
+                (d * u_ProjectionDepth.y - u_ProjectionDepth.x);
+      vec2 ndc = (uv * 2. - 1.) * clipW(z) - u_ProjectionScale.zw * z;
+      return vec3(ndc / u_ProjectionScale.xy, z);
+    }
+
+    void main() {
+      if(texture2D(u_TexDepth, v_TexCoord).r >= 1.) {
+        gl_FragColor = vec4(1.);
+        return;
+      }
+
+      vec3 P = viewPosition(v_TexCoord);
+      vec3 N = normalize(cross(
+        viewPosition(v_TexCoord + vec2(u_Ssao_texelSize.x, 0.)) - P,
+        viewPosition(v_TexCoord + vec2(0., u_Ssao_texelSize.y)) - P));
+
+      float viewRadius =
+        u_Ssao_radius * 2. * abs(clipW(P.z)) / u_ProjectionScale.y;
+      float aspect = u_Ssao_texelSize.x / u_Ssao_texelSize.y;
+      float angle = fract(
+        sin(dot(gl_FragCoord.xy, vec2(12.9898, 78.233))) * 43758.5453) *
+        6.2831853;
+
+      float occlusion = 0.;
+      for(int i = 0; i < MAX_SAMPLES; ++i) {
+        if(float(i) >= u_Ssao_sampleCount) {
+          break;
+        }
+
+        float t = (float(i) + 0.5) / u_Ssao_sampleCount;
+        float a = angle + float(i) * GOLDEN_ANGLE;
+        vec2 offset = vec2(cos(a) * aspect, sin(a)) * t * u_Ssao_radius;
+
+        vec3 v = viewPosition(v_TexCoord + offset) - P;
+        float dist = length(v);
+        occlusion += max(0., dot(N, v) / (dist + 1e-4) - 0.1) *
+                     max(0., 1. - dist / viewRadius);
+      }
+
+      float ao = clamp(1. - 2. * occlusion / u_Ssao_sampleCount, 0., 1.);
+      gl_FragColor = vec4(ao, ao, ao, 1.);
+    }
+    )FRAGMENT_SHADER";
+}
+
+} // namespace molphene
@@ -1,5 +1,5 @@
-#ifndef MOLPHENE_QUAD_SHADER_HPP
-#define MOLPHENE_QUAD_SHADER_HPP
+#ifndef MOLPHENE_SSAO_SHADER_HPP
+#define MOLPHENE_SSAO_SHADER_HPP
 
 #include "stdafx.hpp"
 
@@ -9,10 +9,12 @@
 #include "shader_attrib_location.hpp"
 
 namespace molphene {
-class quad_shader
-: public basic_shader<
-   quad_shader,
-   mix_shader_uniforms<quad_shader, color2d_sampler_uniform>> {
+class ssao_shader
+: public basic_shader<ssao_shader,
+                      mix_shader_uniforms<ssao_shader,
+                                          depth2d_sampler_uniform,
+                                          depth_reconstruction_uniform,
+                                          ssao_uniform>> {
 public:
   using attrib_locations = shader_attrib_list<shader_attrib_location::vertex>;
 
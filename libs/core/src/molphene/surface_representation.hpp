@@ -0,0 +1,107 @@
+#ifndef MOLPHENE_SURFACE_REPRESENTATION_HPP
+#define MOLPHENE_SURFACE_REPRESENTATION_HPP
+
+#include "stdafx.hpp"
+
+#include "assembly.hpp"
+#include "color_light_shader.hpp"
+#include "color_manager.hpp"
+#include "m3d.hpp"
+#include "molecular_surface.hpp"
+#include "molecule_to_shape.hpp"
+#include "surface_vertex_buffers.hpp"
+
+#include <molecule/atom.hpp>
+
+namespace molphene {
+
+template<typename TSurfaceBuffers>
+class basic_surface_representation {
+public:
+  using surface_buffers_type = TSurfaceBuffers;
+
+  using mesh_attributes_type = molecular_surface;
+
+  // Stands in for elements without a van der Waals radius.
+  static constexpr auto fallback_radius = 1.5f;
+
+  molecular_surface_options surface_options;
+
+  atom_shading shading;
+
+  ColorManager color_manager;
+
+  surface_buffers_type surface_buffers;
+
+  // Places the copies of the atoms in the biological assembly, as in
+  // molecule::assembly_transforms.
+  std::vector<mat4<float>> assembly_transforms;
+
+  // Kept after upload so that moved atoms re-mesh only their bricks. Queued
+  // uploads read the mesh they were given, so whoever enqueues them moves it
+  // in here once they have run.
+  mesh_attributes_type surface;
+
+  template<typename TSizedRangeAtoms>
+  auto build_mesh_attributes(const TSizedRangeAtoms& atoms) const
+   -> mesh_attributes_type
+  {
+    auto positions = detail::make_reserved_vector<vec3<float>>(atoms.size());
+    auto radii = detail::make_reserved_vector<float>(atoms.size());
+    auto colors = detail::make_reserved_vector<rgba8>(atoms.size());
+
+    for(auto atomptr : atoms) {
+      const auto& atom = *atomptr;
+      const auto element = atom.element();
+
+      positions.push_back(atom.position());
+      radii.push_back(element.rvdw > 0 ? element.rvdw : fallback_radius);
+      colors.push_back(
+       shading.shade(atom, color_manager.get_element_color(element.symbol)));
+    }
+
+    return molecular_surface{positions, radii, colors, surface_options};
+  }
+
+  template<typename TSizedRangeAtoms>
+  void build_vertex_buffers(TSizedRangeAtoms&& atoms)
+  {
+    surface = build_mesh_attributes(atoms);
+    surface_buffers.build_buffers(surface);
+  }
+
+  template<typename TUploadQueue>
+  void
+  enqueue_vertex_buffers(std::shared_ptr<const mesh_attributes_type> mesh_attrs,
+                         TUploadQueue& queue)
+  {
+    surface_buffers.enqueue_build_buffers(std::move(mesh_attrs), queue);
+  }
+
+  // Moves the atoms at indices, in molecule order, to positions.
+  void move_atoms(gsl::span<const std::uint32_t> indices,
+                  gsl::span<const vec3<float>> positions)
+  {
+    surface_buffers.update_buffers(surface,
+                                   surface.move_atoms(indices, positions));
+  }
+
+  auto size_bytes() const noexcept -> std::size_t
+  {
+    return static_cast<std::size_t>(surface_buffers.size_bytes());
+  }
+
+  void render(const color_light_shader& shader) const noexcept
+  {
+    draw_assembly_copies(shader, assembly_transforms, [&]() noexcept {
+      surface_buffers.draw(shader);
+    });
+  }
+};
+
+using surface_representation =
+ basic_surface_representation<surface_vertex_buffers>;
+
+} // namespace molphene
+
+#endif
@@ -0,0 +1,343 @@
+#ifndef MOLPHENE_SURFACE_VERTEX_BUFFERS_HPP
+#define MOLPHENE_SURFACE_VERTEX_BUFFERS_HPP
+
+#include "stdafx.hpp"
+
+#include <numeric>
+
+#include "opengl.hpp"
+
+#include "attribs_buffer_array.hpp"
+#include "color_image_texture.hpp"
+#include "color_light_shader.hpp"
+#include "gl/buffer.hpp"
+#include "gl_vertex_attribs_guard.hpp"
+#include "molecular_surface.hpp"
+#include "shader_attrib_location.hpp"
+#include "vertex_attribs_buffer.hpp"
+
+namespace molphene {
+
+// Surface triangles with per-vertex colors, packed brick after brick into
+// chunks small enough for 16-bit indices, one indexed draw per chunk. Every
+// brick gets a slot with some room to spare, so that a re-meshed brick
+// usually re-uploads only its own slot.
+template<typename = void>
+class basic_surface_vertex_buffers {
+public:
+  using attribs_guard =
+   gl_vertex_attribs_guard<shader_attrib_location::vertex,
+                           shader_attrib_location::normal,
+                           shader_attrib_location::color>;
+
+  using positions_buffer = VertexAttribsBuffer<vec3<GLfloat>,
+                                               shader_attrib_location::vertex,
+                                               0,
+                                               GL_FALSE,
+                                               GL_DYNAMIC_DRAW>;
+
+  using normals_buffer = VertexAttribsBuffer<vec3<GLfloat>,
+                                             shader_attrib_location::normal,
+                                             0,
+                                             GL_FALSE,
+                                             GL_DYNAMIC_DRAW>;
+
+  using colors_buffer = VertexAttribsBuffer<rgba8,
+                                            shader_attrib_location::color,
+                                            0,
+                                            GL_TRUE,
+                                            GL_DYNAMIC_DRAW>;
+
+  using indices_buffer =
+   gl::buffer<GLushort, GL_ELEMENT_ARRAY_BUFFER, GL_DYNAMIC_DRAW>;
+
+  static constexpr auto max_chunk_vertices = std::size_t{1} << 16;
+
+  static constexpr auto min_slack_vertices = std::size_t{64};
+
+  static constexpr auto min_slack_indices = std::size_t{384};
+
+  struct brick_slot {
+    std::size_t brick;
+
+    std::size_t vertex_first;
+
+    std::size_t vertex_capacity;
+
+    std::size_t index_first;
+
+    std::size_t index_capacity;
+  };
+
+  struct chunk {
+    positions_buffer positions;
+
+    normals_buffer normals;
+
+    colors_buffer colors;
+
+    indices_buffer indices;
+
+    std::vector<brick_slot> slots;
+  };
+
+  // Colors come from the vertices; the shader multiplies them by this.
+  std::unique_ptr<color_image_texture> white_texture;
+
+  std::vector<std::unique_ptr<chunk>> chunks;
+
+  void build_buffers(const molecular_surface& surface)
+  {
+    build_white_texture();
+
+    chunks.clear();
+    for(const auto& bricks : chunk_bricks(surface, all_bricks(surface))) {
+      build_chunk(surface, bricks);
+    }
+    locate_bricks();
+  }
+
+  // One task per chunk. Every task holds surface, which the caller makes own
+  // these buffers as well.
+  template<typename TUploadQueue>
+  void enqueue_build_buffers(std::shared_ptr<const molecular_surface> surface,
+                             TUploadQueue& queue)
+  {
+    queue.push([this, surface] {
+      build_white_texture();
+      chunks.clear();
+    });
+
+    for(auto& bricks : chunk_bricks(*surface, all_bricks(*surface))) {
+      queue.push([this, surface, bricks = std::move(bricks)] {
+        build_chunk(*surface, bricks);
+      });
+    }
+
+    queue.push([this, surface] { locate_bricks(); });
+  }
+
+  // Re-uploads the bricks of an update in place. Chunks with a brick that
+  // outgrew its slot are rebuilt, and bricks new to the surface get new
+  // chunks.
+  void update_buffers(const molecular_surface& surface,
+                      const surface_update& update)
+  {
+    if(update.remeshed_all) {
+      build_buffers(surface);
+      return;
+    }
+
+    auto rebuilt = std::vector<bool>(chunks.size());
+    auto moved_bricks = std::vector<std::size_t>{};
+    for(const auto brick : update.bricks) {
+      if(brick >= brick_locations_.size()) {
+        moved_bricks.push_back(brick);
+        continue;
+      }
+
+      const auto [chunk_index, slot_index] = brick_locations_[brick];
+      auto& chunk = *chunks[chunk_index];
+      const auto& slot = chunk.slots[slot_index];
+      const auto& mesh = surface.bricks()[brick];
+      if(mesh.positions.size() > slot.vertex_capacity ||
+         mesh.indices.size() > slot.index_capacity) {
+        rebuilt[chunk_index] = true;
+        continue;
+      }
+
+      upload_slot(chunk, slot, mesh);
+    }
+
+    if(moved_bricks.empty() &&
+       std::none_of(rebuilt.begin(), rebuilt.end(), [](bool value) {
+         return value;
+       })) {
+      return;
+    }
+
+    auto kept = std::vector<std::unique_ptr<chunk>>{};
+    for(auto i = std::size_t{0}; i < chunks.size(); ++i) {
+      if(!rebuilt[i]) {
+        kept.push_back(std::move(chunks[i]));
+        continue;
+      }
+
+      for(const auto& slot : chunks[i]->slots) {
+        moved_bricks.push_back(slot.brick);
+      }
+    }
+    chunks = std::move(kept);
+
+    std::sort(moved_bricks.begin(), moved_bricks.end());
+    for(const auto& bricks : chunk_bricks(surface, moved_bricks)) {
+      build_chunk(surface, bricks);
+    }
+    locate_bricks();
+  }
+
+  auto size_bytes() const noexcept -> GLsizeiptr
+  {
+    auto size = buffer_size_bytes(white_texture);
+    for(const auto& chunk : chunks) {
+      size += chunk->positions.size_bytes() + chunk->normals.size_bytes() +
+              chunk->colors.size_bytes() + chunk->indices.size_bytes();
+    }
+    return size;
+  }
+
+  void draw(const color_light_shader& shader) const noexcept
+  {
+    if(chunks.empty()) {
+      return;
+    }
+
+    shader.color_texture_image(white_texture->texture());
+
+    {
+      const auto verts_guard = attribs_guard{};
+
+      for(const auto& chunk : chunks) {
+        chunk->positions.attrib_pointer();
+        chunk->normals.attrib_pointer();
+        chunk->colors.attrib_pointer();
+        chunk->indices.bind();
+
+        glDrawElements(GL_TRIANGLES,
+                       static_cast<GLsizei>(chunk->indices.size()),
+                       GL_UNSIGNED_SHORT,
+                       nullptr);
+      }
+    }
+
+    // The current color is undefined after drawing from an array, and the
+    // other shapes rely on it being white.
+    glVertexAttrib4f(
+     static_cast<GLuint>(shader_attrib_location::color), 1, 1, 1, 1);
+  }
+
+private:
+  static auto vertex_capacity(const surface_brick_mesh& mesh) noexcept
+   -> std::size_t
+  {
+    const auto size = mesh.positions.size();
+    return std::min(size + std::max(size / 4, min_slack_vertices),
+                    max_chunk_vertices);
+  }
+
+  static auto index_capacity(const surface_brick_mesh& mesh) noexcept
+   -> std::size_t
+  {
+    const auto size = mesh.indices.size();
+    return size + std::max(size / 4, min_slack_indices);
+  }
+
+  static auto all_bricks(const molecular_surface& surface)
+   -> std::vector<std::size_t>
+  {
+    auto bricks = std::vector<std::size_t>(surface.bricks().size());
+    std::iota(bricks.begin(), bricks.end(), std::size_t{0});
+    return bricks;
+  }
+
+  static auto chunk_bricks(const molecular_surface& surface,
+                           const std::vector<std::size_t>& bricks)
+   -> std::vector<std::vector<std::size_t>>
+  {
+    auto chunked = std::vector<std::vector<std::size_t>>{};
+    auto vertices = max_chunk_vertices;
+    for(const auto brick : bricks) {
+      const auto capacity = vertex_capacity(surface.bricks()[brick]);
+      if(vertices + capacity > max_chunk_vertices) {
+        chunked.emplace_back();
+        vertices = 0;
+      }
+      chunked.back().push_back(brick);
+      vertices += capacity;
+    }
+
+    return chunked;
+  }
+
+  void build_white_texture()
+  {
+    white_texture = std::make_unique<color_image_texture>();
+    white_texture->data(std::array<rgba8, 1>{rgba8{0xff, 0xff, 0xff, 0xff}});
+  }
+
+  void build_chunk(const molecular_surface& surface,
+                   const std::vector<std::size_t>& bricks)
+  {
+    auto& built = chunks.emplace_back(std::make_unique<chunk>());
+
+    auto vertices = std::size_t{0};
+    auto indices = std::size_t{0};
+    for(const auto brick : bricks) {
+      const auto& mesh = surface.bricks()[brick];
+      const auto slot = brick_slot{
+       brick, vertices, vertex_capacity(mesh), indices, index_capacity(mesh)};
+
+      built->slots.push_back(slot);
+      vertices += slot.vertex_capacity;
+      indices += slot.index_capacity;
+    }
+
+    built->positions.size(static_cast<GLsizeiptr>(vertices));
+    built->normals.size(static_cast<GLsizeiptr>(vertices));
+    built->colors.size(static_cast<GLsizeiptr>(vertices));
+    built->indices.reserved(static_cast<GLsizeiptr>(indices));
+
+    for(const auto& slot : built->slots) {
+      upload_slot(*built, slot, surface.bricks()[slot.brick]);
+    }
+  }
+
+  // Unused index room repeats the slot's first vertex, which only makes
+  // degenerate triangles.
+  void upload_slot(const chunk& target,
+                   const brick_slot& slot,
+                   const surface_brick_mesh& mesh)
+  {
+    const auto vertices = static_cast<GLsizeiptr>(mesh.positions.size());
+    target.positions.data(slot.vertex_first, vertices, mesh.positions.data());
+    target.normals.data(slot.vertex_first, vertices, mesh.normals.data());
+    target.colors.data(slot.vertex_first, vertices, mesh.colors.data());
+
+    const auto base = static_cast<GLushort>(slot.vertex_first);
+    staging_indices_.assign(slot.index_capacity, base);
+    std::transform(mesh.indices.begin(),
+                   mesh.indices.end(),
+                   staging_indices_.begin(),
+                   [base](auto index) noexcept {
+                     return static_cast<GLushort>(base + index);
+                   });
+
+    target.indices.subdata(static_cast<GLintptr>(slot.index_first),
+                           staging_indices_);
+  }
+
+  void locate_bricks()
+  {
+    brick_locations_.clear();
+    for(auto i = std::size_t{0}; i < chunks.size(); ++i) {
+      const auto& slots = chunks[i]->slots;
+      for(auto j = std::size_t{0}; j < slots.size(); ++j) {
+        if(slots[j].brick >= brick_locations_.size()) {
+          brick_locations_.resize(slots[j].brick + 1);
+        }
+        brick_locations_[slots[j].brick] = {i, j};
+      }
+    }
+  }
+
+  // Chunk and slot of each brick of the surface.
+  std::vector<std::pair<std::size_t, std::size_t>> brick_locations_;
+
+  std::vector<GLushort> staging_indices_;
+};
+
+using surface_vertex_buffers = basic_surface_vertex_buffers<void>;
+
+} // namespace molphene
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "gl/buffer.hpp"
 #include "gl/draw_instanced_arrays.hpp"
+#include "gl/state_cache.hpp"
 #include "opengl.hpp"
 #include "shader_attrib_location.hpp"
 #include "stdafx.hpp"
@@ -16,12 +17,17 @@ template<typename TDataType,
          GLenum usage = GL_STATIC_DRAW>
 class VertexAttribsBuffer {
 public:
-  using gl_array_buffer =
-   gl::buffer<TDataType, GL_ARRAY_BUFFER, GL_STATIC_DRAW>;
+  using gl_array_buffer = gl::buffer<TDataType, GL_ARRAY_BUFFER, usage>;
   using data_type = typename gl_array_buffer::data_type;
 
   static constexpr auto instance_divisor = VInstanceDivisor;
 
+  // Normalized integers are read by the shader as fractions in [0, 1], or
+  // [-1, 1] when signed.
+  static_assert(normalized == GL_FALSE ||
+                 gl_vertex_attrib<data_type>::type != GL_FLOAT,
+                "Only integer attributes can be normalized");
+
   VertexAttribsBuffer() noexcept = default;
 
   VertexAttribsBuffer(const VertexAttribsBuffer& rsh) = delete;
@@ -54,36 +60,59 @@ public:
                              static_cast<typename SpanData::size_type>(size)});
   }
 
+#ifdef MOLPHENE_GL_BUFFER_STORAGE
+  void copy_data(GLintptr offset,
+                 GLsizeiptr size,
+                 GLuint source,
+                 GLintptr source_offset) const noexcept
+  {
+    buffer_.copy_subdata(offset, size, source, source_offset);
+  }
+#endif
+
+  void orphan() const noexcept
+  {
+    buffer_.orphan();
+  }
+
+  auto size_bytes() const noexcept -> GLsizeiptr
+  {
+    return buffer_.size_bytes();
+  }
+
   void attrib_pointer() const noexcept
   {
-    buffer_.bind();
+    auto& state = gl::state();
 
     if constexpr(gl_vertex_attrib<data_type>::is_matrix) {
       using scalar_t = typename boost::qvm::mat_traits<data_type>::scalar_type;
       for(auto index = 0, size = 4; index < size; ++index) {
         const auto location = static_cast<GLuint>(attrib_index) + index;
-        glVertexAttribPointer(location,
-                              gl_vertex_attrib<data_type>::size,
-                              gl_vertex_attrib<data_type>::type,
-                              normalized,
-                              sizeof(data_type),
-                              static_cast<scalar_t*>(nullptr) + size * index);
-        gl::vertex_attrib_divisor(location, instance_divisor);
+        state.vertex_attrib_pointer(buffer_.id(),
+                                    location,
+                                    gl_vertex_attrib<data_type>::size,
+                                    gl_vertex_attrib<data_type>::type,
+                                    normalized,
+                                    sizeof(data_type),
+                                    static_cast<scalar_t*>(nullptr) +
+                                     size * index,
+                                    instance_divisor);
       }
     } else {
       const auto location = static_cast<GLuint>(attrib_index);
-      glVertexAttribPointer(location,
-                            gl_vertex_attrib<data_type>::size,
-                            gl_vertex_attrib<data_type>::type,
-                            normalized,
-                            0,
-                            nullptr);
-      gl::vertex_attrib_divisor(location, instance_divisor);
+      state.vertex_attrib_pointer(buffer_.id(),
+                                  location,
+                                  gl_vertex_attrib<data_type>::size,
+                                  gl_vertex_attrib<data_type>::type,
+                                  normalized,
+                                  0,
+                                  nullptr,
+                                  instance_divisor);
     }
   }
 
 private:
-  gl::buffer<TDataType> buffer_{};
+  gl_array_buffer buffer_{};
 };
 
 } // namespace molphene
@@ -0,0 +1,238 @@
+#ifndef MOLPHENE_VERTEX_FORMAT_HPP
+#define MOLPHENE_VERTEX_FORMAT_HPP
+
+#include "stdafx.hpp"
+
+#include "attribs_buffer_array.hpp"
+#include "instance_cluster.hpp"
+#include "m3d.hpp"
+#include "opengl.hpp"
+#include "vertex_attribs_buffer.hpp"
+
+namespace molphene {
+
+// A quantized position padded to four components, 8 bytes, since three
+// 16-bit components have no vertex format on Direct3D 11, which ANGLE and
+// WebGL map onto. The padding normalizes to a w of 1.
+struct quantized_position {
+  GLushort x;
+  GLushort y;
+  GLushort z;
+  GLushort w;
+};
+
+template<>
+struct gl_vertex_attrib<quantized_position>
+: gl_attrib_pointer_type<GLushort> {
+  static constexpr GLint size = 4;
+};
+
+// Maps the positions of one buffer chunk into 16-bit fractions of the
+// chunk's bounds, read back as offset + scale * fraction.
+struct position_quantization {
+  vec3<GLfloat> offset{0, 0, 0};
+  vec3<GLfloat> scale{0, 0, 0};
+
+  template<typename T>
+  auto operator()(const vec3<T>& position) const noexcept
+   -> quantized_position
+  {
+    const auto quantize = [](T value, GLfloat offset, GLfloat scale) noexcept {
+      if(scale <= 0) {
+        return GLushort{0};
+      }
+      const auto fraction = std::clamp((value - offset) / scale, T{0}, T{1});
+      return static_cast<GLushort>(std::lround(fraction * 65535));
+    };
+
+    return {quantize(position.x(), offset.x(), scale.x()),
+            quantize(position.y(), offset.y(), scale.y()),
+            quantize(position.z(), offset.z(), scale.z()),
+            GLushort{65535}};
+  }
+};
+
+// Folds the unit sphere onto an octahedron and the octahedron flat onto the
+// square, stored as two 8-bit signed fractions, within about a degree of the
+// normal.
+struct octahedral_normal_encoder {
+  template<typename T>
+  auto operator()(const vec3<T>& normal) const noexcept -> vec2<GLbyte>
+  {
+    const auto sign = [](T value) noexcept {
+      return value < 0 ? T{-1} : T{1};
+    };
+    const auto quantize = [](T value) noexcept {
+      return static_cast<GLbyte>(std::lround(value * 127));
+    };
+
+    const auto l1 =
+     std::abs(normal.x()) + std::abs(normal.y()) + std::abs(normal.z());
+    if(l1 <= 0) {
+      return {0, 0};
+    }
+
+    auto x = normal.x() / l1;
+    auto y = normal.y() / l1;
+    if(normal.z() < 0) {
+      const auto folded_x = (1 - std::abs(y)) * sign(x);
+      y = (1 - std::abs(x)) * sign(y);
+      x = folded_x;
+    }
+
+    return {quantize(x), quantize(y)};
+  }
+};
+
+// Texture coordinates inside [0, 1] as 16-bit unsigned fractions.
+struct texcoord_encoder {
+  template<typename T>
+  auto operator()(const vec2<T>& texcoord) const noexcept -> vec2<GLushort>
+  {
+    const auto quantize = [](T value) noexcept {
+      return static_cast<GLushort>(
+       std::lround(std::clamp(value, T{0}, T{1}) * 65535));
+    };
+
+    return {quantize(texcoord.x()), quantize(texcoord.y())};
+  }
+};
+
+// Stores every value assigned to it through the encoder, so that the mesh
+// builders write compressed vertices straight into place.
+template<typename TEncoder, typename TOutputIt>
+struct encode_iterator {
+  using value_type = void;
+  using difference_type = void;
+  using pointer = void;
+  using reference = void;
+  using iterator_category = std::output_iterator_tag;
+
+  constexpr encode_iterator(TEncoder encoder, TOutputIt output)
+  : encoder{encoder}
+  , output{output}
+  {
+  }
+
+  template<typename T>
+  constexpr auto operator=(const T& value) -> encode_iterator&
+  {
+    *output++ = encoder(value);
+    return *this;
+  }
+
+  constexpr auto operator*() -> encode_iterator&
+  {
+    return *this;
+  }
+
+  constexpr auto operator++() -> encode_iterator&
+  {
+    return *this;
+  }
+
+  constexpr auto operator++(int) -> encode_iterator&
+  {
+    return *this;
+  }
+
+private:
+  TEncoder encoder;
+  TOutputIt output;
+};
+
+// Positions of the vertices with the quantization of each chunk of them.
+class quantized_positions_buffer_array
+: public attrib_buffer_array<VertexAttribsBuffer<quantized_position,
+                                                 shader_attrib_location::vertex,
+                                                 0,
+                                                 GL_TRUE>> {
+public:
+  using attrib_buffer_array::attrib_buffer_array;
+
+  std::vector<position_quantization> quantizations;
+};
+
+using octahedral_normals_buffer_array =
+ attrib_buffer_array<VertexAttribsBuffer<vec2<GLbyte>,
+                                         shader_attrib_location::normal,
+                                         0,
+                                         GL_TRUE>>;
+
+using quantized_texcoords_buffer_array =
+ attrib_buffer_array<VertexAttribsBuffer<vec2<GLushort>,
+                                         shader_attrib_location::texcoordcolor,
+                                         0,
+                                         GL_TRUE>>;
+
+// How mesh vertices are stored. The float format keeps them as they are
+// built, 32 bytes a vertex. The quantized format keeps 14: positions and
+// texcoords as 16-bit fractions, of their chunk's bounds for positions, and
+// normals folded into two 8-bit values, with the shader told to decode them.
+struct float_vertex_format {
+  using positions_array_type = positions_buffer_array;
+  using normals_array_type = normals_buffer_array;
+  using texcoords_array_type = texcoords_buffer_array;
+
+  static constexpr auto quantized = false;
+};
+
+struct quantized_vertex_format {
+  using positions_array_type = quantized_positions_buffer_array;
+  using normals_array_type = octahedral_normals_buffer_array;
+  using texcoords_array_type = quantized_texcoords_buffer_array;
+
+  static constexpr auto quantized = true;
+};
+
+// Quantization of each buffer chunk, from the bounds of the shapes in it.
+template<typename TShapeMeshSizedRange>
+auto build_position_quantizations(const TShapeMeshSizedRange& shape_attrs,
+                                  GLsizei instances_per_block)
+ -> std::vector<position_quantization>
+{
+  const auto total_instances = static_cast<GLsizei>(shape_attrs.size());
+
+  auto quantizations = std::vector<position_quantization>{};
+  if(instances_per_block <= 0) {
+    return quantizations;
+  }
+  quantizations.reserve(total_instances / instances_per_block + 1);
+
+  auto attr_it = std::begin(shape_attrs);
+  for(auto first = GLsizei{0}; first < total_instances;
+      first += instances_per_block) {
+    const auto last = std::min(total_instances, first + instances_per_block);
+
+    constexpr auto inf = std::numeric_limits<double>::infinity();
+    auto min = vec3<double>{inf, inf, inf};
+    auto max = vec3<double>{-inf, -inf, -inf};
+    for(auto i = first; i < last; ++i, ++attr_it) {
+      const auto bounds = shape_bounding_sphere(*attr_it);
+      const auto radius =
+       vec3<double>{bounds.radius, bounds.radius, bounds.radius};
+      const auto low = bounds.center - radius;
+      const auto high = bounds.center + radius;
+      min = {std::min(min.x(), low.x()),
+             std::min(min.y(), low.y()),
+             std::min(min.z(), low.z())};
+      max = {std::max(max.x(), high.x()),
+             std::max(max.y(), high.y()),
+             std::max(max.z(), high.z())};
+    }
+
+    const auto extent = max - min;
+    quantizations.push_back({vec3<GLfloat>{static_cast<GLfloat>(min.x()),
+                                           static_cast<GLfloat>(min.y()),
+                                           static_cast<GLfloat>(min.z())},
+                             vec3<GLfloat>{static_cast<GLfloat>(extent.x()),
+                                           static_cast<GLfloat>(extent.y()),
+                                           static_cast<GLfloat>(extent.z())}});
+  }
+
+  return quantizations;
+}
+
+} // namespace molphene
+
+#endif
@@ -0,0 +1,71 @@
+#include "cell_list.hpp"
+
+#include <numeric>
+
+namespace molphene {
+
+cell_list::cell_list(gsl::span<const position_type> positions, float cell_size)
+: cell_size_{cell_size}
+{
+  assert(cell_size > 0);
+
+  if(positions.empty()) {
+    return;
+  }
+
+  auto lower = positions[0];
+  auto upper = positions[0];
+  for(const auto& position : positions) {
+    lower = {std::min(lower.x(), position.x()),
+             std::min(lower.y(), position.y()),
+             std::min(lower.z(), position.z())};
+    upper = {std::max(upper.x(), position.x()),
+             std::max(upper.y(), position.y()),
+             std::max(upper.z(), position.z())};
+  }
+
+  origin_ = lower;
+  const auto extent = upper - lower;
+  dims_ = {static_cast<int>(extent.x() / cell_size_) + 1,
+           static_cast<int>(extent.y() / cell_size_) + 1,
+           static_cast<int>(extent.z() / cell_size_) + 1};
+
+  // Counting sort of the point indices by cell.
+  const auto cells = static_cast<std::size_t>(dims_[0]) * dims_[1] * dims_[2];
+  cell_starts_.assign(cells + 1, 0);
+
+  auto point_cells = std::vector<index_type>(positions.size());
+  for(auto i = std::size_t{0}; i < point_cells.size(); ++i) {
+    const auto coords = cell_coords(positions[i]);
+    point_cells[i] = (coords[2] * dims_[1] + coords[1]) * dims_[0] + coords[0];
+    ++cell_starts_[point_cells[i] + 1];
+  }
+
+  std::partial_sum(
+   cell_starts_.begin(), cell_starts_.end(), cell_starts_.begin());
+
+  indices_.resize(positions.size());
+  auto fill =
+   std::vector<index_type>(cell_starts_.begin(), cell_starts_.end() - 1);
+  for(auto i = std::size_t{0}; i < point_cells.size(); ++i) {
+    indices_[fill[point_cells[i]]++] = static_cast<index_type>(i);
+  }
+}
+
+auto cell_list::cell_size() const noexcept -> float
+{
+  return cell_size_;
+}
+
+auto cell_list::cell_coords(const position_type& position) const noexcept
+ -> std::array<int, 3>
+{
+  const auto relative = (position - origin_) / cell_size_;
+  const auto coord = [this](float value, std::size_t axis) noexcept {
+    return std::clamp(static_cast<int>(std::floor(value)), 0, dims_[axis] - 1);
+  };
+  return {
+   coord(relative.x(), 0), coord(relative.y(), 1), coord(relative.z(), 2)};
+}
+
+} // namespace molphene
@@ -0,0 +1,68 @@
+#ifndef MOLPHENE_MOLECULE_CELL_LIST_HPP
+#define MOLPHENE_MOLECULE_CELL_LIST_HPP
+
+#include "stdafx.hpp"
+
+#include "m3d.hpp"
+
+namespace molphene {
+
+// Uniform grid over a set of points, bucketing point indices by cell so that
+// neighbour queries only look at the cells around the query point.
+class cell_list {
+public:
+  using position_type = vec3<float>;
+
+  using index_type = std::uint32_t;
+
+  cell_list() noexcept = default;
+
+  cell_list(gsl::span<const position_type> positions, float cell_size);
+
+  auto cell_size() const noexcept -> float;
+
+  // Calls func(index) for every point in the cells overlapping the cube of
+  // half extent radius around center. Points farther than radius are among
+  // them; callers filter by exact distance.
+  template<typename Function>
+  void for_each_candidate(const position_type& center,
+                          float radius,
+                          Function&& func) const
+  {
+    if(indices_.empty()) {
+      return;
+    }
+
+    const auto first = cell_coords(center - position_type{radius});
+    const auto last = cell_coords(center + position_type{radius});
+
+    for(auto z = first[2]; z <= last[2]; ++z) {
+      for(auto y = first[1]; y <= last[1]; ++y) {
+        const auto row = (z * dims_[1] + y) * dims_[0];
+        const auto begin = cell_starts_[row + first[0]];
+        const auto end = cell_starts_[row + last[0] + 1];
+        for(auto i = begin; i < end; ++i) {
+          func(indices_[i]);
+        }
+      }
+    }
+  }
+
+private:
+  auto cell_coords(const position_type& position) const noexcept
+   -> std::array<int, 3>;
+
+  position_type origin_{0};
+
+  float cell_size_{1};
+
+  std::array<int, 3> dims_{0, 0, 0};
+
+  std::vector<index_type> cell_starts_;
+
+  std::vector<index_type> indices_;
+};
+
+} // namespace molphene
+
+#endif
@@ -0,0 +1,120 @@
+#include "dcd_frame_source.hpp"
+
+#include <cstring>
+
+namespace molphene {
+namespace {
+
+// Fortran records: the payload between two copies of its size.
+constexpr auto record_marker = std::size_t{4};
+
+constexpr auto header_size = std::uint32_t{84};
+
+auto swap_bytes(std::uint32_t value) noexcept -> std::uint32_t
+{
+  return (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) |
+         (value << 24);
+}
+
+auto load_u32(std::string_view data, std::size_t offset, bool swapped) noexcept
+ -> std::uint32_t
+{
+  auto value = std::uint32_t{0};
+  std::memcpy(&value, data.data() + offset, sizeof(value));
+  return swapped ? swap_bytes(value) : value;
+}
+
+} // namespace
+
+dcd_frame_source::dcd_frame_source(const std::string& path)
+: file_{path}
+{
+  const auto data = file_.data();
+  if(data.size() < record_marker + header_size + record_marker) {
+    return;
+  }
+
+  // The first record is always 84 bytes, which tells the byte order.
+  swapped_ = load_u32(data, 0, false) != header_size;
+  if(load_u32(data, 0, swapped_) != header_size ||
+     data.substr(4, 4) != "CORD") {
+    return;
+  }
+
+  // Control words after "CORD": 8 is the count of fixed atoms, and for
+  // CHARMM files, flagged by 19, 10 and 11 flag unit cells and a fourth
+  // dimension.
+  const auto control = [&](std::size_t index) noexcept {
+    return load_u32(data, 8 + index * 4, swapped_);
+  };
+  const auto charmm = control(19) != 0;
+  const auto has_cell = charmm && control(10) != 0;
+  const auto has_4d = charmm && control(11) == 1;
+  if(control(8) != 0) {
+    return;
+  }
+
+  auto offset = record_marker + header_size + record_marker;
+
+  // Title lines.
+  if(offset + record_marker > data.size()) {
+    return;
+  }
+  offset += record_marker + load_u32(data, offset, swapped_) + record_marker;
+
+  if(offset + record_marker * 2 + 4 > data.size() ||
+     load_u32(data, offset, swapped_) != 4) {
+    return;
+  }
+  atoms_size_ = load_u32(data, offset + record_marker, swapped_);
+  offset += record_marker * 2 + 4;
+
+  const auto axis_bytes = record_marker * 2 + atoms_size_ * sizeof(float);
+  cell_bytes_ = has_cell ? record_marker * 2 + 6 * sizeof(double) : 0;
+  frame_bytes_ = cell_bytes_ + axis_bytes * (has_4d ? 4 : 3);
+  frames_offset_ = offset;
+  frames_size_ =
+   atoms_size_ > 0 && data.size() > offset
+    ? (data.size() - offset) / frame_bytes_
+    : 0;
+}
+
+auto dcd_frame_source::frames_size() const noexcept -> std::size_t
+{
+  return frames_size_;
+}
+
+auto dcd_frame_source::atoms_size() const noexcept -> std::size_t
+{
+  return atoms_size_;
+}
+
+// Coordinates are stored as all x, then all y, then all z.
+auto dcd_frame_source::read_frame(std::size_t frame, gsl::span<float> coords)
+ -> bool
+{
+  assert(static_cast<std::size_t>(coords.size()) == atoms_size_ * 3);
+
+  if(frame >= frames_size_) {
+    return false;
+  }
+
+  const auto data = file_.data();
+  auto offset = frames_offset_ + frame * frame_bytes_ + cell_bytes_;
+  for(auto axis = std::size_t{0}; axis < 3; ++axis) {
+    if(load_u32(data, offset, swapped_) != atoms_size_ * sizeof(float)) {
+      return false;
+    }
+    offset += record_marker;
+
+    for(auto i = std::size_t{0}; i < atoms_size_; ++i) {
+      const auto bits = load_u32(data, offset + i * sizeof(float), swapped_);
+      std::memcpy(&coords[i * 3 + axis], &bits, sizeof(float));
+    }
+    offset += atoms_size_ * sizeof(float) + record_marker;
+  }
+
+  return true;
+}
+
+} // namespace molphene
@@ -0,0 +1,48 @@
+#ifndef MOLPHENE_MOLECULE_DCD_FRAME_SOURCE_HPP
+#define MOLPHENE_MOLECULE_DCD_FRAME_SOURCE_HPP
+
+#include "stdafx.hpp"
+
+#include "frame_source.hpp"
+#include "mapped_file.hpp"
+
+namespace molphene {
+
+// Frames of a CHARMM or NAMD DCD file, in angstrom. Every frame is the same
+// size, so a frame is found by its number alone and copied out of the
+// mapped file, byte-swapped when the file was written on a machine of the
+// other byte order. The frame count comes from the file size, since writers
+// still running leave it out of the header. Files with fixed atoms are not
+// read.
+class dcd_frame_source : public frame_source {
+public:
+  explicit dcd_frame_source(const std::string& path);
+
+  auto frames_size() const noexcept -> std::size_t override;
+
+  auto atoms_size() const noexcept -> std::size_t override;
+
+  auto read_frame(std::size_t frame, gsl::span<float> coords)
+   -> bool override;
+
+private:
+  mapped_file file_;
+
+  bool swapped_{false};
+
+  std::size_t atoms_size_{0};
+
+  std::size_t frames_size_{0};
+
+  // Offset of the first frame and size of each frame.
+  std::size_t frames_offset_{0};
+
+  std::size_t frame_bytes_{0};
+
+  // Bytes of the unit cell record before the coordinates of a frame.
+  std::size_t cell_bytes_{0};
+};
+
+} // namespace molphene
+
+#endif
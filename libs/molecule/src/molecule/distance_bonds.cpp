@@ -0,0 +1,60 @@
+#include "distance_bonds.hpp"
+
+#include "cell_list.hpp"
+
+namespace molphene {
+namespace {
+
+// Slack in angstrom over the sum of covalent radii that still makes a bond.
+constexpr auto bond_tolerance = 0.4f;
+
+constexpr auto min_bond_length = 0.4f;
+
+} // namespace
+
+auto distance_bonds(const molecule::atoms_type& atoms)
+ -> std::vector<std::pair<int, int>>
+{
+  auto positions = std::vector<vec3<float>>{};
+  auto radii = std::vector<float>{};
+  positions.reserve(atoms.size());
+  radii.reserve(atoms.size());
+  for(const auto& atom : atoms) {
+    positions.push_back(atom.position());
+    radii.push_back(atom.element().rcov);
+  }
+
+  auto bonds = std::vector<std::pair<int, int>>{};
+  if(atoms.empty()) {
+    return bonds;
+  }
+
+  const auto max_reach =
+   *std::max_element(radii.begin(), radii.end()) * 2 + bond_tolerance;
+  const auto grid = cell_list{positions, max_reach};
+
+  for(auto i = std::size_t{0}; i < atoms.size(); ++i) {
+    if(radii[i] <= 0) {
+      continue;
+    }
+
+    grid.for_each_candidate(
+     positions[i], max_reach, [&](cell_list::index_type j) {
+       if(j <= i || radii[j] <= 0) {
+         return;
+       }
+
+       const auto reach = radii[i] + radii[j] + bond_tolerance;
+       const auto offset = positions[j] - positions[i];
+       const auto length2 = offset.dot(offset);
+       if(length2 > min_bond_length * min_bond_length &&
+          length2 < reach * reach) {
+         bonds.emplace_back(static_cast<int>(i), static_cast<int>(j));
+       }
+     });
+  }
+
+  return bonds;
+}
+
+} // namespace molphene
@@ -0,0 +1,17 @@
+#ifndef MOLPHENE_MOLECULE_DISTANCE_BONDS_HPP
+#define MOLPHENE_MOLECULE_DISTANCE_BONDS_HPP
+
+#include "stdafx.hpp"
+
+#include "molecule.hpp"
+
+namespace molphene {
+
+// Pairs of atoms, first index lower, closer than the sum of their covalent
+// radii plus some slack, for formats that leave bonds out.
+auto distance_bonds(const molecule::atoms_type& atoms)
+ -> std::vector<std::pair<int, int>>;
+
+} // namespace molphene
+
+#endif
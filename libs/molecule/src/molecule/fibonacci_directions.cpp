@@ -0,0 +1,20 @@
+#include "fibonacci_directions.hpp"
+
+namespace molphene {
+
+auto fibonacci_directions(std::size_t count) -> std::vector<vec3<float>>
+{
+  constexpr auto golden_angle = 2.39996323f;
+
+  auto directions = std::vector<vec3<float>>{};
+  directions.reserve(count);
+  for(auto i = std::size_t{0}; i < count; ++i) {
+    const auto z = 1 - (2 * i + 1) / static_cast<float>(count);
+    const auto r = std::sqrt(1 - z * z);
+    const auto phi = golden_angle * i;
+    directions.emplace_back(r * std::cos(phi), r * std::sin(phi), z);
+  }
+  return directions;
+}
+
+} // namespace molphene
@@ -0,0 +1,15 @@
+#ifndef MOLPHENE_MOLECULE_FIBONACCI_DIRECTIONS_HPP
+#define MOLPHENE_MOLECULE_FIBONACCI_DIRECTIONS_HPP
+
+#include "stdafx.hpp"
+
+#include "m3d.hpp"
+
+namespace molphene {
+
+// Roughly uniform unit vectors on the sphere, on a golden-angle spiral.
+auto fibonacci_directions(std::size_t count) -> std::vector<vec3<float>>;
+
+} // namespace molphene
+
+#endif
@@ -0,0 +1,39 @@
+#include "frame_source.hpp"
+
+#include "dcd_frame_source.hpp"
+#include "text_frame_source.hpp"
+#include "xtc_frame_source.hpp"
+
+namespace molphene {
+namespace {
+
+auto ends_with(std::string_view value, std::string_view suffix) noexcept
+ -> bool
+{
+  return value.size() >= suffix.size() &&
+         value.substr(value.size() - suffix.size()) == suffix;
+}
+
+} // namespace
+
+auto open_frame_source(const std::string& path)
+ -> std::unique_ptr<frame_source>
+{
+  if(ends_with(path, ".dcd")) {
+    return std::make_unique<dcd_frame_source>(path);
+  }
+  if(ends_with(path, ".xtc")) {
+    return std::make_unique<xtc_frame_source>(path);
+  }
+  if(ends_with(path, ".xyz")) {
+    return std::make_unique<text_frame_source>(path,
+                                               text_frame_source::format::xyz);
+  }
+  if(ends_with(path, ".pdb")) {
+    return std::make_unique<text_frame_source>(path,
+                                               text_frame_source::format::pdb);
+  }
+  return nullptr;
+}
+
+} // namespace molphene
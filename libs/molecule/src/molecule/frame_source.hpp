@@ -0,0 +1,41 @@
+#ifndef MOLPHENE_MOLECULE_FRAME_SOURCE_HPP
+#define MOLPHENE_MOLECULE_FRAME_SOURCE_HPP
+
+#include "stdafx.hpp"
+
+namespace molphene {
+
+// Random access to the coordinate frames of a trajectory, as x, y, z floats
+// per atom in topology order. Reads come from one thread at a time.
+class frame_source {
+public:
+  frame_source() noexcept = default;
+
+  frame_source(const frame_source&) = delete;
+
+  frame_source(frame_source&&) = delete;
+
+  auto operator=(const frame_source&) -> frame_source& = delete;
+
+  auto operator=(frame_source&&) -> frame_source& = delete;
+
+  virtual ~frame_source() noexcept = default;
+
+  virtual auto frames_size() const noexcept -> std::size_t = 0;
+
+  virtual auto atoms_size() const noexcept -> std::size_t = 0;
+
+  // Fills coords, atoms_size() * 3 floats long, with the frame. Returns false
+  // when the frame cannot be read.
+  virtual auto read_frame(std::size_t frame, gsl::span<float> coords)
+   -> bool = 0;
+};
+
+// Frames of a DCD, XTC, XYZ or PDB file, told apart by the extension. Null
+// for other extensions; a file that cannot be read has no frames.
+auto open_frame_source(const std::string& path)
+ -> std::unique_ptr<frame_source>;
+
+} // namespace molphene
+
+#endif
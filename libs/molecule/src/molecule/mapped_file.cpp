@@ -0,0 +1,82 @@
+#include "mapped_file.hpp"
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MOLPHENE_MOLECULE_HAS_MMAP
+#endif
+
+namespace molphene {
+
+mapped_file::mapped_file(const std::string& path)
+{
+#ifdef MOLPHENE_MOLECULE_HAS_MMAP
+  const auto fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0) {
+    return;
+  }
+
+  struct stat info {};
+  if(::fstat(fd, &info) != 0) {
+    ::close(fd);
+    return;
+  }
+
+  size_ = static_cast<std::size_t>(info.st_size);
+  modified_time_ = static_cast<std::int64_t>(info.st_mtime);
+  is_open_ = true;
+
+  // Mapping nothing fails, and an empty file needs no data.
+  if(size_ > 0) {
+    auto* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(mapped != MAP_FAILED) {
+      data_ = static_cast<const char*>(mapped);
+      is_mapped_ = true;
+    }
+  }
+  ::close(fd);
+
+  if(size_ == 0 || is_mapped_) {
+    return;
+  }
+#endif
+
+  auto is = std::ifstream{path, std::ios::binary};
+  if(!is) {
+    is_open_ = false;
+    return;
+  }
+
+  buffer_.assign(std::istreambuf_iterator<char>{is}, {});
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+  is_open_ = true;
+}
+
+mapped_file::~mapped_file() noexcept
+{
+#ifdef MOLPHENE_MOLECULE_HAS_MMAP
+  if(is_mapped_) {
+    ::munmap(const_cast<char*>(data_), size_);
+  }
+#endif
+}
+
+auto mapped_file::is_open() const noexcept -> bool
+{
+  return is_open_;
+}
+
+auto mapped_file::data() const noexcept -> std::string_view
+{
+  return {data_, size_};
+}
+
+auto mapped_file::modified_time() const noexcept -> std::int64_t
+{
+  return modified_time_;
+}
+
+} // namespace molphene
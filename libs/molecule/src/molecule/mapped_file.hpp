@@ -0,0 +1,49 @@
+#ifndef MOLPHENE_MOLECULE_MAPPED_FILE_HPP
+#define MOLPHENE_MOLECULE_MAPPED_FILE_HPP
+
+#include "stdafx.hpp"
+
+namespace molphene {
+
+// Read-only contents of a whole file, mapped into memory where the platform
+// has mmap and read into a buffer otherwise. Empty when the file cannot be
+// opened.
+class mapped_file {
+public:
+  explicit mapped_file(const std::string& path);
+
+  mapped_file(const mapped_file&) = delete;
+
+  mapped_file(mapped_file&&) = delete;
+
+  auto operator=(const mapped_file&) -> mapped_file& = delete;
+
+  auto operator=(mapped_file&&) -> mapped_file& = delete;
+
+  ~mapped_file() noexcept;
+
+  auto is_open() const noexcept -> bool;
+
+  auto data() const noexcept -> std::string_view;
+
+  // Last modification of the file when it was opened, in seconds since the
+  // epoch, or 0 when the platform does not tell.
+  auto modified_time() const noexcept -> std::int64_t;
+
+private:
+  const char* data_{nullptr};
+
+  std::size_t size_{0};
+
+  std::int64_t modified_time_{0};
+
+  bool is_open_{false};
+
+  bool is_mapped_{false};
+
+  std::vector<char> buffer_;
+};
+
+} // namespace molphene
+
+#endif
@@ -1,5 +1,9 @@
 #include "molecule.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
 namespace molphene {
 
 auto molecule::atoms() const noexcept -> const atoms_type&
@@ -17,9 +21,138 @@ void molecule::add_atom(const atom& atom)
   atoms_.push_back(atom);
 }
 
+void molecule::atom_positions(gsl::span<const float> coords) noexcept
+{
+  assert(coords.size() == atoms_.size() * 3);
+
+  for(auto i = std::size_t{0}; i < atoms_.size(); ++i) {
+    atoms_[i].position(coords[i * 3], coords[i * 3 + 1], coords[i * 3 + 2]);
+  }
+}
+
 void molecule::add_bond(const bond& bond)
 {
+  const auto valid = [this](int atom) noexcept {
+    return atom >= 0 && static_cast<std::size_t>(atom) < atoms_.size();
+  };
+  if(!valid(bond.atom1()) || !valid(bond.atom2())) {
+    throw std::out_of_range{"bond atom index out of range"};
+  }
+
   bonds_.push_back(bond);
 }
 
+void molecule::add_chain(std::string id)
+{
+  chain_ids_.push_back(std::move(id));
+  chain_first_residues_.push_back(
+   static_cast<std::uint32_t>(residue_names_.size()));
+}
+
+void molecule::add_residue(std::string name, int number)
+{
+  if(chain_ids_.empty()) {
+    add_chain({});
+  }
+
+  residue_names_.push_back(std::move(name));
+  residue_numbers_.push_back(number);
+  residue_first_atoms_.push_back(static_cast<std::uint32_t>(atoms_.size()));
+}
+
+auto molecule::chains_size() const noexcept -> std::size_t
+{
+  return chain_ids_.size();
+}
+
+auto molecule::residues_size() const noexcept -> std::size_t
+{
+  return residue_names_.size();
+}
+
+auto molecule::chain_id(std::size_t chain) const noexcept
+ -> const std::string&
+{
+  return chain_ids_[chain];
+}
+
+auto molecule::chain_residues(std::size_t chain) const noexcept -> index_range
+{
+  const auto last = chain + 1 < chain_first_residues_.size()
+                     ? chain_first_residues_[chain + 1]
+                     : static_cast<std::uint32_t>(residue_names_.size());
+  return {chain_first_residues_[chain], last};
+}
+
+auto molecule::chain_atoms(std::size_t chain) const noexcept -> index_range
+{
+  const auto residues = chain_residues(chain);
+  if(residues.size() == 0) {
+    return {};
+  }
+
+  return {residue_atoms(residues.first).first,
+          residue_atoms(residues.last - 1).last};
+}
+
+auto molecule::residue_name(std::size_t residue) const noexcept
+ -> const std::string&
+{
+  return residue_names_[residue];
+}
+
+auto molecule::residue_number(std::size_t residue) const noexcept -> int
+{
+  return residue_numbers_[residue];
+}
+
+auto molecule::residue_atoms(std::size_t residue) const noexcept
+ -> index_range
+{
+  const auto last = residue + 1 < residue_first_atoms_.size()
+                     ? residue_first_atoms_[residue + 1]
+                     : static_cast<std::uint32_t>(atoms_.size());
+  return {residue_first_atoms_[residue], last};
+}
+
+auto molecule::atom_residue(std::size_t atom) const noexcept -> std::size_t
+{
+  const auto it = std::upper_bound(
+   residue_first_atoms_.begin(), residue_first_atoms_.end(), atom);
+  if(it == residue_first_atoms_.begin()) {
+    return residues_size();
+  }
+
+  return static_cast<std::size_t>(it - residue_first_atoms_.begin()) - 1;
+}
+
+void molecule::add_assembly_group(assembly_group group)
+{
+  assembly_groups_.push_back(std::move(group));
+}
+
+auto molecule::assembly_groups() const noexcept
+ -> const std::vector<assembly_group>&
+{
+  return assembly_groups_;
+}
+
+auto molecule::assembly_transforms() const -> std::vector<mat4<float>>
+{
+  auto transforms = std::vector<mat4<float>>{};
+  for(const auto& group : assembly_groups_) {
+    const auto& ids = group.chain_ids;
+    const auto listed = [&ids](const std::string& id) {
+      return ids.empty() || std::find(ids.begin(), ids.end(), id) != ids.end();
+    };
+    if(!std::all_of(chain_ids_.begin(), chain_ids_.end(), listed)) {
+      return {};
+    }
+
+    transforms.insert(
+     transforms.end(), group.transforms.begin(), group.transforms.end());
+  }
+  return transforms;
+}
+
 } // namespace molphene
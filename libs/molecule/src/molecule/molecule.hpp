@@ -1,12 +1,35 @@
 #ifndef MOLPHENE_MOLECULE_MOLECULE_HPP
 #define MOLPHENE_MOLECULE_MOLECULE_HPP
 
+#include <cstdint>
+#include <string>
 #include <vector>
 
+#include <gsl/gsl>
+
 #include "atom.hpp"
 #include "bond.hpp"
 
 namespace molphene {
+
+// Half-open range of indices into the atoms, residues or chains of a
+// molecule.
+struct index_range {
+  std::uint32_t first{0};
+  std::uint32_t last{0};
+
+  auto size() const noexcept -> std::size_t
+  {
+    return last - first;
+  }
+};
+
+// Atoms and bonds, with the atoms grouped into residues and the residues into
+// chains. Both levels are stored as offset arrays: residue i holds the atoms
+// from its first atom up to the first atom of residue i + 1, and likewise for
+// chains, so that ranges are looked up in constant time. Atoms added before
+// the first residue belong to none, and molecules without residue records
+// have no chains at all.
 class molecule {
 public:
   using atoms_type = std::vector<atom>;
@@ -18,12 +41,74 @@ public:
 
   void add_atom(const atom& atom);
 
+  // Moves every atom to coords, x, y, z per atom in atom order, as read from
+  // a trajectory frame.
+  void atom_positions(gsl::span<const float> coords) noexcept;
+
+  // Throws std::out_of_range when the bond names an atom not added yet, so
+  // that users of the bonds can index the atoms unchecked.
   void add_bond(const bond& bond);
 
+  // Starts a chain that holds the residues added after it.
+  void add_chain(std::string id);
+
+  // Starts a residue that holds the atoms added after it, in the last chain
+  // or in a new chain without id when there is none yet.
+  void add_residue(std::string name, int number);
+
+  auto chains_size() const noexcept -> std::size_t;
+
+  auto residues_size() const noexcept -> std::size_t;
+
+  auto chain_id(std::size_t chain) const noexcept -> const std::string&;
+
+  auto chain_residues(std::size_t chain) const noexcept -> index_range;
+
+  auto chain_atoms(std::size_t chain) const noexcept -> index_range;
+
+  auto residue_name(std::size_t residue) const noexcept -> const std::string&;
+
+  auto residue_number(std::size_t residue) const noexcept -> int;
+
+  auto residue_atoms(std::size_t residue) const noexcept -> index_range;
+
+  // Residue holding the atom, or residues_size() for atoms outside every
+  // residue. Takes a binary search over the residues.
+  auto atom_residue(std::size_t atom) const noexcept -> std::size_t;
+
+  // Rigid transforms, column-major, that place copies of the listed chains
+  // in the biological assembly. A group without chains applies to all.
+  struct assembly_group {
+    std::vector<std::string> chain_ids;
+    std::vector<mat4<float>> transforms;
+  };
+
+  void add_assembly_group(assembly_group group);
+
+  auto assembly_groups() const noexcept -> const std::vector<assembly_group>&;
+
+  // Transforms that place copies of the whole molecule to make up the
+  // assembly. Empty when the atoms are the whole assembly, and also when
+  // some group leaves chains out: representations draw all chains from
+  // shared buffers, so such assemblies are shown as the asymmetric unit.
+  auto assembly_transforms() const -> std::vector<mat4<float>>;
+
 private:
   atoms_type atoms_;
 
   bonds_type bonds_;
+
+  std::vector<std::string> chain_ids_;
+
+  std::vector<std::uint32_t> chain_first_residues_;
+
+  std::vector<std::string> residue_names_;
+
+  std::vector<int> residue_numbers_;
+
+  std::vector<std::uint32_t> residue_first_atoms_;
+
+  std::vector<assembly_group> assembly_groups_;
 };
 
 } // namespace molphene
@@ -0,0 +1,74 @@
+#ifndef MOLPHENE_MOLECULE_PARALLEL_FOR_HPP
+#define MOLPHENE_MOLECULE_PARALLEL_FOR_HPP
+
+#include "stdafx.hpp"
+
+#ifndef __EMSCRIPTEN__
+#include <thread>
+#endif
+
+namespace molphene {
+
+// Calls func(begin, end) on contiguous index ranges covering [first, last),
+// one range per hardware thread. Ranges shorter than min_grain are not worth
+// a thread and run on the calling thread, as does everything under
+// emscripten.
+template<typename TIndex, typename Function>
+void parallel_for_slice(TIndex first,
+                        TIndex last,
+                        TIndex min_grain,
+                        Function func)
+{
+  const auto length = last - first;
+  if(length <= 0) {
+    return;
+  }
+
+#ifdef __EMSCRIPTEN__
+  func(first, last);
+#else
+  const auto hardware_threads =
+   static_cast<TIndex>(std::max(1U, std::thread::hardware_concurrency()));
+  const auto threads_n =
+   std::min(hardware_threads, std::max(TIndex{1}, length / min_grain));
+
+  if(threads_n == 1) {
+    func(first, last);
+    return;
+  }
+
+  const auto slice_length = length / threads_n + (length % threads_n ? 1 : 0);
+
+  auto workers = std::vector<std::thread>{};
+  workers.reserve(threads_n - 1);
+  auto slice_begin = first;
+  for(auto i = TIndex{1}; i < threads_n && slice_begin < last; ++i) {
+    const auto slice_end = std::min(last, slice_begin + slice_length);
+    workers.emplace_back(func, slice_begin, slice_end);
+    slice_begin = slice_end;
+  }
+
+  if(slice_begin < last) {
+    func(slice_begin, last);
+  }
+
+  for(auto& worker : workers) {
+    worker.join();
+  }
+#endif
+}
+
+template<typename TIndex, typename Function>
+void parallel_for(TIndex first, TIndex last, TIndex min_grain, Function func)
+{
+  parallel_for_slice(
+   first, last, min_grain, [&func](TIndex begin, TIndex end) {
+     for(auto i = begin; i < end; ++i) {
+       func(i);
+     }
+   });
+}
+
+} // namespace molphene
+
+#endif
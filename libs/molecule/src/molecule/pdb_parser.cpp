@@ -0,0 +1,280 @@
+#include "pdb_parser.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+
+#include "distance_bonds.hpp"
+
+namespace molphene {
+namespace {
+
+// Columns first to first + length of a record, 0-based, without blanks.
+auto field(std::string_view line, std::size_t first, std::size_t length)
+ -> std::string_view
+{
+  if(first >= line.size()) {
+    return {};
+  }
+
+  auto value = line.substr(first, length);
+  while(!value.empty() && std::isspace(static_cast<unsigned char>(value[0]))) {
+    value.remove_prefix(1);
+  }
+  while(!value.empty() &&
+        std::isspace(static_cast<unsigned char>(value.back()))) {
+    value.remove_suffix(1);
+  }
+  return value;
+}
+
+auto to_int(std::string_view value) noexcept -> std::optional<int>
+{
+  auto result = 0;
+  const auto [end, error] =
+   std::from_chars(value.data(), value.data() + value.size(), result);
+  if(error != std::errc{} || end == value.data()) {
+    return std::nullopt;
+  }
+  return result;
+}
+
+auto to_float(std::string_view value) noexcept -> float
+{
+  auto buffer = std::array<char, 16>{};
+  const auto length = std::min(value.size(), buffer.size() - 1);
+  std::copy_n(value.begin(), length, buffer.begin());
+  return std::strtof(buffer.data(), nullptr);
+}
+
+// Element columns, or the leading letters of the atom name when they are
+// blank. Names of one-letter elements start in the second column.
+auto element_symbol(std::string_view line) -> std::string
+{
+  auto symbol = std::string{field(line, 76, 2)};
+  if(symbol.empty()) {
+    const auto name = line.substr(12, 2);
+    const auto is_letter = [](char c) noexcept {
+      return std::isalpha(static_cast<unsigned char>(c)) != 0;
+    };
+    if(name.size() == 2 && is_letter(name[0]) && is_letter(name[1])) {
+      symbol = name;
+    } else if(name.size() == 2 && is_letter(name[1])) {
+      symbol = name.substr(1);
+    }
+  }
+
+  std::transform(symbol.begin(), symbol.end(), symbol.begin(), [](char c) {
+    return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+  });
+  return symbol;
+}
+
+// Rows of a REMARK 350 BIOMT record: operator number, then a row of the
+// rotation followed by the translation.
+auto biomt_row(std::string_view line) -> std::optional<std::array<float, 5>>
+{
+  auto row = std::array<float, 5>{};
+  auto rest = line.substr(std::min<std::size_t>(line.size(), 19));
+  for(auto& value : row) {
+    const auto first = rest.find_first_not_of(' ');
+    if(first == std::string_view::npos) {
+      return std::nullopt;
+    }
+    rest.remove_prefix(first);
+
+    const auto last = std::min(rest.find(' '), rest.size());
+    value = to_float(rest.substr(0, last));
+    rest.remove_prefix(last);
+  }
+  return row;
+}
+
+constexpr auto apply_to_chains =
+ std::string_view{"APPLY THE FOLLOWING TO CHAINS:"};
+
+constexpr auto and_chains = std::string_view{"AND CHAINS:"};
+
+// Appends the chain ids of a comma-separated list.
+void append_chain_ids(std::string_view list, std::vector<std::string>& ids)
+{
+  while(!list.empty()) {
+    const auto comma = std::min(list.find(','), list.size());
+    if(const auto id = field(list, 0, comma); !id.empty()) {
+      ids.emplace_back(id);
+    }
+    list.remove_prefix(std::min(comma + 1, list.size()));
+  }
+}
+
+} // namespace
+
+auto pdb_alt_location_filter::keep(std::string_view line) noexcept -> bool
+{
+  const auto residue = line.substr(21, 6);
+  if(residue != residue_) {
+    residue_ = residue;
+    alt_location_ = ' ';
+  }
+
+  const auto alt_location = line[16];
+  if(alt_location == ' ') {
+    return true;
+  }
+  if(alt_location_ == ' ') {
+    alt_location_ = alt_location;
+  }
+  return alt_location == alt_location_;
+}
+
+auto pdb_parser::parse(std::istream& is) -> molecule
+{
+  const auto strpdb = std::string{std::istreambuf_iterator<char>{is}, {}};
+  return parse(strpdb);
+}
+
+auto pdb_parser::parse(std::string_view strpdb) -> molecule
+{
+  auto mol = molecule{};
+
+  auto serial_atoms = std::unordered_map<int, int>{};
+  auto conect_bonds = std::vector<std::pair<int, int>>{};
+
+  auto biomolecules = 0;
+  auto biomt = mat4<float>{1};
+  auto assembly_groups = std::vector<molecule::assembly_group>{};
+
+  auto chain_id = std::string_view{};
+  auto residue_key = std::string_view{};
+  auto new_chain = true;
+  auto alt_locations = pdb_alt_location_filter{};
+
+  while(!strpdb.empty()) {
+    const auto eol = strpdb.find('\n');
+    auto line = strpdb.substr(0, eol);
+    strpdb.remove_prefix(eol == std::string_view::npos ? strpdb.size()
+                                                       : eol + 1);
+    if(!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+
+    const auto record = field(line, 0, 6);
+    if(record == "ENDMDL") {
+      break;
+    }
+
+    // Only the first biological assembly is read. Its operators come in
+    // groups, each after the list of chains it applies to.
+    if(record == "REMARK" && field(line, 6, 4) == "350") {
+      const auto remark = field(line, 10, 70);
+      if(remark.substr(0, 12) == "BIOMOLECULE:") {
+        ++biomolecules;
+      }
+      if(biomolecules > 1) {
+        continue;
+      }
+
+      if(remark.substr(0, apply_to_chains.size()) == apply_to_chains) {
+        assembly_groups.emplace_back();
+        append_chain_ids(remark.substr(apply_to_chains.size()),
+                         assembly_groups.back().chain_ids);
+      } else if(remark.substr(0, and_chains.size()) == and_chains &&
+                !assembly_groups.empty()) {
+        append_chain_ids(remark.substr(and_chains.size()),
+                         assembly_groups.back().chain_ids);
+      }
+
+      const auto axis = remark.size() > 5 ? remark[5] - '1' : -1;
+      if(remark.substr(0, 5) == "BIOMT" && axis >= 0 && axis < 3) {
+        if(const auto row = biomt_row(line)) {
+          auto* m = static_cast<float*>(biomt.m);
+          for(auto column = 0; column < 4; ++column) {
+            m[column * 4 + axis] = (*row)[column + 1];
+          }
+          if(axis == 2) {
+            if(assembly_groups.empty()) {
+              assembly_groups.emplace_back();
+            }
+            assembly_groups.back().transforms.push_back(biomt);
+          }
+        }
+      }
+      continue;
+    }
+
+    if(record == "TER") {
+      new_chain = true;
+      continue;
+    }
+
+    if(record == "CONECT") {
+      const auto from = to_int(field(line, 6, 5));
+      for(auto column = std::size_t{11}; from && column < 31; column += 5) {
+        const auto to = to_int(field(line, column, 5));
+        if(!to) {
+          break;
+        }
+
+        const auto first = serial_atoms.find(*from);
+        const auto second = serial_atoms.find(*to);
+        if(first != serial_atoms.end() && second != serial_atoms.end()) {
+          conect_bonds.emplace_back(std::min(first->second, second->second),
+                                    std::max(first->second, second->second));
+        }
+      }
+      continue;
+    }
+
+    if((record != "ATOM" && record != "HETATM") || line.size() < 54) {
+      continue;
+    }
+
+    if(!alt_locations.keep(line)) {
+      continue;
+    }
+
+    const auto chain = field(line, 21, 1);
+    if(new_chain || chain != chain_id) {
+      mol.add_chain(std::string{chain});
+      chain_id = chain;
+      residue_key = {};
+      new_chain = false;
+    }
+
+    // Residue name, sequence number and insertion code.
+    const auto key = line.substr(17, 10);
+    if(key != residue_key) {
+      mol.add_residue(std::string{field(line, 17, 3)},
+                      to_int(field(line, 22, 4)).value_or(0));
+      residue_key = key;
+    }
+
+    const auto serial = to_int(field(line, 6, 5)).value_or(0);
+    serial_atoms[serial] = static_cast<int>(mol.atoms().size());
+
+    auto atm = atom{element_symbol(line),
+                    std::string{field(line, 12, 4)},
+                    static_cast<unsigned int>(serial)};
+    atm.position(to_float(field(line, 30, 8)),
+                 to_float(field(line, 38, 8)),
+                 to_float(field(line, 46, 8)));
+    mol.add_atom(atm);
+  }
+
+  auto bonds = distance_bonds(mol.atoms());
+  bonds.insert(bonds.end(), conect_bonds.begin(), conect_bonds.end());
+  std::sort(bonds.begin(), bonds.end());
+  bonds.erase(std::unique(bonds.begin(), bonds.end()), bonds.end());
+
+  for(const auto& [first, second] : bonds) {
+    mol.add_bond(bond{first, second});
+  }
+
+  for(auto& group : assembly_groups) {
+    mol.add_assembly_group(std::move(group));
+  }
+
+  return mol;
+}
+
+} // namespace molphene
@@ -0,0 +1,38 @@
+#ifndef MOLPHENE_PDB_PARSER_HPP
+#define MOLPHENE_PDB_PARSER_HPP
+
+#include "stdafx.hpp"
+
+#include "molecule.hpp"
+
+namespace molphene {
+
+// Reads the ATOM, HETATM, TER and CONECT records of the first model of a PDB
+// file into chains and residues. Atoms within covalent reach of each other
+// are bonded besides the CONECT bonds, since PDB files only list those for
+// hetero groups. Of alternate locations only the first is kept.
+class pdb_parser {
+public:
+  auto parse(std::istream& is) -> molecule;
+
+  auto parse(std::string_view strpdb) -> molecule;
+};
+
+// Picks the atoms of the first alternate location each residue lists,
+// whatever its letter, along with the atoms without one. Takes the ATOM and
+// HETATM records of a model in file order, from text that outlives it.
+class pdb_alt_location_filter {
+public:
+  auto keep(std::string_view line) noexcept -> bool;
+
+private:
+  // Chain, sequence number and insertion code of the last residue; the
+  // residue name may differ between locations.
+  std::string_view residue_;
+
+  char alt_location_{' '};
+};
+
+} // namespace molphene
+
+#endif
@@ -0,0 +1,175 @@
+#include "sasa.hpp"
+
+#include "cell_list.hpp"
+#include "fibonacci_directions.hpp"
+#include "parallel_for.hpp"
+
+namespace molphene {
+namespace {
+
+constexpr auto fallback_radius = 1.5f;
+
+constexpr auto pi = 3.14159265358979323846;
+
+// Neighbour spheres of one atom as structure of arrays, each with its center
+// relative to the atom. With the atom's expanded radius r, a neighbour at c
+// of radius R contains the point r * p of the direction p exactly when
+// p . c > (r^2 + c . c - R^2) / 2r, the threshold kept for it, so that a
+// point costs one dot product per neighbour.
+struct neighbour_spheres {
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+  std::vector<float> threshold;
+
+  void clear() noexcept
+  {
+    x.clear();
+    y.clear();
+    z.clear();
+    threshold.clear();
+  }
+
+  void push_back(const vec3<float>& offset, float limit)
+  {
+    x.push_back(offset.x());
+    y.push_back(offset.y());
+    z.push_back(offset.z());
+    threshold.push_back(limit);
+  }
+
+  auto size() const noexcept -> std::size_t
+  {
+    return x.size();
+  }
+};
+
+auto is_buried(const vec3<float>& direction,
+               const neighbour_spheres& neighbours,
+               std::size_t& hint) noexcept -> bool
+{
+  const auto* xs = neighbours.x.data();
+  const auto* ys = neighbours.y.data();
+  const auto* zs = neighbours.z.data();
+  const auto* thresholds = neighbours.threshold.data();
+  const auto px = direction.x();
+  const auto py = direction.y();
+  const auto pz = direction.z();
+
+  const auto buries = [&](std::size_t j) noexcept {
+    return xs[j] * px + ys[j] * py + zs[j] * pz > thresholds[j];
+  };
+
+  // Consecutive points are close, so the neighbour that buried the previous
+  // one most often buries this one too.
+  const auto size = neighbours.size();
+  if(hint < size && buries(hint)) {
+    return true;
+  }
+
+  for(auto j = std::size_t{0}; j < size; ++j) {
+    if(buries(j)) {
+      hint = j;
+      return true;
+    }
+  }
+  return false;
+}
+
+// The directions band by band from the north pole, sweeping the azimuth the
+// other way in every other band, so that consecutive directions are close.
+// The Fibonacci order turns by the golden angle between them instead.
+auto serpentine_order(std::vector<vec3<float>> directions)
+ -> std::vector<vec3<float>>
+{
+  const auto bands =
+   std::max(1.f, std::round(std::sqrt(static_cast<float>(directions.size()))));
+
+  const auto key = [bands](const vec3<float>& direction) noexcept {
+    const auto band =
+     std::min(bands - 1, std::floor((1 - direction.z()) / 2 * bands));
+    const auto azimuth = std::atan2(direction.y(), direction.x());
+    return std::make_pair(
+     band, static_cast<int>(band) % 2 == 0 ? azimuth : -azimuth);
+  };
+
+  std::sort(directions.begin(),
+            directions.end(),
+            [&key](const vec3<float>& lhs, const vec3<float>& rhs) noexcept {
+              return key(lhs) < key(rhs);
+            });
+
+  return directions;
+}
+
+} // namespace
+
+auto compute_sasa(const molecule& mol, sasa_options options) -> sasa_result
+{
+  constexpr auto min_grain = std::size_t{1024};
+
+  const auto& atoms = mol.atoms();
+  const auto atoms_n = atoms.size();
+
+  auto result = sasa_result{};
+  result.atom_areas.assign(atoms_n, 0);
+  if(atoms_n == 0 || options.sphere_points == 0) {
+    return result;
+  }
+
+  auto centers = std::vector<vec3<float>>(atoms_n);
+  auto radii = std::vector<float>(atoms_n);
+  for(auto i = std::size_t{0}; i < atoms_n; ++i) {
+    const auto rvdw = atoms[i].element().rvdw;
+    centers[i] = atoms[i].position();
+    radii[i] = (rvdw > 0 ? rvdw : fallback_radius) + options.probe_radius;
+  }
+
+  const auto max_radius = *std::max_element(radii.begin(), radii.end());
+  const auto grid = cell_list{centers, max_radius};
+  const auto points =
+   serpentine_order(fibonacci_directions(options.sphere_points));
+
+  parallel_for_slice(
+   std::size_t{0}, atoms_n, min_grain, [&](std::size_t begin, std::size_t end) {
+     auto neighbours = neighbour_spheres{};
+
+     for(auto i = begin; i < end; ++i) {
+       const auto center = centers[i];
+       const auto radius = radii[i];
+
+       neighbours.clear();
+       grid.for_each_candidate(
+        center, radius + max_radius, [&](cell_list::index_type j) {
+          const auto reach = radius + radii[j];
+          const auto offset = centers[j] - center;
+          const auto distance2 = offset.dot(offset);
+          if(j != i && distance2 < reach * reach) {
+            neighbours.push_back(
+             offset,
+             (radius * radius + distance2 - radii[j] * radii[j]) /
+              (2 * radius));
+          }
+        });
+
+       auto hint = std::size_t{0};
+       auto accessible = std::size_t{0};
+       for(const auto& point : points) {
+         if(!is_buried(point, neighbours, hint)) {
+           ++accessible;
+         }
+       }
+
+       result.atom_areas[i] = static_cast<float>(
+        4 * pi * radius * radius * accessible / points.size());
+     }
+   });
+
+  for(const auto area : result.atom_areas) {
+    result.total_area += area;
+  }
+
+  return result;
+}
+
+} // namespace molphene
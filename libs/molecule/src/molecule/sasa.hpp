@@ -0,0 +1,33 @@
+#ifndef MOLPHENE_MOLECULE_SASA_HPP
+#define MOLPHENE_MOLECULE_SASA_HPP
+
+#include "stdafx.hpp"
+
+#include "molecule.hpp"
+
+namespace molphene {
+
+struct sasa_options {
+  // Radius of the solvent probe in angstrom, 1.4 for water.
+  float probe_radius{1.4f};
+
+  // Test points on each atom's expanded sphere.
+  std::size_t sphere_points{256};
+};
+
+struct sasa_result {
+  // Accessible area of each atom in square angstrom, in molecule order.
+  std::vector<float> atom_areas;
+
+  double total_area{0};
+};
+
+// Solvent-accessible surface area by the Shrake-Rupley method: the share of
+// points on each atom's van der Waals sphere, expanded by the probe radius,
+// that lie outside every neighbouring expanded sphere.
+auto compute_sasa(const molecule& mol, sasa_options options = {})
+ -> sasa_result;
+
+} // namespace molphene
+
+#endif
@@ -0,0 +1,358 @@
+#include "text_frame_source.hpp"
+
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+
+#include "parallel_for.hpp"
+#include "pdb_parser.hpp"
+
+namespace molphene {
+namespace {
+
+// Bytes scanned as one piece of work while indexing.
+constexpr auto scan_block = std::size_t{1} << 20;
+
+struct index_header {
+  std::array<char, 8> magic;
+  std::uint64_t file_size;
+  std::int64_t modified_time;
+  std::uint64_t atoms_size;
+  std::uint64_t frames_size;
+};
+
+auto index_magic(text_frame_source::format fmt) noexcept
+ -> std::array<char, 8>
+{
+  return fmt == text_frame_source::format::xyz
+          ? std::array<char, 8>{'M', 'O', 'L', 'X', 'Y', 'Z', 'I', '1'}
+          : std::array<char, 8>{'M', 'O', 'L', 'P', 'D', 'B', 'I', '1'};
+}
+
+// Takes the first line off text, without its line break.
+auto next_line(std::string_view& text) noexcept -> std::string_view
+{
+  const auto eol = text.find('\n');
+  auto line = text.substr(0, eol);
+  text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+  if(!line.empty() && line.back() == '\r') {
+    line.remove_suffix(1);
+  }
+  return line;
+}
+
+// Takes the first whitespace-separated token off text.
+auto next_token(std::string_view& text) noexcept -> std::string_view
+{
+  const auto first = std::min(text.find_first_not_of(" \t"), text.size());
+  text.remove_prefix(first);
+  const auto last = std::min(text.find_first_of(" \t"), text.size());
+  const auto token = text.substr(0, last);
+  text.remove_prefix(last);
+  return token;
+}
+
+auto to_float(std::string_view value, float& result) noexcept -> bool
+{
+  auto buffer = std::array<char, 32>{};
+  const auto length = std::min(value.size(), buffer.size() - 1);
+  std::copy_n(value.begin(), length, buffer.begin());
+
+  char* end = nullptr;
+  result = std::strtof(buffer.data(), &end);
+  return end != buffer.data();
+}
+
+auto to_size(std::string_view value) noexcept -> std::optional<std::size_t>
+{
+  const auto token = next_token(value);
+  auto result = std::size_t{0};
+  const auto [end, error] =
+   std::from_chars(token.data(), token.data() + token.size(), result);
+  if(error != std::errc{} || end != token.data() + token.size()) {
+    return std::nullopt;
+  }
+  return result;
+}
+
+// The same atoms as pdb_parser keeps, with alt_locations fed every line of
+// the frame in order.
+auto is_pdb_frame_atom(std::string_view line,
+                       pdb_alt_location_filter& alt_locations) noexcept -> bool
+{
+  return line.size() >= 54 &&
+         (line.substr(0, 6) == "ATOM  " || line.substr(0, 6) == "HETATM") &&
+         alt_locations.keep(line);
+}
+
+auto is_pdb_model_end(std::string_view line) noexcept -> bool
+{
+  return line.substr(0, 6) == "ENDMDL";
+}
+
+template<typename Function>
+void for_each_block(std::size_t size, Function func)
+{
+  const auto blocks_n = (size + scan_block - 1) / scan_block;
+  parallel_for_slice(
+   std::size_t{0},
+   blocks_n,
+   std::size_t{1},
+   [&](std::size_t first_block, std::size_t last_block) {
+     for(auto block = first_block; block < last_block; ++block) {
+       func(block,
+            block * scan_block,
+            std::min(size, (block + 1) * scan_block));
+     }
+   });
+}
+
+} // namespace
+
+text_frame_source::text_frame_source(const std::string& path, format fmt)
+: file_{path}
+, format_{fmt}
+{
+  if(!file_.is_open() || load_index(path)) {
+    return;
+  }
+
+  build_index();
+  save_index(path);
+}
+
+auto text_frame_source::frames_size() const noexcept -> std::size_t
+{
+  return offsets_.size();
+}
+
+auto text_frame_source::atoms_size() const noexcept -> std::size_t
+{
+  return atoms_size_;
+}
+
+auto text_frame_source::read_frame(std::size_t frame, gsl::span<float> coords)
+ -> bool
+{
+  assert(static_cast<std::size_t>(coords.size()) == atoms_size_ * 3);
+
+  if(frame >= frames_size()) {
+    return false;
+  }
+
+  auto text = frame_text(frame);
+  auto coord = coords.begin();
+
+  if(format_ == format::xyz) {
+    if(to_size(next_line(text)) != atoms_size_) {
+      return false;
+    }
+    next_line(text);
+
+    for(auto i = std::size_t{0}; i < atoms_size_; ++i) {
+      auto line = next_line(text);
+      next_token(line);
+      for(auto axis = 0; axis < 3; ++axis) {
+        if(!to_float(next_token(line), *coord++)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  auto atoms_n = std::size_t{0};
+  auto alt_locations = pdb_alt_location_filter{};
+  while(!text.empty() && atoms_n < atoms_size_) {
+    const auto line = next_line(text);
+    if(is_pdb_model_end(line)) {
+      break;
+    }
+    if(!is_pdb_frame_atom(line, alt_locations)) {
+      continue;
+    }
+
+    to_float(line.substr(30, 8), *coord++);
+    to_float(line.substr(38, 8), *coord++);
+    to_float(line.substr(46, 8), *coord++);
+    ++atoms_n;
+  }
+  return atoms_n == atoms_size_;
+}
+
+auto text_frame_source::frame_text(std::size_t frame) const noexcept
+ -> std::string_view
+{
+  const auto data = file_.data();
+  const auto first = static_cast<std::size_t>(offsets_[frame]);
+  const auto last = frame + 1 < offsets_.size()
+                     ? static_cast<std::size_t>(offsets_[frame + 1])
+                     : data.size();
+  return data.substr(first, last - first);
+}
+
+auto text_frame_source::first_frame_text() const noexcept -> std::string_view
+{
+  const auto data = file_.data();
+  return offsets_.size() > 1
+          ? data.substr(0, static_cast<std::size_t>(offsets_[1]))
+          : data;
+}
+
+auto text_frame_source::index_path(const std::string& path) -> std::string
+{
+  return path + ".idx";
+}
+
+void text_frame_source::build_index()
+{
+  const auto data = file_.data();
+  const auto blocks_n = (data.size() + scan_block - 1) / scan_block;
+
+  if(format_ == format::xyz) {
+    // Every frame is the same number of lines, so frame starts follow from
+    // line numbers: count the lines of each block, then record the starts
+    // of frames within each block from the lines before it.
+    auto text = data;
+    atoms_size_ = to_size(next_line(text)).value_or(0);
+    if(atoms_size_ == 0) {
+      return;
+    }
+
+    auto block_lines = std::vector<std::size_t>(blocks_n + 1);
+    for_each_block(data.size(), [&](auto block, auto first, auto last) {
+      block_lines[block + 1] = static_cast<std::size_t>(
+       std::count(data.begin() + first, data.begin() + last, '\n'));
+    });
+    std::partial_sum(
+     block_lines.begin(), block_lines.end(), block_lines.begin());
+
+    const auto lines_n =
+     block_lines.back() + (data.back() != '\n' ? std::size_t{1} : 0);
+    const auto frame_lines = atoms_size_ + 2;
+    offsets_.resize(lines_n / frame_lines);
+
+    for_each_block(data.size(), [&](auto block, auto first, auto last) {
+      auto line = block_lines[block];
+      auto start = first;
+      if(start > 0 && data[start - 1] != '\n') {
+        start = data.find('\n', start);
+        if(start == std::string_view::npos || start + 1 >= last) {
+          return;
+        }
+        ++start;
+        ++line;
+      }
+
+      while(start < last) {
+        if(line % frame_lines == 0 && line / frame_lines < offsets_.size()) {
+          offsets_[line / frame_lines] = start;
+        }
+
+        start = data.find('\n', start);
+        if(start == std::string_view::npos) {
+          break;
+        }
+        ++start;
+        ++line;
+      }
+    });
+    return;
+  }
+
+  // Each block collects the MODEL records that start within it.
+  auto block_offsets = std::vector<std::vector<std::uint64_t>>(blocks_n);
+  for_each_block(data.size(), [&](auto block, auto first, auto last) {
+    constexpr auto record = std::string_view{"\nMODEL "};
+
+    auto& offsets = block_offsets[block];
+    if(first == 0 && data.substr(0, 6) == "MODEL ") {
+      offsets.push_back(0);
+    }
+
+    const auto scanned = data.substr(0, last + record.size() - 1);
+    auto found = first == 0 ? 0 : first - 1;
+    while((found = scanned.find(record, found)) != std::string_view::npos &&
+          found + 1 < last) {
+      offsets.push_back(found + 1);
+      ++found;
+    }
+  });
+
+  for(const auto& offsets : block_offsets) {
+    offsets_.insert(offsets_.end(), offsets.begin(), offsets.end());
+  }
+
+  // A file without MODEL records is a single frame.
+  if(offsets_.empty() && !data.empty()) {
+    offsets_.push_back(0);
+  }
+  if(offsets_.empty()) {
+    return;
+  }
+
+  auto text = first_frame_text();
+  auto alt_locations = pdb_alt_location_filter{};
+  while(!text.empty()) {
+    const auto line = next_line(text);
+    if(is_pdb_model_end(line)) {
+      break;
+    }
+    if(is_pdb_frame_atom(line, alt_locations)) {
+      ++atoms_size_;
+    }
+  }
+}
+
+auto text_frame_source::load_index(const std::string& path) -> bool
+{
+  auto is = std::ifstream{index_path(path), std::ios::binary};
+  auto header = index_header{};
+  if(!is.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+     header.magic != index_magic(format_) ||
+     header.file_size != file_.data().size() ||
+     header.modified_time != file_.modified_time()) {
+    return false;
+  }
+
+  auto offsets = std::vector<std::uint64_t>(header.frames_size);
+  const auto bytes =
+   static_cast<std::streamsize>(offsets.size() * sizeof(std::uint64_t));
+  if(!is.read(reinterpret_cast<char*>(offsets.data()), bytes) ||
+     !std::is_sorted(offsets.begin(), offsets.end()) ||
+     (!offsets.empty() && offsets.back() >= header.file_size)) {
+    return false;
+  }
+
+  atoms_size_ = static_cast<std::size_t>(header.atoms_size);
+  offsets_ = std::move(offsets);
+  return true;
+}
+
+// Another process may be reading the same index, so it is written aside and
+// renamed into place.
+auto text_frame_source::save_index(const std::string& path) const -> bool
+{
+  const auto target = index_path(path);
+  const auto written = target + ".tmp";
+
+  {
+    auto os = std::ofstream{written, std::ios::binary | std::ios::trunc};
+    const auto header = index_header{index_magic(format_),
+                                     file_.data().size(),
+                                     file_.modified_time(),
+                                     atoms_size_,
+                                     offsets_.size()};
+    const auto bytes =
+     static_cast<std::streamsize>(offsets_.size() * sizeof(std::uint64_t));
+    if(!os.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+       !os.write(reinterpret_cast<const char*>(offsets_.data()), bytes)) {
+      return false;
+    }
+  }
+
+  return std::rename(written.c_str(), target.c_str()) == 0;
+}
+
+} // namespace molphene
@@ -0,0 +1,56 @@
+#ifndef MOLPHENE_MOLECULE_TEXT_FRAME_SOURCE_HPP
+#define MOLPHENE_MOLECULE_TEXT_FRAME_SOURCE_HPP
+
+#include "stdafx.hpp"
+
+#include "frame_source.hpp"
+#include "mapped_file.hpp"
+
+namespace molphene {
+
+// Frames of a multi-frame XYZ file, or the models of a multi-model PDB file,
+// parsed in place from the mapped file. The first open scans the file in
+// parallel for the offset of every frame and saves the offsets next to it,
+// as index_path, so that later opens skip the scan and any frame is a seek
+// away.
+class text_frame_source : public frame_source {
+public:
+  enum class format { xyz, pdb };
+
+  text_frame_source(const std::string& path, format fmt);
+
+  auto frames_size() const noexcept -> std::size_t override;
+
+  auto atoms_size() const noexcept -> std::size_t override;
+
+  auto read_frame(std::size_t frame, gsl::span<float> coords)
+   -> bool override;
+
+  // Text of the frame, from its first line up to the next frame.
+  auto frame_text(std::size_t frame) const noexcept -> std::string_view;
+
+  // Everything before the second frame, with the headers of the file.
+  auto first_frame_text() const noexcept -> std::string_view;
+
+  static auto index_path(const std::string& path) -> std::string;
+
+private:
+  void build_index();
+
+  auto load_index(const std::string& path) -> bool;
+
+  auto save_index(const std::string& path) const -> bool;
+
+  mapped_file file_;
+
+  format format_;
+
+  std::size_t atoms_size_{0};
+
+  // Offset of the first line of each frame.
+  std::vector<std::uint64_t> offsets_;
+};
+
+} // namespace molphene
+
+#endif
@@ -0,0 +1,128 @@
+#include "trajectory.hpp"
+
+namespace molphene {
+
+trajectory::trajectory(std::unique_ptr<frame_source> source,
+                       std::size_t ring_frames)
+: source_{std::move(source)}
+, ring_frames_{std::max(ring_frames, std::size_t{1})}
+{
+  assert(source_);
+
+  ring_.resize(ring_frames_ * frame_floats());
+
+#ifndef __EMSCRIPTEN__
+  reader_ = std::thread{[this] { read_ahead(); }};
+#endif
+}
+
+trajectory::~trajectory() noexcept
+{
+#ifndef __EMSCRIPTEN__
+  {
+    const auto lock = std::lock_guard{mutex_};
+    stopping_ = true;
+  }
+  changed_.notify_all();
+  reader_.join();
+#endif
+}
+
+auto trajectory::atoms_size() const noexcept -> std::size_t
+{
+  return source_->atoms_size();
+}
+
+auto trajectory::frames_size() const noexcept -> std::size_t
+{
+  return source_->frames_size();
+}
+
+auto trajectory::frame(std::size_t index) -> gsl::span<const float>
+{
+  if(index >= frames_size()) {
+    return {};
+  }
+
+  auto lock = std::unique_lock{mutex_};
+
+  // The frame after the ready ones is the one the read-ahead fills next, so
+  // asking for it again while it is read keeps the read in flight.
+  if(index < first_ || index > first_ + ready_) {
+    first_ = index;
+    ready_ = 0;
+    failed_ = false;
+    ++generation_;
+  } else {
+    ready_ -= index - first_;
+    first_ = index;
+  }
+
+#ifdef __EMSCRIPTEN__
+  if(ready_ == 0 && !failed_) {
+    failed_ = !source_->read_frame(index, slot(index));
+    ready_ = failed_ ? 0 : 1;
+  }
+#endif
+
+  const auto ready = ready_ > 0;
+
+#ifndef __EMSCRIPTEN__
+  lock.unlock();
+  changed_.notify_all();
+#endif
+
+  if(!ready) {
+    return {};
+  }
+
+  return slot(index);
+}
+
+auto trajectory::frame_floats() const noexcept -> std::size_t
+{
+  return source_->atoms_size() * 3;
+}
+
+auto trajectory::slot(std::size_t index) noexcept -> gsl::span<float>
+{
+  const auto floats = frame_floats();
+  return {ring_.data() + (index % ring_frames_) * floats, floats};
+}
+
+void trajectory::read_ahead()
+{
+  auto lock = std::unique_lock{mutex_};
+  while(true) {
+    changed_.wait(lock, [this] {
+      return stopping_ ||
+             (!failed_ && ready_ < ring_frames_ &&
+              first_ + ready_ < frames_size());
+    });
+
+    if(stopping_) {
+      return;
+    }
+
+    const auto index = first_ + ready_;
+    const auto generation = generation_;
+
+    // The slot belongs to no ready frame, so it is filled unlocked.
+    lock.unlock();
+    const auto read = source_->read_frame(index, slot(index));
+    lock.lock();
+
+    if(generation != generation_) {
+      continue;
+    }
+
+    if(read) {
+      ++ready_;
+    } else {
+      failed_ = true;
+    }
+    changed_.notify_all();
+  }
+}
+
+} // namespace molphene
@@ -0,0 +1,89 @@
+#ifndef MOLPHENE_MOLECULE_TRAJECTORY_HPP
+#define MOLPHENE_MOLECULE_TRAJECTORY_HPP
+
+#include "stdafx.hpp"
+
+#include <condition_variable>
+#include <mutex>
+
+#ifndef __EMSCRIPTEN__
+#include <thread>
+#endif
+
+#include "frame_source.hpp"
+
+namespace molphene {
+
+// Coordinate frames streamed from a frame source through a ring of
+// ring_frames frames, for the atoms of a molecule kept by the caller. A
+// background thread reads ahead of the last frame asked for, so sequential
+// playback rarely waits on the source, and memory stays at ring_frames
+// frames whatever the length of the trajectory. Under emscripten frames are
+// read on demand instead.
+class trajectory {
+public:
+  static constexpr auto default_ring_frames = std::size_t{8};
+
+  explicit trajectory(std::unique_ptr<frame_source> source,
+                      std::size_t ring_frames = default_ring_frames);
+
+  trajectory(const trajectory&) = delete;
+
+  trajectory(trajectory&&) = delete;
+
+  auto operator=(const trajectory&) -> trajectory& = delete;
+
+  auto operator=(trajectory&&) -> trajectory& = delete;
+
+  ~trajectory() noexcept;
+
+  auto atoms_size() const noexcept -> std::size_t;
+
+  auto frames_size() const noexcept -> std::size_t;
+
+  // Coordinates of the frame, x, y, z per atom. Frames before it are
+  // released to the read-ahead, and the span stays valid until the next
+  // call. Empty, without waiting, while the frame is still being read or
+  // when it cannot be read.
+  auto frame(std::size_t index) -> gsl::span<const float>;
+
+private:
+  auto frame_floats() const noexcept -> std::size_t;
+
+  auto slot(std::size_t index) noexcept -> gsl::span<float>;
+
+  void read_ahead();
+
+  std::unique_ptr<frame_source> source_;
+
+  std::size_t ring_frames_;
+
+  // Frames ring_frames long, one after the other.
+  std::vector<float> ring_;
+
+  std::mutex mutex_;
+
+  std::condition_variable changed_;
+
+  // The ring holds the ready frames first_ to first_ + ready_, and the
+  // read-ahead fills frame first_ + ready_ next.
+  std::size_t first_{0};
+
+  std::size_t ready_{0};
+
+  // Bumped on every seek, so that a read in flight for frames left behind is
+  // dropped.
+  std::size_t generation_{0};
+
+  bool failed_{false};
+
+  bool stopping_{false};
+
+#ifndef __EMSCRIPTEN__
+  std::thread reader_;
+#endif
+};
+
+} // namespace molphene
+
+#endif
@@ -0,0 +1,376 @@
+#include "xtc_frame_source.hpp"
+
+#include <cstring>
+
+namespace molphene {
+namespace {
+
+constexpr auto xtc_magic = std::uint32_t{1995};
+
+// Magic, atom count, step, time and box, then the atom count again.
+constexpr auto header_bytes = std::size_t{56};
+
+// Precision, minimum and maximum integer coordinates, the first small index
+// and the size of the bit stream.
+constexpr auto compressed_header_bytes = std::size_t{36};
+
+// Frames of this many atoms or fewer are stored as plain floats.
+constexpr auto max_uncompressed_atoms = std::size_t{9};
+
+constexpr auto angstrom_per_nm = 10.f;
+
+// Ranges of the small differences between neighbouring atoms, about 2^(1/3)
+// apart, as in the GROMACS xdrfile library.
+constexpr auto magic_ints = std::array<std::int32_t, 73>{
+ 0,       0,       0,        0,        0,        0,        0,       0,
+ 0,       8,       10,       12,       16,       20,       25,      32,
+ 40,      50,      64,       80,       101,      128,      161,     203,
+ 256,     322,     406,      512,      645,      812,      1024,    1290,
+ 1625,    2048,    2580,     3250,     4096,     5060,     6501,    8192,
+ 10321,   13003,   16384,    20642,    26007,    32768,    41285,   52015,
+ 65536,   82570,   104031,   131072,   165140,   208063,   262144,  330280,
+ 416127,  524287,  660561,   832255,   1048576,  1321122,  1664510, 2097152,
+ 2642245, 3329021, 4194304,  5284491,  6658042,  8388607,  10568983,
+ 13316085, 16777216};
+
+constexpr auto first_index = 9;
+
+constexpr auto last_index = static_cast<int>(magic_ints.size());
+
+auto load_be32(std::string_view data, std::size_t offset) noexcept
+ -> std::uint32_t
+{
+  const auto* bytes =
+   reinterpret_cast<const unsigned char*>(data.data() + offset);
+  return (std::uint32_t{bytes[0]} << 24) | (std::uint32_t{bytes[1]} << 16) |
+         (std::uint32_t{bytes[2]} << 8) | std::uint32_t{bytes[3]};
+}
+
+auto load_be_float(std::string_view data, std::size_t offset) noexcept
+ -> float
+{
+  const auto bits = load_be32(data, offset);
+  auto value = 0.f;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+auto load_be_int(std::string_view data, std::size_t offset) noexcept
+ -> std::int32_t
+{
+  return static_cast<std::int32_t>(load_be32(data, offset));
+}
+
+// Size of the frame at offset, or the largest size_t when the file ends
+// before the size of its bit stream.
+auto frame_bytes(std::string_view data, std::size_t offset) noexcept
+ -> std::size_t
+{
+  const auto atoms_n = load_be32(data, offset + 4);
+  if(atoms_n <= max_uncompressed_atoms) {
+    return header_bytes + atoms_n * 3 * sizeof(float);
+  }
+
+  const auto stream_offset = offset + header_bytes + compressed_header_bytes;
+  if(stream_offset > data.size()) {
+    return std::numeric_limits<std::size_t>::max();
+  }
+  const auto stream_bytes = load_be32(data, stream_offset - 4);
+  return header_bytes + compressed_header_bytes + (stream_bytes + 3) / 4 * 4;
+}
+
+// Bits in the smallest width that holds values below size.
+auto bits_of_int(std::uint32_t size) noexcept -> int
+{
+  auto bits = 0;
+  for(auto num = std::uint64_t{1}; size >= num && bits < 32; num <<= 1) {
+    ++bits;
+  }
+  return bits;
+}
+
+// Bits in the smallest width that holds the mixed-radix number of three
+// digits below sizes.
+auto bits_of_ints(const std::array<std::uint32_t, 3>& sizes) noexcept -> int
+{
+  auto bytes = std::array<std::uint32_t, 32>{1};
+  auto bytes_n = std::size_t{1};
+  for(const auto size : sizes) {
+    auto carry = std::uint64_t{0};
+    auto i = std::size_t{0};
+    for(; i < bytes_n; ++i) {
+      carry += std::uint64_t{bytes[i]} * size;
+      bytes[i] = static_cast<std::uint32_t>(carry & 0xff);
+      carry >>= 8;
+    }
+    for(; carry != 0; ++i) {
+      bytes[i] = static_cast<std::uint32_t>(carry & 0xff);
+      carry >>= 8;
+    }
+    bytes_n = i;
+  }
+
+  auto bits = 0;
+  for(auto num = std::uint32_t{1}; bytes[bytes_n - 1] >= num; num *= 2) {
+    ++bits;
+  }
+  return bits + static_cast<int>(bytes_n - 1) * 8;
+}
+
+// Most significant bit first, reading zeros past the end.
+class bit_reader {
+public:
+  explicit bit_reader(std::string_view data) noexcept
+  : data_{reinterpret_cast<const unsigned char*>(data.data())}
+  , size_{data.size()}
+  {
+  }
+
+  auto read(int bits) noexcept -> std::uint32_t
+  {
+    if(bits == 0) {
+      return 0;
+    }
+
+    const auto byte = position_ / 8;
+    auto word = std::uint64_t{0};
+    if(byte + 8 <= size_) {
+      for(auto i = std::size_t{0}; i < 8; ++i) {
+        word = (word << 8) | data_[byte + i];
+      }
+    } else {
+      for(auto i = std::size_t{0}; i < 8; ++i) {
+        word = (word << 8) | (byte + i < size_ ? data_[byte + i] : 0);
+      }
+    }
+
+    const auto value = (word << (position_ % 8)) >> (64 - bits);
+    position_ += static_cast<std::size_t>(bits);
+    return static_cast<std::uint32_t>(value);
+  }
+
+  auto read_each(const std::array<int, 3>& bits) noexcept
+   -> std::array<std::int32_t, 3>
+  {
+    const auto x = static_cast<std::int32_t>(read(bits[0]));
+    const auto y = static_cast<std::int32_t>(read(bits[1]));
+    return {x, y, static_cast<std::int32_t>(read(bits[2]))};
+  }
+
+  // Three digits of a mixed-radix number bits long, stored as its bytes
+  // from the least significant up.
+  auto read_ints(int bits, const std::array<std::uint32_t, 3>& sizes) noexcept
+   -> std::array<std::int32_t, 3>
+  {
+    if(bits <= 64) {
+      auto value = std::uint64_t{0};
+      auto shift = 0;
+      for(; bits > 8; bits -= 8, shift += 8) {
+        value |= std::uint64_t{read(8)} << shift;
+      }
+      value |= std::uint64_t{read(bits)} << shift;
+
+      const auto z = value % sizes[2];
+      value /= sizes[2];
+      const auto y = value % sizes[1];
+      return {static_cast<std::int32_t>(value / sizes[1]),
+              static_cast<std::int32_t>(y),
+              static_cast<std::int32_t>(z)};
+    }
+
+    auto bytes = std::array<std::uint32_t, 32>{};
+    auto bytes_n = std::size_t{0};
+    for(; bits > 8; bits -= 8) {
+      bytes[bytes_n++] = read(8);
+    }
+    bytes[bytes_n++] = read(bits);
+
+    auto ints = std::array<std::int32_t, 3>{};
+    for(auto i = std::size_t{2}; i > 0; --i) {
+      auto num = std::uint64_t{0};
+      for(auto j = bytes_n; j-- > 0;) {
+        num = (num << 8) | bytes[j];
+        bytes[j] = static_cast<std::uint32_t>(num / sizes[i]);
+        num %= sizes[i];
+      }
+      ints[i] = static_cast<std::int32_t>(num);
+    }
+    ints[0] = static_cast<std::int32_t>(bytes[0] | (bytes[1] << 8) |
+                                        (bytes[2] << 16) | (bytes[3] << 24));
+    return ints;
+  }
+
+private:
+  const unsigned char* data_;
+
+  std::size_t size_;
+
+  std::size_t position_{0};
+};
+
+} // namespace
+
+xtc_frame_source::xtc_frame_source(const std::string& path)
+: file_{path}
+{
+  const auto data = file_.data();
+  if(data.size() < header_bytes || load_be32(data, 0) != xtc_magic) {
+    return;
+  }
+
+  atoms_size_ = load_be32(data, 4);
+
+  // A frame cut short by a writer still running is left out.
+  for(auto offset = std::size_t{0}; offset + header_bytes <= data.size();) {
+    if(load_be32(data, offset) != xtc_magic ||
+       load_be32(data, offset + 4) != atoms_size_) {
+      break;
+    }
+
+    const auto bytes = frame_bytes(data, offset);
+    if(bytes > data.size() - offset) {
+      break;
+    }
+    offsets_.push_back(offset);
+    offset += bytes;
+  }
+}
+
+auto xtc_frame_source::frames_size() const noexcept -> std::size_t
+{
+  return offsets_.size();
+}
+
+auto xtc_frame_source::atoms_size() const noexcept -> std::size_t
+{
+  return atoms_size_;
+}
+
+// Coordinates are integers in units of one over the precision, each atom
+// stored either whole, relative to the minimum, or as a small difference
+// from the atom before it in a run. The width of small differences adapts
+// from run to run.
+auto xtc_frame_source::read_frame(std::size_t frame, gsl::span<float> coords)
+ -> bool
+{
+  assert(static_cast<std::size_t>(coords.size()) == atoms_size_ * 3);
+
+  if(frame >= offsets_.size()) {
+    return false;
+  }
+
+  const auto data = file_.data();
+  auto offset = offsets_[frame] + header_bytes;
+
+  if(atoms_size_ <= max_uncompressed_atoms) {
+    for(auto& coord : coords) {
+      coord = load_be_float(data, offset) * angstrom_per_nm;
+      offset += sizeof(float);
+    }
+    return true;
+  }
+
+  const auto precision = load_be_float(data, offset);
+  if(!(precision > 0)) {
+    return false;
+  }
+
+  auto min_ints = std::array<std::int32_t, 3>{};
+  auto sizes = std::array<std::uint32_t, 3>{};
+  for(auto axis = std::size_t{0}; axis < 3; ++axis) {
+    min_ints[axis] = load_be_int(data, offset + 4 + axis * 4);
+    const auto max_int = load_be_int(data, offset + 16 + axis * 4);
+    sizes[axis] = static_cast<std::uint32_t>(max_int - min_ints[axis]) + 1;
+  }
+
+  // Sizes too large to multiply are read one coordinate at a time.
+  const auto is_large = (sizes[0] | sizes[1] | sizes[2]) > 0xffffff;
+  const auto large_bits = std::array<int, 3>{
+   bits_of_int(sizes[0]), bits_of_int(sizes[1]), bits_of_int(sizes[2])};
+  const auto bits = is_large ? 0 : bits_of_ints(sizes);
+
+  auto small_index = load_be_int(data, offset + 28);
+  if(small_index < first_index || small_index >= last_index) {
+    return false;
+  }
+  auto smaller = magic_ints[std::max(first_index, small_index - 1)] / 2;
+  auto small_num = magic_ints[small_index] / 2;
+  auto small_sizes = std::array<std::uint32_t, 3>{};
+  small_sizes.fill(static_cast<std::uint32_t>(magic_ints[small_index]));
+
+  const auto stream_bytes = load_be32(data, offset + 32);
+  auto stream = bit_reader{data.substr(offset + compressed_header_bytes,
+                                       stream_bytes)};
+
+  const auto scale = angstrom_per_nm / precision;
+  auto output = coords.begin();
+  const auto emit = [&](const std::array<std::int32_t, 3>& coord) noexcept {
+    if(output == coords.end()) {
+      return false;
+    }
+    *output++ = static_cast<float>(coord[0]) * scale;
+    *output++ = static_cast<float>(coord[1]) * scale;
+    *output++ = static_cast<float>(coord[2]) * scale;
+    return true;
+  };
+
+  // The run length carries over to atoms that do not set a new one.
+  auto run = 0;
+  for(auto atoms_n = std::size_t{0}; atoms_n < atoms_size_;) {
+    auto coord = is_large ? stream.read_each(large_bits)
+                          : stream.read_ints(bits, sizes);
+    ++atoms_n;
+    for(auto axis = std::size_t{0}; axis < 3; ++axis) {
+      coord[axis] += min_ints[axis];
+    }
+
+    auto is_smaller = 0;
+    if(stream.read(1) == 1) {
+      run = static_cast<int>(stream.read(5));
+      is_smaller = run % 3;
+      run -= is_smaller;
+      --is_smaller;
+    }
+
+    if(run == 0 && !emit(coord)) {
+      return false;
+    }
+
+    // The first two atoms of a run are stored swapped, which compresses
+    // water better.
+    auto previous = coord;
+    for(auto k = 0; k < run; k += 3) {
+      auto next = stream.read_ints(small_index, small_sizes);
+      ++atoms_n;
+      for(auto axis = std::size_t{0}; axis < 3; ++axis) {
+        next[axis] += previous[axis] - small_num;
+      }
+
+      if(k == 0 && !emit(next)) {
+        return false;
+      }
+      if(!emit(k == 0 ? previous : next)) {
+        return false;
+      }
+      previous = next;
+    }
+
+    small_index += is_smaller;
+    if(small_index < first_index || small_index >= last_index) {
+      return false;
+    }
+    if(is_smaller < 0) {
+      small_num = smaller;
+      smaller = small_index > first_index ? magic_ints[small_index - 1] / 2
+                                          : 0;
+    } else if(is_smaller > 0) {
+      smaller = small_num;
+      small_num = magic_ints[small_index] / 2;
+    }
+    small_sizes.fill(static_cast<std::uint32_t>(magic_ints[small_index]));
+  }
+
+  return output == coords.end();
+}
+
+} // namespace molphene
@@ -0,0 +1,36 @@
+#ifndef MOLPHENE_MOLECULE_XTC_FRAME_SOURCE_HPP
+#define MOLPHENE_MOLECULE_XTC_FRAME_SOURCE_HPP
+
+#include "stdafx.hpp"
+
+#include "frame_source.hpp"
+#include "mapped_file.hpp"
+
+namespace molphene {
+
+// Frames of a GROMACS XTC file, decompressed out of the mapped file and
+// scaled from nanometre to angstrom. Compressed frames differ in size, so
+// opening the file hops from header to header once to find them all.
+class xtc_frame_source : public frame_source {
+public:
+  explicit xtc_frame_source(const std::string& path);
+
+  auto frames_size() const noexcept -> std::size_t override;
+
+  auto atoms_size() const noexcept -> std::size_t override;
+
+  auto read_frame(std::size_t frame, gsl::span<float> coords)
+   -> bool override;
+
+private:
+  mapped_file file_;
+
+  std::size_t atoms_size_{0};
+
+  // Offset of the header of each frame.
+  std::vector<std::size_t> offsets_;
+};
+
+} // namespace molphene
+
+#endif